@@ -0,0 +1,68 @@
+#ifndef TACO_AUTOSCHEDULER_H
+#define TACO_AUTOSCHEDULER_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "taco/index_notation/index_notation.h"
+#include "taco/util/uncopyable.h"
+
+namespace taco {
+
+class TensorBase;
+class TensorStorage;
+
+/// An autoscheduler picks the schedule of a tensor's kernel by timing
+/// candidate schedules on the tensor's operands.  The candidates are built
+/// with the scheduling transformations: every loop order that iterates the
+/// operands in storage order, each serial, parallelized over threads with an
+/// even or a nonzero-balanced split, and with the two outer loops fused and
+/// parallelized over the positions of a sparse operand.  Candidates that fail
+/// to compile or compute a different result are discarded, and the cost model
+/// can rank the candidates so that only the most promising ones are timed.
+///
+/// The winner is remembered per expression, format and size class, where the
+/// expression is compared with its tensors and index variables renamed, and the
+/// size class of an operand is the power of two of each dimension and of its
+/// number of stored components.  If the autoscheduler has a cache file, the
+/// winners are also stored there, so later runs that build the same kernels
+/// skip the search.  Autoschedulers are attached to tensors with
+/// `TensorBase::setAutoscheduler`.
+class Autoscheduler : private util::Uncopyable {
+public:
+  /// Create an autoscheduler that times every candidate `numRuns` times and
+  /// keeps the winners in `cacheFile` if it is not empty.
+  explicit Autoscheduler(std::string cacheFile = "", int numRuns = 3);
+
+  /// Returns the candidate schedules of a concrete index statement, starting
+  /// with the statement itself.  The candidates are always enumerated in the
+  /// same order, so a cached winner is identified by its position.
+  std::vector<IndexStmt> getCandidates(IndexStmt stmt) const;
+
+  /// Returns the fastest candidate schedule of `stmt`, which must compute the
+  /// kernel assignment of `tensor`.  The candidates are timed on `arguments`,
+  /// the computed storages of the arguments of `stmt` in order, and the
+  /// winner is looked up before any candidate is compiled.
+  IndexStmt schedule(TensorBase tensor, IndexStmt stmt,
+                     const std::vector<TensorStorage>& arguments);
+
+  /// Only time the `maxTimedCandidates` candidates that the cost model ranks
+  /// fastest, or every candidate if it is zero (the default).
+  void setMaxTimedCandidates(size_t maxTimedCandidates);
+
+  /// Returns the number of candidate schedules that have been timed.
+  int getNumTimedCandidates() const;
+
+private:
+  std::string cacheFile;
+  int numRuns;
+  size_t maxTimedCandidates = 0;
+  int numTimedCandidates = 0;
+  std::map<std::string, size_t> winners;
+  mutable std::mutex winnersMutex;
+};
+
+}
+#endif
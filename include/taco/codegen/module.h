@@ -42,27 +42,38 @@ public:
   /// Get the source of the module as a string */
   std::string getSource();
   
+  /// A function that takes its arguments packed into an array of pointers.
+  typedef int (*PackedFunc)(void**);
+
   /// Get a function pointer to a compiled function. This returns a void*
   /// pointer, which the caller is required to cast to the correct function type
   /// before calling. If there's no function of this name then a nullptr is
   /// returned.
-  void* getFuncPtr(std::string name);
+  void* getFuncPtr(const std::string& name) const;
+
+  /// Get the function of the given name that uses the taco_tensor_t interface
+  /// (i.e., its shim). If there's no function of this name then a nullptr is
+  /// returned.
+  PackedFunc getPackedFunc(const std::string& name) const;
+
+  /// Call a packed function of this module and return the result
+  int callFuncPacked(PackedFunc func, void** args) const;
 
   /// Call a raw function in this module and return the result
-  int callFuncPackedRaw(std::string name, void** args);
+  int callFuncPackedRaw(const std::string& name, void** args) const;
   
   /// Call a raw function in this module and return the result
-  int callFuncPackedRaw(std::string name, std::vector<void*> args) {
+  int callFuncPackedRaw(const std::string& name, std::vector<void*> args) const {
     return callFuncPackedRaw(name, args.data());
   }
   
   /// Call a function using the taco_tensor_t interface and return the result
-  int callFuncPacked(std::string name, void** args) {
-    return callFuncPackedRaw("_shim_"+name, args);
+  int callFuncPacked(const std::string& name, void** args) const {
+    return callFuncPacked(getPackedFunc(name), args);
   }
   
   /// Call a function using the taco_tensor_t interface and return the result
-  int callFuncPacked(std::string name, std::vector<void*> args) {
+  int callFuncPacked(const std::string& name, std::vector<void*> args) const {
     return callFuncPacked(name, args.data());
   }
   
@@ -76,6 +87,11 @@ private:
   std::string tmpdir;
   void* lib_handle;
   std::vector<Stmt> funcs;
+
+  // The functions of the library and their shims, which are looked up once
+  // after the library is loaded
+  std::map<std::string, void*> funcPtrs;
+  std::map<std::string, PackedFunc> packedFuncs;
   
   // true iff the module was created from user-provided source
   bool moduleFromUserSource;
@@ -84,6 +100,7 @@ private:
   
   void setJITLibname();
   void setJITTmpdir();
+  void resolveFuncs();
 
   static std::string chars;
   static std::default_random_engine gen;
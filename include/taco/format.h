@@ -67,6 +67,11 @@ public:
   /// Sets the types of the coordinate arrays for each level
   void setLevelArrayTypes(std::vector<std::vector<Datatype>> levelArrayTypes);
 
+  /// Gets the widest type of the coordinate arrays of all levels. Kernels use
+  /// this type to store positions and capacities, so tensors with more than
+  /// INT_MAX nonzeros need Int64 position arrays.
+  Datatype getIndexType() const;
+
 private:
   std::vector<ModeFormatPack> modeFormatPacks;
   std::vector<int> modeOrdering;
@@ -87,12 +92,20 @@ public:
   static ModeFormat dense;       /// e.g., first mode in CSR
   static ModeFormat compressed;  /// e.g., second mode in CSR
   static ModeFormat singleton;   /// e.g., second mode in COO
+  static ModeFormat packed;      /// compressed with bit-packed coordinates
+  static ModeFormat sliced;      /// sliced ELLPACK (SELL-C-σ)
+  static ModeFormat hashed;      /// open-addressing hash table per fiber
+  static ModeFormat bitmap;      /// bit per coordinate, dense values
 
   static ModeFormat sparse;      /// alias for compressed
   static ModeFormat Dense;       /// alias for dense
   static ModeFormat Compressed;  /// alias for compressed
   static ModeFormat Sparse;      /// alias for compressed
   static ModeFormat Singleton;   /// alias for singleton
+  static ModeFormat Packed;      /// alias for packed
+  static ModeFormat Sliced;      /// alias for sliced
+  static ModeFormat Hashed;      /// alias for hashed
+  static ModeFormat Bitmap;      /// alias for bitmap
 
   /// Properties of a mode format
   enum Property {
@@ -153,6 +166,10 @@ public:
   /// type can be used to indicate a mode whose format is not (yet) known.
   bool defined() const;
 
+  /// Returns the implementation of the mode format, which holds the parameters
+  /// of parameterized mode formats.
+  std::shared_ptr<const ModeFormatImpl> getImpl() const;
+
   friend bool operator==(const ModeFormat&, const ModeFormat&);
   friend bool operator!=(const ModeFormat&, const ModeFormat&);
   friend std::ostream& operator<<(std::ostream&, const ModeFormat&);
@@ -190,11 +207,19 @@ extern const ModeFormat Dense;
 extern const ModeFormat Compressed;
 extern const ModeFormat Sparse;
 extern const ModeFormat Singleton;
+extern const ModeFormat Packed;
+extern const ModeFormat Sliced;
+extern const ModeFormat Hashed;
+extern const ModeFormat Bitmap;
 
 extern const ModeFormat dense;
 extern const ModeFormat compressed;
 extern const ModeFormat sparse;
 extern const ModeFormat singleton;
+extern const ModeFormat packed;
+extern const ModeFormat sliced;
+extern const ModeFormat hashed;
+extern const ModeFormat bitmap;
 
 extern const Format CSR;
 extern const Format CSC;
@@ -203,10 +228,23 @@ extern const Format DCSC;
 
 const Format COO(int order, bool isUnique = true, bool isOrdered = true, 
                  bool isAoS = false, const std::vector<int>& modeOrdering = {});
+
+/// The format of a blocked tensor, which stores the blocks of an order-N
+/// tensor in `blockFormat` and the components of every block densely.  The
+/// first N modes of a blocked tensor index the blocks and the last N modes
+/// the components within a block, so `Blocked(CSR)` is the block compressed
+/// sparse row (BCSR) format and `Blocked(CSF)` is BCSF.
+const Format Blocked(const Format& blockFormat);
+
+extern const Format BCSR;
 /// @}
 
 /// True if all modes are dense.
 bool isDense(const Format&);
 
+/// True if the format is `Blocked(blockFormat)` for a block format that is not
+/// all dense, in which case the last half of its modes index within blocks.
+bool isBlocked(const Format&);
+
 }
 #endif
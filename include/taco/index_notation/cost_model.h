@@ -0,0 +1,127 @@
+#ifndef TACO_COST_MODEL_H
+#define TACO_COST_MODEL_H
+
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include "taco/format.h"
+#include "taco/index_notation/index_notation.h"
+
+namespace taco {
+
+class TensorStorage;
+
+/// Statistics of a tensor that the cost model estimates loop trip counts and
+/// memory footprints from.  Levels are numbered in storage order.
+class TensorStatistics {
+public:
+  /// Construct undefined statistics.
+  TensorStatistics();
+
+  /// Statistics of a tensor whose `nnz` nonzeros are spread uniformly.
+  TensorStatistics(const std::vector<int>& dimensions, const Format& format,
+                   size_t nnz);
+
+  /// Statistics measured from the index of a tensor's storage.
+  TensorStatistics(const TensorStorage& storage);
+
+  /// Returns the dimensions of the tensor modes.
+  const std::vector<int>& getDimensions() const;
+
+  /// Returns the number of positions, i.e., coordinates stored in the level,
+  /// counted over all fibers of the level.
+  double getNumPositions(int level) const;
+
+  /// Returns the average number of positions of a fiber of the level.
+  double getAverageFiberLength(int level) const;
+
+  /// Returns the largest number of positions of a fiber of the level.
+  double getMaxFiberLength(int level) const;
+
+  /// Returns the fraction of the coordinates of the level's fibers that are
+  /// stored.
+  double getDensity(int level) const;
+
+  /// Returns true if the statistics are defined.
+  bool defined() const;
+
+private:
+  std::vector<int> dimensions;
+  std::vector<int> modeOrdering;
+  std::vector<double> numPositions;
+  std::vector<double> maxFiberLengths;
+};
+
+/// Parameters of the machine that the cost model estimates times for.
+struct CostModelParameters {
+  /// The number of threads that parallel loops run on.
+  int numThreads = 1;
+
+  /// The size of the cache that reused data must fit in, in bytes.
+  double cacheBytes = 1 << 20;
+
+  /// The size of a cache line, in bytes.
+  double lineBytes = 64;
+
+  /// The memory bandwidth of one thread and of all threads, in bytes per
+  /// second.
+  double threadBandwidth = 10e9;
+  double bandwidth = 40e9;
+
+  /// The number of scalar operations per second of one thread.
+  double operationsPerSecond = 1e9;
+
+  /// The number of operations that a vectorized loop does at once.
+  int vectorWidth = 4;
+
+  /// The cost of an atomic update, in scalar operations.
+  double atomicOperations = 20;
+};
+
+/// The estimated cost of a schedule.
+struct Cost {
+  /// The number of scalar operations of the loop bodies.
+  double operations = 0;
+
+  /// The operations in innermost loops over dense levels, which the compiler
+  /// can vectorize.
+  double vectorizableOperations = 0;
+
+  /// The operations in parallel loops.
+  double parallelOperations = 0;
+
+  /// The number of bytes moved between memory and the cache.
+  double memoryTraffic = 0;
+
+  /// The ratio of the work of the busiest thread to the average work of a
+  /// thread in parallel loops.
+  double loadImbalance = 1;
+
+  /// The estimated running time, in seconds.
+  double time = 0;
+};
+
+std::ostream& operator<<(std::ostream&, const Cost&);
+
+/// Estimate the cost of a concrete index statement from the statistics of its
+/// tensors.  The model follows the foralls of the statement, including those
+/// derived by scheduling transformations, and estimates the trip count of
+/// every loop from the levels it iterates: the fibers of compressed levels
+/// are intersected by multiplications and unioned by additions.  The memory
+/// traffic of an access is the footprint of the innermost loops whose data
+/// fits in the cache, reloaded for every iteration of the loops around them.
+/// Tensors without statistics are assumed to be dense.
+Cost estimateCost(IndexStmt stmt,
+                  const std::map<TensorVar,TensorStatistics>& statistics,
+                  const CostModelParameters& parameters = CostModelParameters());
+
+/// Returns the positions of the statements ordered from the lowest to the
+/// highest estimated time.
+std::vector<size_t>
+rankSchedules(const std::vector<IndexStmt>& stmts,
+              const std::map<TensorVar,TensorStatistics>& statistics,
+              const CostModelParameters& parameters = CostModelParameters());
+
+}
+#endif
@@ -663,20 +663,46 @@ public:
   /// reorder takes a new ordering for a set of index variables that are directly nested in the iteration order
   IndexStmt reorder(std::vector<IndexVar> reorderedvars) const;
 
+  /// The tile transformation blocks the directly nested loops over `vars`
+  /// for a hierarchy of caches.  `tileSizes` holds one tile size per index
+  /// variable for every level of tiling, from the outermost (largest) level
+  /// to the innermost one.  Every variable is split once per level, and the
+  /// loops over the tiles of a level are nested inside the loops over the
+  /// tiles of the level above it.  The variables derived from a variable `i`
+  /// are `i0` for the outermost tile loop through `iL` for the loop within
+  /// the innermost tile, where `L` is the number of levels.  Tail iterations
+  /// are handled like those of the split transformation.
+  /// Preconditions: the tile sizes are positive and the tile size of a
+  /// variable is a multiple of its tile size at the level below.
+  IndexStmt tile(std::vector<IndexVar> vars,
+                 std::vector<std::vector<size_t>> tileSizes) const;
+
+  /// Tile the loops over `vars` for the data caches of this machine, with the
+  /// tile sizes returned by `getTileSizes`.
+  IndexStmt tile(std::vector<IndexVar> vars) const;
+
   /// The mergeby transformation specifies how to merge iterators on
   /// the given index variable. By default, if an iterator is used for windowing
   /// it will be merged with the "gallop" strategy.
   /// All other iterators are merged with the "two finger" strategy.
   /// The two finger strategy merges by advancing each iterator one at a time, 
   /// while the gallop strategy implements the exponential search algorithm.
+  /// The vectorized strategy skips to the next common coordinate of two
+  /// compressed iterators by comparing blocks of their coordinates with SIMD
+  /// instructions, and merges other iterators with the two finger strategy.
+  /// The adaptive strategy emits both the two finger and the gallop strategy
+  /// for merges of two compressed iterators, and gallops through every merge
+  /// whose longer segment is more than TACO_GALLOP_RATIO (32 by default)
+  /// times as long as the shorter one.  The ratio can be tuned by defining it
+  /// when the generated code is compiled, e.g. with -DTACO_GALLOP_RATIO=8.
   /// 
   /// Preconditions:
   /// This command applies to variables involving sparse iterators only;
   /// it is a no-op if the variable invovles any dense iterators.
-  /// Any variable can be merged with the two finger strategy, whereas gallop
-  /// only applies to a variable if its merge lattice has a single point 
-  /// (i.e. an intersection). For example, if a variable involves multiplications
-  /// only, it can be merged with gallop.
+  /// Any variable can be merged with the two finger strategy, whereas gallop,
+  /// vectorized and adaptive only apply to a variable if its merge lattice has a single
+  /// point (i.e. an intersection). For example, if a variable involves
+  /// multiplications only, it can be merged with gallop.
   /// Furthermore, all iterators must be ordered for gallop to apply.
   IndexStmt mergeby(IndexVar i, MergeStrategy strategy) const;
 
@@ -707,14 +733,13 @@ public:
   /// into multiple sparse data structures cannot be parallelized as it is a while loop. Instead
   /// this loop can be parallelized by first strip-mining it with the split or divide
   /// transformation to create a parallel for loop with a serial nested while loop. Expressions
-  /// that have an output in a format that does not support random insert can also not be
-  /// parallelized. Parallelizing these expressions would require creating multiple copies of a
-  /// datastructure and then merging them, which is left to future work. Note that there is a special
-  /// case where the output's sparsity pattern is the same as one of the inputs.
-  /// This true of the popular sampled dense-dense matrix multiply (SDDMM),
-  /// tensor times vector (TTV), and tensor times matrix (TTM) kernels for example.
-  /// This does not require creating multiple copies, but the precondition still
-  /// prevents it as the implementation does not yet handle this special case.
+  /// that have an output in a format that does not support random insert, such as CSR, are
+  /// assembled in two passes when they are parallelized, as with
+  /// `assemble(result, AssembleStrategy::Insert)`. The first pass counts the coordinates of
+  /// every segment of the output in parallel, the counts are then scanned to build the pos
+  /// array, and the second pass inserts the coordinates at their positions in parallel. This
+  /// requires the parallelized loop to iterate over the segments, e.g. the rows of a CSR
+  /// matrix, and outputs that do not support ungrouped insertion can still not be parallelized.
   ///
   /// Finally, there are preconditions related to data races during reductions. The parallelize
   /// transformation allows for supplying a strategy to handle these data races. The NoRaces
@@ -1324,6 +1349,16 @@ std::pair<std::vector<Access>,std::set<Access>> getResultAccesses(IndexStmt stmt
 /// Returns the input accesses, in the order they appear.
 std::vector<Access> getArgumentAccesses(IndexStmt stmt);
 
+/// Returns tile sizes for `IndexStmt::tile` with one level per cache, given
+/// the cache sizes in bytes from the first level outward.  Every level tiles
+/// all the variables with the largest power of two for which the tiles of the
+/// tensors that the statement accesses through `vars` fill at most half the
+/// cache.  Levels that would not shrink the tiles of the level above them are
+/// dropped.
+std::vector<std::vector<size_t>>
+getTileSizes(IndexStmt stmt, const std::vector<IndexVar>& vars,
+             const std::vector<size_t>& cacheSizes);
+
 /// Returns the index variables in the index statement.
 std::vector<IndexVar> getIndexVars(IndexStmt stmt);
 
@@ -6,9 +6,9 @@
 
 namespace taco {
 
-class Function;
 class IndexStmt;
 class TensorStorage;
+class PreparedKernel;
 namespace ir {
 class Module;
 }
@@ -54,6 +54,10 @@ public:
   }
   /// @}
 
+  /// Bind the kernel to tensor storage arguments, so that it can be called
+  /// repeatedly without packing the arguments on every call.
+  PreparedKernel prepare(const std::vector<TensorStorage>& args) const;
+
   /// Check whether the kernel is defined.
   bool defined();
 
@@ -69,6 +73,52 @@ private:
   void* computeFunction;
 };
 
+/// A prepared kernel is a kernel bound to the tensor storage it executes on.
+/// The arguments are converted to `taco_tensor_t` and the kernel functions are
+/// looked up once, when the kernel is prepared, so a call only invokes the
+/// compiled function and, if it allocated the results, unpacks them.
+///
+/// Components of the bound tensors may be changed between calls, but tensors
+/// whose index or value arrays are replaced (e.g., by packing them again) must
+/// be bound again with `bind`.
+class PreparedKernel {
+public:
+  /// Construct an undefined prepared kernel.
+  PreparedKernel();
+
+  /// Prepare the functions of a module for the given arguments, whose first
+  /// `numResults` entries are the results.  If `assembleWhileCompute` is true
+  /// then the compute function allocates the results, and they are unpacked
+  /// after it returns.
+  PreparedKernel(std::shared_ptr<ir::Module> module, size_t numResults,
+                 const std::vector<TensorStorage>& args,
+                 bool assembleWhileCompute=false);
+
+  /// Evaluate the kernel, which includes allocating memory, assembling
+  /// indices, and computing component values.
+  bool operator()() const;
+
+  /// Execute the kernel to assemble the indices of the results.
+  bool assemble() const;
+
+  /// Execute the kernel to compute the component values of the results.
+  bool compute() const;
+
+  /// Bind `storage` to the `i`th argument in place of the storage it was
+  /// prepared with, which must have the same format and dimensions.
+  void bind(size_t i, const TensorStorage& storage);
+
+  /// Returns the storage bound to the `i`th argument.
+  const TensorStorage& getArgument(size_t i) const;
+
+  /// Check whether the prepared kernel is defined.
+  bool defined() const;
+
+private:
+  struct Content;
+  std::shared_ptr<Content> content;
+};
+
 /// Compile a concrete index notation statement to a runnable kernel.
 Kernel compile(IndexStmt stmt);
 
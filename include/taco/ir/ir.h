@@ -1,6 +1,7 @@
 #ifndef TACO_IR_H
 #define TACO_IR_H
 
+#include <atomic>
 #include <vector>
 #include <typeinfo>
 #include <utility>
@@ -94,7 +95,7 @@ struct IRNode : private util::Uncopyable {
    */
   virtual IRNodeType type_info() const = 0;
 
-  mutable long ref = 0;
+  mutable std::atomic<long> ref{0};
   friend void acquire(const IRNode* node) {
     ++(node->ref);
   }
@@ -797,6 +798,10 @@ struct GetProperty : public ExprNode<GetProperty> {
   static Expr make(Expr tensor, TensorProperty property, int mode=0);
   static Expr make(Expr tensor, TensorProperty property, int mode,
                    int index, std::string name);
+
+  /// Make an index array property whose elements have the given type.
+  static Expr make(Expr tensor, TensorProperty property, int mode,
+                   int index, std::string name, Datatype type);
   
   static const IRNodeType _type_info = IRNodeType::GetProperty;
 };
@@ -4,12 +4,17 @@
 namespace taco {
 
 /// ParallelUnit::CPUThread generates a pragma to parallelize over CPU threads
+/// ParallelUnit::CPUTask parallelizes over CPU threads with tasks, which idle
+///   threads steal from busy ones, instead of a statically scheduled loop
+/// ParallelUnit::CPUThreadBalanced parallelizes a loop over the segments of a
+///   compressed level over CPU threads, giving each thread the same number of
+///   nonzeros rather than the same number of iterations
 /// ParallelUnit::CPUVector generates a pragma to utilize a CPU vector unit
 /// ParallelUnit::GPUBlock must be used with GPUThread to create blocks of GPU threads
 /// ParallelUnit::GPUWarp can be optionally used to allow for GPU warp-level primitives
 /// ParallelUnit::GPUThread causes for every iteration to be executed on a separate GPU thread
 enum class ParallelUnit {
-  NotParallel, DefaultUnit, GPUBlock, GPUWarp, GPUThread, CPUThread, CPUVector, CPUThreadGroupReduction, GPUBlockReduction, GPUWarpReduction
+  NotParallel, DefaultUnit, GPUBlock, GPUWarp, GPUThread, CPUThread, CPUVector, CPUThreadGroupReduction, GPUBlockReduction, GPUWarpReduction, CPUTask, CPUThreadBalanced
 };
 extern const char *ParallelUnit_NAMES[];
 
@@ -35,8 +40,12 @@ extern const char *AssembleStrategy_NAMES[];
 
 /// MergeStrategy::TwoFinger merges iterators by incrementing one at a time
 /// MergeStrategy::Galloping merges iterators by exponential search (galloping)
+/// MergeStrategy::Vectorized intersects two compressed iterators by comparing
+///   blocks of coordinates all-pairs at a time with SIMD instructions
+/// MergeStrategy::Adaptive picks TwoFinger or Gallop for every merge of two
+///   compressed iterators from the lengths of their segments
 enum class MergeStrategy {
-  TwoFinger, Gallop
+  TwoFinger, Gallop, Vectorized, Adaptive
 };
 extern const char *MergeStrategy_NAMES[];
 
@@ -140,6 +140,19 @@ public:
   ModeFunction posBounds(const ir::Expr& parentPos) const;
   ModeFunction posAccess(const ir::Expr& pos, 
                          const std::vector<ir::Expr>& coords) const;
+
+  /// Returns the distance between consecutive positions of a fiber, which is
+  /// 1 for iterators over dimensions.
+  ir::Expr posStride() const;
+
+  /// Returns the words whose bits mark the positions of the level that hold a
+  /// coordinate, or an undefined expression if the level has no bitmap.
+  ir::Expr posBitmap() const;
+
+  /// Returns the fiber in a slot of the slices of the level, which has
+  /// `numFibers` fibers, or an undefined expression if the level has no
+  /// slices.
+  ir::Expr sliceFiber(const ir::Expr& slot, const ir::Expr& numFibers) const;
   
   /// Returns code for level function that implements locate capability.
   ModeFunction locate(const std::vector<ir::Expr>& coords) const;
@@ -124,6 +124,35 @@ protected:
                                        std::set<Access> reducedAccesses,
                                        ir::Stmt recoveryStmt);
 
+  /// Returns true if the forall can be lowered by lowerForallBitmap, which
+  /// requires that every iterator of the case lattice is a bitmap and that the
+  /// forall is sequential or parallelized over CPU threads.
+  bool canLowerForallBitmap(Forall forall, MergeLattice caseLattice);
+
+  /// Lower a forall whose iterators are all bitmaps to a loop over the words
+  /// of the bitmaps, which visits the positions that are marked in the
+  /// combined words and locates every operand.
+  virtual ir::Stmt lowerForallBitmap(Forall forall, MergeLattice caseLattice,
+                                     std::set<Access> reducedAccesses,
+                                     ir::Stmt recoveryStmt);
+
+  /// Returns true if the forall can be lowered by lowerForallSlices, which
+  /// requires that the forall iterates over the rows of a dense level, is
+  /// sequential or parallelized over CPU threads, and reduces a loop over a
+  /// sliced child level into a scalar that it assigns to a dense result, as
+  /// in a sparse matrix-vector product.
+  bool canLowerForallSlices(Forall forall, MergeLattice caseLattice);
+
+  /// Lower a forall over the rows of a sliced level to a loop over the slices
+  /// of the level, which visits every column of a slice with an inner loop
+  /// over the rows of the slice, whose positions are adjacent.
+  virtual ir::Stmt lowerForallSlices(Forall forall, MergeLattice caseLattice,
+                                     ir::Stmt recoveryStmt);
+
+  /// Returns the merge lattice of the loop over a sliced level that a forall
+  /// lowered by lowerForallSlices reduces.
+  MergeLattice getSliceLattice(Forall slices);
+
   /// Used in lowerForallFusedPosition to generate code to
   /// search for the start of the iteration of the loop (a separate kernel on GPUs)
   virtual ir::Stmt searchForFusedPositionStart(Forall forall, Iterator posIterator);
@@ -147,7 +176,8 @@ protected:
      *      A concrete index notation statement to compute at the points in the
      *      sparse iteration space described by the merge lattice.
      * \param mergeStrategy
-     *      A strategy for merging iterators. One of TwoFinger or Gallop.
+     *      A strategy for merging iterators. One of TwoFinger, Gallop,
+     *      Vectorized or Adaptive.
      *
      * \return
      *       IR code to compute the forall loop.
@@ -342,8 +372,11 @@ protected:
    */
   ir::Stmt initValues(ir::Expr tensor, ir::Expr initVal, ir::Expr begin, ir::Expr size);
 
-  /// Declare position variables and initialize them with a locate.
-  ir::Stmt declLocatePosVars(std::vector<Iterator> iterators);
+  /// Declare position variables and initialize them with a locate.  If the
+  /// iterators are inserters, then their coordinates are also inserted when
+  /// assembling.
+  ir::Stmt declLocatePosVars(std::vector<Iterator> iterators,
+                             bool inserting = false);
 
   /// Emit loops to reduce duplicate coordinates.
   ir::Stmt reduceDuplicateCoordinates(ir::Expr coordinate, 
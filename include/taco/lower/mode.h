@@ -76,9 +76,17 @@ public:
   ModePack(size_t numModes, ModeFormat modeType, ir::Expr tensor, int mode, 
            int level);
 
+  /// Create a mode pack whose index arrays have the given element types, as
+  /// returned by `Format::getLevelArrayTypes`.
+  ModePack(size_t numModes, ModeFormat modeType, ir::Expr tensor, int mode, 
+           int level, const std::vector<Datatype>& arrayTypes);
+
   /// Returns number of tensor modes belonging to mode pack.
   size_t getNumModes() const;
 
+  /// Returns number of arrays shared by tensor modes.
+  size_t getNumArrays() const;
+
   /// Returns arrays shared by tensor modes.
   ir::Expr getArray(size_t i) const;
 
@@ -0,0 +1,100 @@
+#ifndef TACO_MODE_FORMAT_BITMAP_H
+#define TACO_MODE_FORMAT_BITMAP_H
+
+#include "taco/lower/mode_format_impl.h"
+#include "taco/storage/array.h"
+
+namespace taco {
+
+/// A bitmap mode stores every fiber of the level, e.g. every row of a matrix,
+/// as a dense fiber of W positions together with one bit per position that
+/// marks whether it holds a coordinate, where W is the dimension rounded up to
+/// a multiple of 64.  The values of the level are dense, with zeros in the
+/// positions that are not marked, so coordinates are located in constant time
+/// like in dense levels, while loops only visit the marked positions.  This
+/// suits fibers that are too dense for compressed levels and too sparse for
+/// dense levels, e.g. with 1-30% nonzeros.
+///
+/// The level stores the bits as 64-bit words in its second index array, where
+/// bit k of word w marks position 64w + k, so every fiber starts at a word
+/// boundary.  Its first array is the dimension of the mode, from which the
+/// generated code computes W.  The generated code marks and tests positions
+/// with `taco_bitmap_mask`, and marks them atomically since parallel loops may
+/// mark positions in the same word.  Since the values follow the layout of
+/// the bits, a bitmap mode must be the last level of a format.
+///
+/// Loops whose iterators are all bitmaps iterate over the words of the
+/// fibers instead of the positions, and combine the words of the operands
+/// with bitwise and, for operands that must be nonzero for the loop body to
+/// compute anything, or with bitwise or.  The marked positions of every word
+/// are then visited in order with `taco_bitmap_ctz`.  In merges with levels of
+/// other formats, bitmap levels are iterated like dense levels whose unmarked
+/// positions are zero.  `makeCompressed` converts tensors with a bitmap level
+/// to the compressed format.
+class BitmapModeFormat : public ModeFormatImpl {
+public:
+  using ModeFormatImpl::getInsertCoord;
+
+  BitmapModeFormat();
+  BitmapModeFormat(bool isOrdered, bool isUnique, bool isZeroless);
+
+  ~BitmapModeFormat() override {}
+
+  ModeFormat copy(std::vector<ModeFormat::Property> properties) const override;
+
+  ModeFunction posIterBounds(ir::Expr parentPos, Mode mode) const override;
+  ModeFunction posIterAccess(ir::Expr pos, std::vector<ir::Expr> coords,
+                             Mode mode) const override;
+  ir::Expr posIterBitmap(Mode mode) const override;
+
+  ModeFunction locate(ir::Expr parentPos, std::vector<ir::Expr> coords,
+                      Mode mode) const override;
+
+  ir::Stmt getInsertCoord(ir::Expr p, const std::vector<ir::Expr>& i,
+                          Mode mode) const override;
+  ir::Expr getWidth(Mode mode) const override;
+  ir::Stmt getInsertInitLevel(ir::Expr szPrev, ir::Expr sz,
+                              Mode mode) const override;
+
+  ir::Expr getAssembledSize(ir::Expr prevSize, Mode mode) const override;
+  ir::Stmt getInitCoords(ir::Expr prevSize,
+                         std::vector<AttrQueryResult> queries,
+                         Mode mode) const override;
+  ModeFunction getYieldPos(ir::Expr parentPos, std::vector<ir::Expr> coords,
+                           Mode mode) const override;
+  ir::Stmt getInsertCoord(ir::Expr parentPos, ir::Expr pos,
+                          std::vector<ir::Expr> coords,
+                          Mode mode) const override;
+
+  std::vector<ir::Expr> getArrays(ir::Expr tensor, int mode,
+                                  int level) const override;
+
+  /// Returns the number of positions of every fiber (W) of a bitmap level
+  /// with the given dimension.
+  static int getWidth(int dimension);
+
+  /// Convert the pos and crd arrays and the values of a compressed level with
+  /// `numFibers` fibers of `width` positions to the bits and values of the
+  /// bitmap level.
+  static void mark(const int* pos, const int* crd, const Array& vals,
+                   size_t numFibers, int width, Array* bits,
+                   Array* bitmapVals);
+
+  /// Convert the bits and values of a bitmap level with `numFibers` fibers of
+  /// `width` positions to the pos and crd arrays and values of a compressed
+  /// level.
+  static void compress(const uint64_t* bits, const Array& vals,
+                       size_t numFibers, int width, Array* pos, Array* crd,
+                       Array* compressedVals);
+
+protected:
+  ir::Expr getSizeArray(ModePack pack) const;
+  ir::Expr getBitsArray(ModePack pack) const;
+
+  /// Returns code that marks position `pos` in the bits of the level.
+  ir::Stmt markPosition(ir::Expr pos, Mode mode) const;
+};
+
+}
+
+#endif
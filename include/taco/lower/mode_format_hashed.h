@@ -0,0 +1,114 @@
+#ifndef TACO_MODE_FORMAT_HASHED_H
+#define TACO_MODE_FORMAT_HASHED_H
+
+#include "taco/lower/mode_format_impl.h"
+#include "taco/storage/array.h"
+
+namespace taco {
+
+/// A hashed mode stores every fiber of the level, e.g. every row of a matrix,
+/// in an open-addressing hash table with W slots, where W is a power of two.
+/// The coordinates of a fiber are placed by hashing them and probing linearly,
+/// so coordinates can be located and inserted in any order in expected
+/// constant time.  This lets kernels scatter into sparse results, such as the
+/// rows of a sparse matrix product, without dense workspaces that are as large
+/// as the dimension or a sort of the coordinates.
+///
+/// The level has two index arrays.  The first holds the number of slots of the
+/// tables of the tensor, which is at least W, followed by an overflow flag, and
+/// the second is the table, which holds that many slots per parent position.
+/// Kernels read the number of slots from the first array.  Empty slots have
+/// coordinate -1 and value 0, so locating a coordinate that is not stored
+/// returns an empty slot that reads as zero.  The generated code locates
+/// coordinates with `taco_hash_locate`, which is mirrored by `locate`.  Since
+/// the values follow the layout of the table, a hashed mode must be the last
+/// level of a format.
+///
+/// Every table keeps at least one empty slot, which ends the probes for
+/// coordinates that are not stored.  Packing doubles the number of slots until
+/// the largest fiber fits, and kernels that run out of slots set the overflow
+/// flag, upon which the tensor is assembled again with twice as many slots.
+/// The coordinates of a fiber are not
+/// ordered, so hashed levels are either iterated on their own or located, and
+/// `makeCompressed` converts tensors with a hashed level to the compressed
+/// format.  Hashed modes with other capacities than the predefined `Hashed`
+/// are created with `ModeFormat(std::make_shared<HashedModeFormat>(W))`.
+class HashedModeFormat : public ModeFormatImpl {
+public:
+  using ModeFormatImpl::getInsertCoord;
+
+  HashedModeFormat();
+  explicit HashedModeFormat(int capacity);
+  HashedModeFormat(int capacity, bool isFull, bool isUnique, bool isZeroless);
+
+  ~HashedModeFormat() override {}
+
+  ModeFormat copy(std::vector<ModeFormat::Property> properties) const override;
+
+  ModeFunction posIterBounds(ir::Expr parentPos, Mode mode) const override;
+  ModeFunction posIterAccess(ir::Expr pos, std::vector<ir::Expr> coords,
+                             Mode mode) const override;
+
+  ModeFunction locate(ir::Expr parentPos, std::vector<ir::Expr> coords,
+                      Mode mode) const override;
+
+  ir::Stmt getInsertCoord(ir::Expr p, const std::vector<ir::Expr>& i,
+                          Mode mode) const override;
+  ir::Expr getWidth(Mode mode) const override;
+  ir::Stmt getInsertInitLevel(ir::Expr szPrev, ir::Expr sz,
+                              Mode mode) const override;
+
+  ir::Expr getAssembledSize(ir::Expr prevSize, Mode mode) const override;
+  ir::Stmt getInitCoords(ir::Expr prevSize,
+                         std::vector<AttrQueryResult> queries,
+                         Mode mode) const override;
+  ModeFunction getYieldPos(ir::Expr parentPos, std::vector<ir::Expr> coords,
+                           Mode mode) const override;
+  ir::Stmt getInsertCoord(ir::Expr parentPos, ir::Expr pos,
+                          std::vector<ir::Expr> coords,
+                          Mode mode) const override;
+
+  std::vector<ir::Expr> getArrays(ir::Expr tensor, int mode,
+                                  int level) const override;
+
+  /// Returns the least number of slots of every fiber (W).
+  int getCapacity() const;
+
+  /// Returns the slot of the fiber that starts at `begin` and has `capacity`
+  /// slots that holds `coord`, or the empty slot it would be inserted in.
+  static int locate(const int* table, int begin, int capacity, int coord);
+
+  /// Returns true if a fiber of the tables of a hashed level with `numFibers`
+  /// fibers and `capacity` slots per fiber has no empty slot left.
+  static bool hasFullFiber(const int* table, size_t numFibers, int capacity);
+
+  /// Convert the pos and crd arrays and the values of a compressed level with
+  /// `numFibers` fibers to the tables of the hashed level, and return the
+  /// number of slots of every fiber of the tables.
+  int hash(const int* pos, const int* crd, const Array& vals,
+           size_t numFibers, Array* table, Array* hashedVals) const;
+
+  /// Convert the tables and values of a hashed level with `numFibers` fibers
+  /// and `capacity` slots per fiber to the pos and crd arrays and values of a
+  /// compressed level whose fibers are sorted.
+  static void compress(const int* table, const Array& vals, size_t numFibers,
+                       int capacity, Array* pos, Array* crd,
+                       Array* compressedVals);
+
+protected:
+  ir::Expr getCapacityArray(ModePack pack) const;
+  ir::Expr getCapacity(ModePack pack) const;
+  ir::Expr getCoordArray(ModePack pack) const;
+
+  bool equals(const ModeFormatImpl& other) const override;
+
+private:
+  int capacity;
+};
+
+/// The number of slots of every fiber of the predefined hashed mode format.
+static const int DEFAULT_HASH_CAPACITY = 1024;
+
+}
+
+#endif
@@ -153,6 +153,25 @@ public:
                                      std::vector<ir::Expr> coords,
                                      Mode mode) const;
 
+  /// The distance between consecutive positions of a fiber, which position
+  /// iteration advances by.  The positions of most levels are contiguous, so
+  /// the default stride is 1.
+  virtual ir::Expr posIterStride(Mode mode) const;
+
+  /// The array of 64-bit words whose bits mark the positions of the level
+  /// that hold a coordinate, where bit k of word w marks position 64w + k, or
+  /// an undefined expression if the level has no such array.  Loops over
+  /// levels with bitmaps visit the marked positions word by word.
+  virtual ir::Expr posIterBitmap(Mode mode) const;
+
+  /// The fiber in slot `slot` of a level that interleaves the positions of
+  /// slices of posIterStride() fibers, where slot s * stride + c is lane c of
+  /// slice s and the level has `numFibers` fibers, or an undefined expression
+  /// if the level has no slices.  Loops over sliced levels visit the lanes of
+  /// every column of a slice together.
+  virtual ir::Expr posIterSliceFiber(ir::Expr slot, ir::Expr numFibers,
+                                     Mode mode) const;
+
 
   /// The locate capability locates the position of a coordinate (result[0])
   /// and reports if the coordinate could not be found (result[1]).
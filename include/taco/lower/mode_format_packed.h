@@ -0,0 +1,61 @@
+#ifndef TACO_MODE_FORMAT_PACKED_H
+#define TACO_MODE_FORMAT_PACKED_H
+
+#include "taco/lower/mode_format_impl.h"
+#include "taco/storage/array.h"
+
+namespace taco {
+
+/// A compressed mode whose coordinate array is stored bit-packed to reduce
+/// the memory traffic of sparse kernels. The coordinates are split into blocks
+/// of PACKED_BLOCK_SIZE, and each coordinate is stored as its difference from
+/// the smallest coordinate in its block, using the fewest bits that fit the
+/// largest difference in the block. The generated code decodes coordinates
+/// with `taco_packed_crd`, so positions can still be accessed in any order.
+///
+/// The packed coordinate array has the layout
+///   [H, base_0, offset_0, ..., base_{n-1}, offset_{n-1}, 0, offset_n, words..]
+/// where H = 2n+3 is the index of the first word, base_b is the smallest
+/// coordinate of block b and offset_b is the index of its first word relative
+/// to H. The bit width of block b is (offset_{b+1} - offset_b) / 4. Two words
+/// of padding follow the words so a coordinate can be read with a 64-bit load,
+/// even from a last block of width zero.
+///
+/// Packed modes have no assembly capabilities, so they can be packed from
+/// coordinates and read by kernels but cannot be the result of a computation.
+class PackedModeFormat : public ModeFormatImpl {
+public:
+  PackedModeFormat();
+  PackedModeFormat(bool isFull, bool isOrdered, bool isUnique,
+                   bool isZeroless);
+
+  ~PackedModeFormat() override {}
+
+  ModeFormat copy(std::vector<ModeFormat::Property> properties) const override;
+
+  ModeFunction posIterBounds(ir::Expr parentPos, Mode mode) const override;
+  ModeFunction posIterAccess(ir::Expr pos, std::vector<ir::Expr> coords,
+                             Mode mode) const override;
+
+  ModeFunction coordBounds(ir::Expr parentPos, Mode mode) const override;
+
+  std::vector<ir::Expr> getArrays(ir::Expr tensor, int mode,
+                                  int level) const override;
+
+  /// Pack a coordinate array into the packed layout.
+  static Array packCoordinates(const int* crd, size_t size);
+
+  /// Decode the coordinate at position `pos` of a packed coordinate array.
+  static int unpackCoordinate(const int* packed, size_t pos);
+
+protected:
+  ir::Expr getPosArray(ModePack pack) const;
+  ir::Expr getCoordArray(ModePack pack) const;
+};
+
+/// The number of coordinates that share a base and a bit width.
+static const int PACKED_BLOCK_SIZE = 128;
+
+}
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef TACO_MODE_FORMAT_SLICED_H
+#define TACO_MODE_FORMAT_SLICED_H
+
+#include "taco/lower/mode_format_impl.h"
+#include "taco/storage/array.h"
+
+namespace taco {
+
+/// A sliced ELLPACK (SELL-C-σ) mode.  The fibers of the level, e.g. the rows
+/// of a matrix, are grouped into slices of C fibers.  Every fiber of a slice
+/// is padded to the length of the longest one, and the fibers are interleaved
+/// so that their k-th positions are adjacent, which gives kernels that process
+/// the C fibers of a slice together unit-stride loads.  C should match the
+/// SIMD width of the target, e.g. 8 doubles with AVX-512.  To reduce padding,
+/// the fibers are sorted by decreasing length within windows of σ fibers
+/// before they are sliced, so fibers of similar length share a slice.  The
+/// fibers of a slice are ordered by decreasing length too, so the first fiber
+/// of a slice is as long as the slice.
+///
+/// The level has two index arrays.  The first holds the physical positions
+/// [begin, end) of every fiber, followed by the number of physical positions
+/// of the level and the fiber in every slot of the slices, where slot sC + c
+/// is the c-th fiber of slice s.  The positions of a fiber are begin,
+/// begin + C, ..., so position iteration visits a fiber with stride C and
+/// never visits padding.  The second array holds the coordinates, and padding
+/// positions have coordinate 0 and value 0.  Since the values follow the
+/// layout of the level, a sliced mode must be the last level of a format.
+///
+/// Loops over the rows of a dense level whose fibers are sliced, such as the
+/// rows of a sparse matrix-vector product, are lowered to loops over the
+/// slices.  Every column of a slice is visited by an inner loop over its C
+/// fibers, whose positions are adjacent, and the padding adds zeros.
+///
+/// Sliced modes have no assembly capabilities, so they can be packed from
+/// coordinates and read by kernels but cannot be the result of a computation.
+/// Sliced modes with other slice heights and sort windows than the predefined
+/// `Sliced` are created with `ModeFormat(std::make_shared<SlicedModeFormat>(C,
+/// σ))`.
+class SlicedModeFormat : public ModeFormatImpl {
+public:
+  SlicedModeFormat();
+  SlicedModeFormat(int sliceHeight, int sortWindow);
+  SlicedModeFormat(int sliceHeight, int sortWindow, bool isFull,
+                   bool isOrdered, bool isUnique, bool isZeroless);
+
+  ~SlicedModeFormat() override {}
+
+  ModeFormat copy(std::vector<ModeFormat::Property> properties) const override;
+
+  ModeFunction posIterBounds(ir::Expr parentPos, Mode mode) const override;
+  ModeFunction posIterAccess(ir::Expr pos, std::vector<ir::Expr> coords,
+                             Mode mode) const override;
+  ir::Expr posIterStride(Mode mode) const override;
+  ir::Expr posIterSliceFiber(ir::Expr slot, ir::Expr numFibers,
+                             Mode mode) const override;
+
+  ModeFunction coordBounds(ir::Expr parentPos, Mode mode) const override;
+
+  std::vector<ir::Expr> getArrays(ir::Expr tensor, int mode,
+                                  int level) const override;
+
+  /// Returns the number of fibers in a slice (C).
+  int getSliceHeight() const;
+
+  /// Returns the number of fibers that are sorted by length together (σ).
+  int getSortWindow() const;
+
+  /// Convert the pos and crd arrays and the values of a compressed level with
+  /// `numFibers` fibers to the layout of the sliced level.
+  void slice(const int* pos, const int* crd, const Array& vals,
+             size_t numFibers, Array* slicedPos, Array* slicedCrd,
+             Array* slicedVals) const;
+
+protected:
+  ir::Expr getPosArray(ModePack pack) const;
+  ir::Expr getCoordArray(ModePack pack) const;
+
+  bool equals(const ModeFormatImpl& other) const override;
+
+private:
+  int sliceHeight;
+  int sortWindow;
+};
+
+/// The slice height and sort window of the predefined sliced mode format.
+static const int DEFAULT_SLICE_HEIGHT = 8;
+static const int DEFAULT_SORT_WINDOW = 256;
+
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef TACO_STORAGE_ALLOCATOR_H
+#define TACO_STORAGE_ALLOCATOR_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "taco/util/uncopyable.h"
+
+namespace taco {
+
+/// An allocator provides the memory of the index and value arrays that
+/// generated kernels create for a result.  Allocators are attached to tensor
+/// storage with `TensorStorage::setAllocator`, and arrays allocated through
+/// them are returned with `deallocate` when the storage releases them.
+class Allocator : private util::Uncopyable {
+public:
+  virtual ~Allocator();
+
+  /// Allocate `size` bytes, which are zeroed if `clear` is true.
+  virtual void* allocate(size_t size, bool clear) = 0;
+
+  /// Resize an allocation to `size` bytes, preserving the first `oldSize`
+  /// bytes.  An `oldSize` of zero means the old size is unknown.  The default
+  /// implementation allocates a new block, copies and deallocates the old one.
+  virtual void* reallocate(void* ptr, size_t oldSize, size_t size);
+
+  /// Return memory obtained from `allocate` or `reallocate`.
+  virtual void deallocate(void* ptr) = 0;
+
+protected:
+  Allocator() = default;
+};
+
+/// An allocator that uses the C allocation functions.
+class MallocAllocator : public Allocator {
+public:
+  void* allocate(size_t size, bool clear) override;
+  void* reallocate(void* ptr, size_t oldSize, size_t size) override;
+  void deallocate(void* ptr) override;
+};
+
+/// An allocator that aligns large allocations to huge pages and asks the
+/// operating system to back them with transparent huge pages, which reduces
+/// TLB misses of kernels that stream through large arrays.
+class HugePageAllocator : public Allocator {
+public:
+  void* allocate(size_t size, bool clear) override;
+  void deallocate(void* ptr) override;
+};
+
+/// An allocator that controls on which NUMA nodes the pages of large arrays
+/// are placed.  Large arrays are mapped directly from the operating system, so
+/// their pages are zero and are not placed until they are first written.
+/// `Interleave` spreads the pages round-robin over all memory nodes, which
+/// gives kernels that stream through an array the bandwidth of every socket.
+/// `FirstTouch` places each page on the node of the thread that first writes
+/// it.  Zeroed arrays are touched by a statically scheduled parallel loop,
+/// which matches the partitioning of statically scheduled parallel kernels.
+/// Small arrays and platforms without NUMA support use the C allocator.
+class NumaAllocator : public Allocator {
+public:
+  enum Policy {Interleave, FirstTouch};
+
+  NumaAllocator(Policy policy = Interleave);
+
+  void* allocate(size_t size, bool clear) override;
+  void* reallocate(void* ptr, size_t oldSize, size_t size) override;
+  void deallocate(void* ptr) override;
+
+  Policy getPolicy() const;
+
+  /// Returns the number of online NUMA nodes, which is one on platforms
+  /// without NUMA support.
+  static int getNumNodes();
+
+private:
+  Policy policy;
+};
+
+/// An allocator that caches the blocks it hands out.  Allocations are rounded
+/// up to a power of two and returned blocks are kept on a free list per size,
+/// so a result that is recomputed with the same sizes reuses the blocks of the
+/// previous computation instead of calling the backing allocator.  Cached
+/// blocks are returned to the backing allocator by `trim` and on destruction,
+/// so every block must be deallocated before the arena is destroyed.
+class ArenaAllocator : public Allocator {
+public:
+  /// Create an arena that obtains its blocks from `backing`.
+  ArenaAllocator(std::shared_ptr<Allocator> backing =
+                     std::make_shared<MallocAllocator>());
+  ~ArenaAllocator() override;
+
+  void* allocate(size_t size, bool clear) override;
+  void* reallocate(void* ptr, size_t oldSize, size_t size) override;
+  void deallocate(void* ptr) override;
+
+  /// Return every cached block to the backing allocator.
+  void trim();
+
+  /// Returns the number of blocks obtained from the backing allocator.
+  size_t getNumBackingAllocations() const;
+
+private:
+  std::shared_ptr<Allocator> backing;
+  std::vector<std::vector<void*>> freeBlocks;
+  size_t numBackingAllocations = 0;
+  mutable std::mutex freeBlocksMutex;
+};
+
+}
+#endif
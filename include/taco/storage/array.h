@@ -1,6 +1,7 @@
 #ifndef TACO_STORAGE_ARRAY_H
 #define TACO_STORAGE_ARRAY_H
 
+#include <functional>
 #include <memory>
 #include <ostream>
 #include <taco/type.h>
@@ -24,6 +25,11 @@ public:
   /// Construct an array of elements of the given type.
   Array(Datatype type, void* data, size_t size, Policy policy=Free);
 
+  /// Construct an array of elements of the given type whose data is reclaimed
+  /// by calling `deleter`.
+  Array(Datatype type, void* data, size_t size,
+        std::function<void(void*)> deleter);
+
   /// Returns the type of the array elements
   const Datatype& getType() const;
 
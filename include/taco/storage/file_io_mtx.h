@@ -6,6 +6,7 @@
 #include <string>
 
 #include "taco/format.h"
+#include "taco/storage/pack.h"
 
 namespace taco {
 class TensorBase;
@@ -25,6 +26,17 @@ TensorBase readMTX(std::istream& stream, const ModeFormat& modetype,
 /// Read an mtx matrix from a stream.
 TensorBase readMTX(std::istream& stream, const Format& format, bool pack=true);
 
+/// Read an mtx matrix from a file, packing it into the format while it is
+/// being parsed. At most `chunkSize` components are buffered in memory and
+/// input that is not sorted is sorted externally on disk (see `StreamPacker`).
+TensorBase readMTXStreaming(std::string filename, const Format& format,
+                            size_t chunkSize=DEFAULT_STREAM_CHUNK_SIZE);
+
+/// Read an mtx matrix from a stream, packing it into the format while it is
+/// being parsed.
+TensorBase readMTXStreaming(std::istream& stream, const Format& format,
+                            size_t chunkSize=DEFAULT_STREAM_CHUNK_SIZE);
+
 TensorBase readSparse(std::istream& stream, const ModeFormat& modetype, 
                       bool symm = false);
 TensorBase readDense(std::istream& stream, const ModeFormat& modetype, 
@@ -6,6 +6,7 @@
 #include <string>
 
 #include "taco/format.h"
+#include "taco/storage/pack.h"
 
 namespace taco {
 class TensorBase;
@@ -25,6 +26,17 @@ TensorBase readTNS(std::istream& stream, const ModeFormat& modetype,
 /// Read a tns tensor from a stream.
 TensorBase readTNS(std::istream& stream, const Format& format, bool pack=true);
 
+/// Read a tns tensor from a file, packing it into the format while it is being
+/// parsed. At most `chunkSize` components are buffered in memory and input
+/// that is not sorted is sorted externally on disk (see `StreamPacker`).
+TensorBase readTNSStreaming(std::string filename, const Format& format,
+                            size_t chunkSize=DEFAULT_STREAM_CHUNK_SIZE);
+
+/// Read a tns tensor from a stream, packing it into the format while it is
+/// being parsed.
+TensorBase readTNSStreaming(std::istream& stream, const Format& format,
+                            size_t chunkSize=DEFAULT_STREAM_CHUNK_SIZE);
+
 /// Write a tns tensor to a file.
 void writeTNS(std::string filename, const TensorBase& tensor);
 
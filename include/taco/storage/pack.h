@@ -7,6 +7,7 @@
 #define TACO_STORAGE_PACK_H
 
 #include <climits>
+#include <memory>
 #include <vector>
 
 #include "taco/type.h"
@@ -18,6 +19,7 @@
 namespace taco {
 
 class Literal;
+class TensorBase;
 
 namespace ir {
 class Stmt;
@@ -51,5 +53,43 @@ TensorStorage pack(std::vector<int> dimensions, Format format,
   return pack(type<V>(), dimensions, format, coordinates, values.data(), fill);
 }
 
+/// The default number of components a stream packer buffers in memory.
+static const size_t DEFAULT_STREAM_CHUNK_SIZE = 1 << 22;
+
+/// A stream packer packs a stream of (double-valued) tensor components into a
+/// tensor with a dense/compressed format while the components are being read,
+/// so that the coordinates never have to be held in memory all at once.
+///
+/// Components are buffered in chunks of at most `chunkSize` components, and
+/// each chunk is sorted in the storage order of the format. As long as chunks
+/// arrive in order (the input is sorted or chunk-sorted) they are packed
+/// directly into the index and value arrays of the result. Otherwise sorted
+/// chunks are spilled as runs to the temporary directory and the runs are
+/// merged into the result when the stream ends, at most 64 at a time (more runs
+/// are merged in several passes). Duplicates are summed.
+class StreamPacker {
+public:
+  /// Create a stream packer for a tensor with the given dimensions and format.
+  /// Dimensions that are zero are inferred from the largest coordinate.
+  StreamPacker(const std::vector<int>& dimensions, const Format& format,
+               size_t chunkSize=DEFAULT_STREAM_CHUNK_SIZE);
+
+  /// Returns true if the stream packer can pack into the format.
+  static bool supports(const Format& format);
+
+  /// Add a component.  The (zero-based) coordinate is given in mode order.
+  void insert(const int* coordinate, double value);
+
+  /// Pack all remaining components and return the packed tensor.
+  TensorBase finalize();
+
+  /// Returns the number of sorted runs that were spilled to disk.
+  size_t getNumSpilledRuns() const;
+
+private:
+  struct Content;
+  std::shared_ptr<Content> content;
+};
+
 }
 #endif
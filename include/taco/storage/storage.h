@@ -7,6 +7,7 @@
 #include "taco/format.h"
 #include "taco/storage/index.h"
 #include "taco/storage/array.h"
+#include "taco/storage/allocator.h"
 #include "taco/storage/typed_vector.h"
 #include "taco/storage/typed_index.h"
 
@@ -70,6 +71,21 @@ public:
   /// Set the tensor component value array.
   void setValues(const Array& values);
 
+  /// Set the allocator that generated kernels use to allocate the index and
+  /// value arrays of the storage when it is the result of a computation.
+  void setAllocator(std::shared_ptr<Allocator> allocator);
+
+  /// Returns the allocator of the storage, or nullptr if kernels allocate its
+  /// arrays with malloc.
+  std::shared_ptr<Allocator> getAllocator() const;
+
+  /// Wrap an array that a kernel wrote to the taco_tensor_t of the storage.
+  /// Arrays that the storage already holds are shared, arrays allocated by
+  /// the storage allocator are returned to it when released, and other arrays
+  /// are released according to `policy`.
+  Array adoptArray(Datatype type, void* data, size_t size,
+                   Array::Policy policy) const;
+
 
 private:
   struct Content;
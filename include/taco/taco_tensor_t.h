@@ -6,10 +6,21 @@
 #ifndef TACO_TENSOR_T_DEFINED
 #define TACO_TENSOR_T_DEFINED
 
+#include <stddef.h>
 #include <stdint.h>
 
 typedef enum { taco_mode_dense, taco_mode_sparse } taco_mode_t;
 
+/// Allocates the index and value arrays that generated code creates for a
+/// result.  `allocate` returns `size` bytes, zeroed if `clear` is nonzero, and
+/// `reallocate` resizes an allocation while preserving its first `old_size`
+/// bytes.  Generated code uses malloc and realloc if a tensor has no allocator.
+typedef struct taco_allocator_t {
+  void* (*allocate)(void* context, size_t size, int clear);
+  void* (*reallocate)(void* context, void* ptr, size_t old_size, size_t size);
+  void*  context;
+} taco_allocator_t;
+
 typedef struct taco_tensor_t {
   int32_t      order;         // tensor order (number of modes)
   int32_t*     dimensions;    // tensor dimensions
@@ -20,6 +31,7 @@ typedef struct taco_tensor_t {
   uint8_t*     vals;          // tensor values
   uint8_t*     fill_value;    // tensor fill value
   int32_t      vals_size;     // values array size
+  taco_allocator_t* allocator; // result array allocator (NULL uses malloc)
 } taco_tensor_t;
 
 taco_tensor_t *init_taco_tensor_t(int32_t order, int32_t csize,
@@ -11,10 +11,12 @@
 
 #include "taco/type.h"
 #include "taco/format.h"
+#include "taco/autoscheduler.h"
 
 #include "taco/codegen/module.h"
 
 #include "taco/index_notation/index_notation.h"
+#include "taco/index_notation/kernel.h"
 
 #include "taco/storage/storage.h"
 #include "taco/storage/index.h"
@@ -26,6 +28,7 @@
 #include "taco/error/error_messages.h"
 #include "taco/util/name_generator.h"
 #include "taco/util/strings.h"
+#include "taco/util/uncopyable.h"
 
 
 namespace taco {
@@ -118,6 +121,23 @@ public:
   /// to the format of the tensor.
   TensorStorage& getStorage();
 
+  /// Set the allocator that kernels use to allocate the arrays of the tensor
+  /// when it is computed.  An `ArenaAllocator` lets a tensor that is computed
+  /// repeatedly reuse the memory of its previous result.
+  void setAllocator(std::shared_ptr<Allocator> allocator);
+
+  /// Returns the allocator of the tensor, or nullptr if it has none.
+  std::shared_ptr<Allocator> getAllocator() const;
+
+  /// Set the autoscheduler that picks the schedule of the tensor's kernel when
+  /// it is compiled from its expression, in place of the default heuristics.
+  /// Pending operands are then computed before the tensor rather than fused
+  /// into its kernel, since the candidate schedules are timed on them.
+  void setAutoscheduler(std::shared_ptr<Autoscheduler> autoscheduler);
+
+  /// Returns the autoscheduler of the tensor, or nullptr if it has none.
+  std::shared_ptr<Autoscheduler> getAutoscheduler() const;
+
   /// Returns the tensor var for this tensor.
   const TensorVar& getTensorVar() const;
 
@@ -127,6 +147,11 @@ public:
   /// Get the expression to be evaluated when calling compute or assemble.
   Assignment getAssignment() const;
 
+  /// Get the assignment that the compiled kernel computes.  This is the
+  /// tensor's assignment with the assignments of operands that had not been
+  /// computed when the tensor was compiled inlined into it.
+  Assignment getKernelAssignment() const;
+
   /// Reserve space for `numCoordinates` additional coordinates.
   void reserve(size_t numCoordinates);
 
@@ -427,7 +452,12 @@ public:
   /// Emit hydride IR code for synthesis in Rosette, returning the path.
   std::string emitHydride();
 
-  /// Assemble the tensor storage, including index and value arrays.
+  /// Assemble the tensor storage, including index and value arrays.  This is
+  /// the symbolic phase of a computation: if the tensor was last assembled by
+  /// the same kernel from the same operand index arrays, its sparsity pattern
+  /// is unchanged and the existing storage is kept.  Operands whose values
+  /// change but whose index arrays are kept, for instance by `recompute`, thus
+  /// only cost the result a numeric `compute`.
   void assemble();
 
   /// Compute the given expression and put the values in the tensor storage.
@@ -436,6 +466,21 @@ public:
   /// Compile, assemble and compute as needed.
   void evaluate();
 
+  /// Compute the tensor again into its existing index and value arrays,
+  /// without assembling it.  The tensor must have been assembled by its
+  /// current kernel, and the sparsity patterns of the operands must not have
+  /// changed since then, so iterative methods that only change operand values
+  /// pay only for the arithmetic.
+  void recompute();
+
+  /// Bind the compiled kernel to the storage of this tensor and its operands.
+  /// The returned kernel assembles and computes the tensor without the
+  /// bookkeeping of `assemble` and `compute`, for expressions that are
+  /// evaluated many times.  Operands are synchronized once, when the kernel is
+  /// prepared, and the tensor is from then on computed only by calling the
+  /// prepared kernel.
+  PreparedKernel prepare();
+
   /// True if the Tensor needs to be packed.
   bool needsPack();
 
@@ -500,6 +545,14 @@ public:
   friend std::ostream& operator<<(std::ostream&, const TensorBase&);
   friend std::ostream& operator<<(std::ostream&, TensorBase&);
 
+  /// Compute several tensors with one kernel (see `evaluate` below).
+  friend void evaluate(const std::vector<TensorBase>& tensors);
+
+  /// Convert a tensor with a hashed or bitmap last level (see
+  /// `makeCompressed` below).
+  friend TensorBase makeCompressed(const std::string& name,
+                                   const TensorBase& tensor);
+
   friend struct AccessTensorNode;
   std::vector<TensorBase> getDependentTensors();
 private:
@@ -520,6 +573,7 @@ private:
 
   void addDependentTensor(TensorBase& tensor);
   void removeDependentTensor(TensorBase& tensor);
+  void addKernelDependencies();
   void syncDependentTensors();
 
   void syncValues();
@@ -870,16 +924,94 @@ void getCSCArrays(const TensorBase& tensor,
   *vals   = static_cast<T*>(storage.getValues().getData());
 }
 
-
 /// Pack the operands in the given expression.
 void packOperands(const TensorBase& tensor);
 
+/// Compile, assemble and compute the given tensors with a single kernel.  The
+/// assignments of the tensors are merged so that loops over the same index
+/// variables are shared, which lets the tensors be computed in one pass over
+/// operands they have in common.  No tensor may be an operand of another.
+void evaluate(const std::vector<TensorBase>& tensors);
+
 /// Iterate over the typed values of a TensorBase.
 template <typename CType>
 Tensor<CType> iterate(const TensorBase& tensor) {
   return Tensor<CType>(tensor);
 }
 
+/// Factory function to construct a blocked copy of an order-N tensor, in the
+/// format `Blocked(blockFormat)`.  Component (b_1, ..., b_N, e_1, ..., e_N) of
+/// the copy is component (b_1 * s_1 + e_1, ..., b_N * s_N + e_N) of the
+/// tensor, where s_1, ..., s_N are the block sizes, and every block with a
+/// nonzero is stored whole.  The last blocks of modes whose dimension is not
+/// a multiple of the block size are padded with zeros.  Since the block sizes
+/// are part of the type of the copy, kernels iterate the components of small
+/// blocks with loops of constant size, which the C compiler can unroll and
+/// vectorize.
+template<typename CType>
+TensorBase makeBlocked(const std::string& name, const TensorBase& tensor,
+                       const std::vector<int>& blockSizes,
+                       const Format& blockFormat) {
+  const int order = tensor.getOrder();
+  taco_uassert((int)blockSizes.size() == order)
+      << "The tensor " << tensor.getName() << " needs one block size per mode";
+  taco_uassert(blockFormat.getOrder() == order)
+      << "The block format does not have one mode per mode of "
+      << tensor.getName();
+  std::vector<int> dimensions(2 * order);
+  for (int mode = 0; mode < order; mode++) {
+    taco_uassert(blockSizes[mode] > 0) << "Block sizes must be positive";
+    dimensions[mode] = (tensor.getDimension(mode) + blockSizes[mode] - 1) /
+                       blockSizes[mode];
+    dimensions[order + mode] = blockSizes[mode];
+  }
+  Tensor<CType> blocked(name, dimensions, Blocked(blockFormat));
+  std::vector<int> coordinate(2 * order);
+  for (auto& value : iterate<CType>(tensor)) {
+    for (int mode = 0; mode < order; mode++) {
+      coordinate[mode] = value.first[mode] / blockSizes[mode];
+      coordinate[order + mode] = value.first[mode] % blockSizes[mode];
+    }
+    blocked.insert(coordinate, value.second);
+  }
+  blocked.pack();
+  return std::move(blocked);
+}
+
+/// Factory function to construct the order-N tensor with the given
+/// dimensions and format that a blocked tensor of order 2N stores, dropping
+/// the padding of its last blocks.
+template<typename CType>
+TensorBase makeUnblocked(const std::string& name, const TensorBase& blocked,
+                         const std::vector<int>& dimensions,
+                         const Format& format) {
+  const int order = (int)dimensions.size();
+  taco_uassert(blocked.getOrder() == 2 * order)
+      << "The blocked tensor " << blocked.getName() << " does not have two "
+      << "modes per dimension";
+  Tensor<CType> tensor(name, dimensions, format);
+  std::vector<int> coordinate(order);
+  for (auto& value : iterate<CType>(blocked)) {
+    bool padding = false;
+    for (int mode = 0; mode < order; mode++) {
+      coordinate[mode] = value.first[mode] * blocked.getDimension(order + mode) +
+                         value.first[order + mode];
+      padding |= coordinate[mode] >= dimensions[mode];
+    }
+    if (!padding && value.second != CType(0)) {
+      tensor.insert(coordinate, value.second);
+    }
+  }
+  tensor.pack();
+  return std::move(tensor);
+}
+
+/// Factory function to construct a copy of a tensor whose last level is
+/// hashed or a bitmap, in the same format except that the last level is
+/// compressed and its fibers are sorted.  Kernels that insert into hashed or
+/// bitmap results finish with this pass when they need the compressed format.
+TensorBase makeCompressed(const std::string& name, const TensorBase& tensor);
+
 // ------------------------------------------------------------
 // TensorBase::Content
 // ------------------------------------------------------------
@@ -899,6 +1031,7 @@ struct TensorBase::Content {
   TensorStorage      storage;
   TensorVar          tensorVar;
   Assignment         assignment;
+  Assignment         kernelAssignment;
 
   size_t             allocSize;
   size_t             valuesSize;
@@ -907,6 +1040,11 @@ struct TensorBase::Content {
   ir::Stmt           computeFunc;
   bool               assembleWhileCompute;
   std::shared_ptr<ir::Module> module;
+  std::shared_ptr<Autoscheduler> autoscheduler;
+  // The module whose assemble function produced the index of the storage,
+  // and the operand indices it was assembled from.
+  std::shared_ptr<ir::Module> assembledModule;
+  std::vector<Index> assembledIndices;
 
   size_t             coordinateBufferUsed;
   size_t             coordinateSize;
@@ -918,6 +1056,9 @@ struct TensorBase::Content {
   bool               needsAssemble;
   bool               needsCompute;
   std::vector<std::weak_ptr<TensorBase::Content>> dependentTensors;
+  // Guards dependentTensors, since operands may be shared by tensors that are
+  // evaluated by different threads.
+  std::mutex         dependentTensorsMutex;
   unsigned int       uniqueId;
 
   Content(std::string name, Datatype dataType, const std::vector<int>& dimensions,
@@ -1339,5 +1480,29 @@ void taco_set_num_threads(int num_threads);
 /// computations. This will be replaced by a scheduling language in the future.
 int taco_get_num_threads();
 
+/// Overrides the parallel schedule and the number of threads of the tensor
+/// computations run by the calling thread, for as long as the object is alive.
+/// Other threads are not affected, so threads that evaluate independent
+/// tensors concurrently can each pick their own settings.  Tensors may be
+/// evaluated concurrently as long as no thread writes a tensor that another
+/// thread reads or writes; shared operands should be packed or computed before
+/// they are read by several threads.
+class ScopedParallelSettings : private util::Uncopyable {
+public:
+  ScopedParallelSettings(int numThreads,
+                         ParallelSchedule sched = ParallelSchedule::Static,
+                         int chunkSize = 0);
+  ~ScopedParallelSettings();
+
+private:
+  int numThreads;
+  ParallelSchedule sched;
+  int chunkSize;
+  const ScopedParallelSettings* previous;
+
+  friend void taco_get_parallel_schedule(ParallelSchedule*, int*);
+  friend int taco_get_num_threads();
+};
+
 }
 #endif
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <cstring>
+#include <mutex>
+#include <vector>
 #include <unistd.h>
 
 #include "taco/error.h"
@@ -11,6 +13,7 @@ namespace taco {
 namespace util {
 std::string getFromEnv(std::string flag, std::string dflt);
 std::string getTmpdir();
+std::vector<size_t> getCacheSizes();
 extern std::string cachedtmpdir;
 extern void cachedtmpdirCleanup(void);
 
@@ -24,6 +27,8 @@ inline std::string getFromEnv(std::string flag, std::string dflt) {
 }
 
 inline std::string getTmpdir() {
+  static std::mutex tmpdirMutex;
+  std::lock_guard<std::mutex> lock(tmpdirMutex);
   if (cachedtmpdir == ""){
     // use posix logic for finding a temp dir
     auto tmpdir = getFromEnv("TMPDIR", "/tmp/");
@@ -1,6 +1,7 @@
 #ifndef TACO_UTIL_INTRUSIVE_PTR_H
 #define TACO_UTIL_INTRUSIVE_PTR_H
 
+#include <atomic>
 #include <iostream>
 
 namespace taco {
@@ -130,12 +131,20 @@ public:
   }
 };
 
+/// The reference count of a Manageable object is atomic, so objects can be
+/// shared by threads.  A copy of an object starts without references.
 template <class Data>
 class Manageable {
+public:
+  Manageable() = default;
+  Manageable(const Manageable&) {}
+  Manageable& operator=(const Manageable&) { return *this; }
+
+private:
   friend void acquire(const Data *data) { ++data->ref; }
   friend void release(const Data *data) { if (--data->ref == 0) delete data; }
 
-  mutable long ref = 0;
+  mutable std::atomic<long> ref{0};
 };
 
 }} // namespace simit::util
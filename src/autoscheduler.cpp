@@ -0,0 +1,347 @@
+#include "taco/autoscheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <sstream>
+
+#include "taco/tensor.h"
+#include "taco/error.h"
+#include "taco/index_notation/cost_model.h"
+#include "taco/index_notation/index_notation_nodes.h"
+#include "taco/index_notation/index_notation_rewriter.h"
+#include "taco/index_notation/index_notation_visitor.h"
+#include "taco/index_notation/transformations.h"
+#include "taco/index_notation/kernel.h"
+
+using namespace std;
+
+namespace taco {
+
+// Loop nests deeper than this are only scheduled in their given order, since
+// the number of loop orders grows factorially.
+static const size_t MAX_REORDERED_LOOPS = 4;
+
+// The number of positions that each thread claims at a time in fused loops
+// parallelized over the positions of a sparse operand.
+static const size_t POSITION_BLOCK_SIZE = 2048;
+
+/// Returns the index variables of the directly nested foralls that the
+/// statement starts with.
+static vector<IndexVar> getLoopOrder(IndexStmt stmt) {
+  vector<IndexVar> order;
+  while (isa<Forall>(stmt)) {
+    Forall forall = to<Forall>(stmt);
+    order.push_back(forall.getIndexVar());
+    stmt = forall.getStmt();
+  }
+  return order;
+}
+
+static vector<Access> getAccesses(IndexStmt stmt) {
+  vector<Access> accesses;
+  match(stmt,
+    function<void(const AccessNode*)>([&](const AccessNode* op) {
+      accesses.push_back(Access(op));
+    })
+  );
+  return accesses;
+}
+
+/// Returns the index variables of an access in the order of its levels.
+static vector<IndexVar> getLevelVars(const Access& access) {
+  const vector<IndexVar>& indexVars = access.getIndexVars();
+  const Format& format = access.getTensorVar().getFormat();
+  vector<IndexVar> levelVars;
+  for (int mode : format.getModeOrdering()) {
+    levelVars.push_back(indexVars[mode]);
+  }
+  return levelVars;
+}
+
+/// Returns true if the loop order visits every level that cannot be accessed
+/// randomly after the levels above it, which the lowering machinery requires.
+static bool isConcordant(IndexStmt stmt, const vector<IndexVar>& order) {
+  auto position = [&](const IndexVar& var) {
+    return std::find(order.begin(), order.end(), var) - order.begin();
+  };
+  for (const Access& access : getAccesses(stmt)) {
+    const Format& format = access.getTensorVar().getFormat();
+    if (format.getOrder() != (int)access.getIndexVars().size()) {
+      continue;
+    }
+    const vector<IndexVar> levelVars = getLevelVars(access);
+    for (size_t level = 1; level < levelVars.size(); level++) {
+      if (format.getModeFormats()[level].hasLocate()) {
+        continue;
+      }
+      for (size_t parent = 0; parent < level; parent++) {
+        if (position(levelVars[parent]) > position(levelVars[level])) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/// Returns the statement with its outer loops fused and parallelized over the
+/// positions of an operand that stores both of them, or an undefined statement
+/// if no operand does.
+static IndexStmt parallelizeFusedPositions(IndexStmt stmt,
+                                           const vector<IndexVar>& order) {
+  const vector<TensorVar> results = getResults(stmt);
+  for (const Access& access : getAccesses(stmt)) {
+    const TensorVar& tensor = access.getTensorVar();
+    if (util::contains(results, tensor) || tensor.getOrder() < 2) {
+      continue;
+    }
+    const vector<IndexVar> levelVars = getLevelVars(access);
+    if (levelVars[0] != order[0] || levelVars[1] != order[1] ||
+        tensor.getFormat().getModeFormats()[1].hasLocate()) {
+      continue;
+    }
+    IndexVar fused, pos, block, inner;
+    return stmt.fuse(order[0], order[1], fused)
+               .pos(fused, pos, access)
+               .split(pos, block, inner, POSITION_BLOCK_SIZE)
+               .parallelize(block, ParallelUnit::CPUThread,
+                            OutputRaceStrategy::Atomics);
+  }
+  return IndexStmt();
+}
+
+vector<IndexStmt> Autoscheduler::getCandidates(IndexStmt stmt) const {
+  vector<IndexStmt> candidates;
+  const vector<IndexVar> order = getLoopOrder(stmt);
+
+  vector<pair<IndexStmt,IndexVar>> ordered;
+  if (!order.empty()) {
+    ordered.push_back({stmt, order[0]});
+  }
+  if (order.size() > 1 && order.size() <= MAX_REORDERED_LOOPS) {
+    // Permute loop positions rather than index variables, so that the
+    // candidates do not depend on the names of the variables
+    vector<size_t> permutation(order.size());
+    std::iota(permutation.begin(), permutation.end(), 0);
+    while (std::next_permutation(permutation.begin(), permutation.end())) {
+      vector<IndexVar> reordered;
+      for (size_t position : permutation) {
+        reordered.push_back(order[position]);
+      }
+      if (!isConcordant(stmt, reordered)) {
+        continue;
+      }
+      IndexStmt reorderedStmt = Reorder(reordered).apply(stmt);
+      if (reorderedStmt.defined()) {
+        ordered.push_back({reorderedStmt, reordered[0]});
+      }
+    }
+  }
+
+  candidates.push_back(stmt);
+  for (auto& orderedStmt : ordered) {
+    if (orderedStmt.first != stmt) {
+      candidates.push_back(orderedStmt.first);
+    }
+    for (ParallelUnit unit : {ParallelUnit::CPUThread,
+                              ParallelUnit::CPUThreadBalanced}) {
+      IndexStmt parallelized =
+          Parallelize(orderedStmt.second, unit, OutputRaceStrategy::NoRaces)
+              .apply(orderedStmt.first);
+      if (parallelized.defined()) {
+        candidates.push_back(parallelized);
+      }
+    }
+  }
+
+  if (order.size() > 1) {
+    try {
+      IndexStmt fused = parallelizeFusedPositions(stmt, order);
+      if (fused.defined()) {
+        candidates.push_back(fused);
+      }
+    } catch (const TacoException&) {
+      // The loops cannot be fused
+    }
+  }
+  return candidates;
+}
+
+static size_t getSizeClass(size_t size) {
+  size_t sizeClass = 0;
+  while (((size_t)1 << sizeClass) < size) {
+    sizeClass++;
+  }
+  return sizeClass;
+}
+
+/// Returns the statement with its tensors and index variables renamed in the
+/// order in which they appear, so that kernels that only differ in names print
+/// the same.
+static IndexStmt normalizeNames(IndexStmt stmt) {
+  map<TensorVar,TensorVar> tensors;
+  for (const TensorVar& tensor : getTensorVars(stmt)) {
+    tensors.insert({tensor, TensorVar("t" + to_string(tensors.size()),
+                                      tensor.getType(), tensor.getFormat(),
+                                      tensor.getFill())});
+  }
+  map<IndexVar,IndexVar> indexVars;
+  for (const IndexVar& indexVar : getIndexVars(stmt)) {
+    indexVars.insert({indexVar, IndexVar("i" + to_string(indexVars.size()))});
+  }
+  return replace(replace(stmt, tensors), indexVars);
+}
+
+/// Returns the key under which the winning schedule of a kernel is kept, which
+/// consists of the name-normalized statement, the formats of its tensors and
+/// the size classes of its result and arguments.
+static string getKey(IndexStmt stmt, const TensorBase& tensor,
+                     const vector<TensorStorage>& arguments) {
+  stringstream key;
+  key << normalizeNames(stmt) << " " << tensor.getFormat() << ":";
+  for (int dimension : tensor.getDimensions()) {
+    key << getSizeClass(dimension) << ",";
+  }
+  for (const TensorStorage& storage : arguments) {
+    key << " " << storage.getFormat() << ":";
+    for (int dimension : storage.getDimensions()) {
+      key << getSizeClass(dimension) << ",";
+    }
+    key << getSizeClass(storage.getValues().getSize());
+  }
+  return key.str();
+}
+
+/// Compiles the candidate for a new tensor that computes the same expression
+/// as `tensor`, and returns that tensor together with the kernel bound to it.
+static pair<TensorBase,PreparedKernel> prepareCandidate(const TensorBase& tensor,
+                                                        IndexStmt candidate) {
+  TensorBase trial(tensor.getComponentType(), tensor.getDimensions(),
+                   tensor.getFormat(), tensor.getFillValue());
+  Assignment assignment = tensor.getKernelAssignment();
+  const vector<IndexVar> indexVars = assignment.getLhs().getIndexVars();
+  if (indexVars.empty()) {
+    trial = assignment.getRhs();
+  } else {
+    trial(indexVars) = assignment.getRhs();
+  }
+  trial.compile(candidate);
+  return {trial, trial.prepare()};
+}
+
+/// Returns the median time of computing the tensor with the kernel.
+static double timeKernel(const PreparedKernel& kernel, int numRuns) {
+  vector<double> times;
+  for (int run = 0; run < numRuns; run++) {
+    auto begin = chrono::steady_clock::now();
+    kernel.assemble();
+    kernel.compute();
+    auto end = chrono::steady_clock::now();
+    times.push_back(chrono::duration<double>(end - begin).count());
+  }
+  std::sort(times.begin(), times.end());
+  return times[times.size() / 2];
+}
+
+Autoscheduler::Autoscheduler(string cacheFile, int numRuns)
+    : cacheFile(cacheFile), numRuns(numRuns) {
+  taco_uassert(numRuns > 0) << "Candidates must be timed at least once";
+  if (cacheFile.empty()) {
+    return;
+  }
+  // Every line of the cache holds the position of a winning candidate
+  // followed by its key
+  std::ifstream file(cacheFile);
+  string line;
+  while (std::getline(file, line)) {
+    std::istringstream stream(line);
+    size_t winner;
+    string key;
+    if (stream >> winner && stream.get() == ' ' &&
+        std::getline(stream, key)) {
+      winners[key] = winner;
+    }
+  }
+}
+
+IndexStmt Autoscheduler::schedule(TensorBase tensor, IndexStmt stmt,
+                                  const vector<TensorStorage>& arguments) {
+  if (tensor.getKernelAssignment().getOperator().defined()) {
+    return stmt;
+  }
+  taco_iassert(arguments.size() == getArguments(stmt).size());
+  const vector<IndexStmt> candidates = getCandidates(stmt);
+  const string key = getKey(stmt, tensor, arguments);
+  {
+    lock_guard<std::mutex> lock(winnersMutex);
+    if (util::contains(winners, key) && winners.at(key) < candidates.size()) {
+      return candidates[winners.at(key)];
+    }
+  }
+
+  vector<size_t> ranking(candidates.size());
+  std::iota(ranking.begin(), ranking.end(), 0);
+  if (maxTimedCandidates > 0 && candidates.size() > maxTimedCandidates) {
+    map<TensorVar,TensorStatistics> statistics;
+    const vector<TensorVar> argumentVars = getArguments(stmt);
+    for (size_t i = 0; i < argumentVars.size(); i++) {
+      statistics.insert({argumentVars[i], TensorStatistics(arguments[i])});
+    }
+    CostModelParameters parameters;
+    parameters.numThreads = std::max(1, taco_get_num_threads());
+    ranking = rankSchedules(candidates, statistics, parameters);
+    ranking.resize(maxTimedCandidates);
+  }
+
+  // The first run of every kernel is not timed, since it warms the caches
+  auto reference = prepareCandidate(tensor, candidates[0]);
+  reference.second.assemble();
+  reference.second.compute();
+  size_t winner = 0;
+  double winnerTime = timeKernel(reference.second, numRuns);
+  int numTimed = 1;
+  for (size_t i : ranking) {
+    if (i == 0) {
+      continue;
+    }
+    try {
+      auto candidate = prepareCandidate(tensor, candidates[i]);
+      candidate.second.assemble();
+      candidate.second.compute();
+      if (!equals(candidate.first, reference.first)) {
+        continue;
+      }
+      const double time = timeKernel(candidate.second, numRuns);
+      numTimed++;
+      if (time < winnerTime) {
+        winner = i;
+        winnerTime = time;
+      }
+    } catch (const TacoException&) {
+      // The candidate cannot be lowered
+    }
+  }
+
+  lock_guard<std::mutex> lock(winnersMutex);
+  numTimedCandidates += numTimed;
+  winners[key] = winner;
+  if (!cacheFile.empty()) {
+    std::ofstream file(cacheFile, std::ios::app);
+    file << winner << " " << key << std::endl;
+  }
+  return candidates[winner];
+}
+
+void Autoscheduler::setMaxTimedCandidates(size_t maxTimedCandidates) {
+  this->maxTimedCandidates = maxTimedCandidates;
+}
+
+int Autoscheduler::getNumTimedCandidates() const {
+  lock_guard<std::mutex> lock(winnersMutex);
+  return numTimedCandidates;
+}
+
+}
@@ -198,6 +198,18 @@ string CodeGen::printContextDeclAndInit(map<Expr, string, ExprCompare> varMap,
   return ret.str();
 }
 
+// Index arrays are int arrays unless their format declares a different type
+// (e.g., int64_t position arrays of tensors with more than INT_MAX nonzeros)
+static string printIndexArrayType(Datatype type) {
+  stringstream ret;
+  if (type == Int32) {
+    ret << "int*";
+  } else {
+    ret << type << "*";
+  }
+  return ret.str();
+}
+
 string CodeGen::printTensorProperty(string varname, const GetProperty* op, bool is_ptr) {
   stringstream ret;
   string star = is_ptr ? "*" : "";
@@ -226,7 +238,7 @@ string CodeGen::printTensorProperty(string varname, const GetProperty* op, bool
     ret << tp << " " << varname;
   } else {
     taco_iassert(op->property == TensorProperty::Indices);
-    tp = "int*" + star;
+    tp = printIndexArrayType(op->type) + star;
     ret << tp << " " << varname;
   }
 
@@ -265,10 +277,10 @@ string CodeGen::unpackTensorProperty(string varname, const GetProperty* op,
         << "->dimensions[" << op->mode << "]);\n";
   } else {
     taco_iassert(op->property == TensorProperty::Indices);
-    tp = "int*";
+    tp = printIndexArrayType(op->type);
     auto nm = op->index;
     ret << tp << " " << restrictKeyword() << " " << varname << " = ";
-    ret << "(int*)(" << tensor->name << "->indices[" << op->mode;
+    ret << "(" << tp << ")(" << tensor->name << "->indices[" << op->mode;
     ret << "][" << nm << "]);\n";
   }
 
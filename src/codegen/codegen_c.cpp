@@ -39,12 +39,20 @@ const string cHeaders =
   "#if _OPENMP\n"
   "#include <omp.h>\n"
   "#endif\n"
+  "#if __SSE2__\n"
+  "#include <emmintrin.h>\n"
+  "#endif\n"
   "#define TACO_MIN(_a,_b) ((_a) < (_b) ? (_a) : (_b))\n"
   "#define TACO_MAX(_a,_b) ((_a) > (_b) ? (_a) : (_b))\n"
   "#define TACO_DEREF(_a) (((___context___*)(*__ctx__))->_a)\n"
   "#ifndef TACO_TENSOR_T_DEFINED\n"
   "#define TACO_TENSOR_T_DEFINED\n"
   "typedef enum { taco_mode_dense, taco_mode_sparse } taco_mode_t;\n"
+  "typedef struct taco_allocator_t {\n"
+  "  void* (*allocate)(void* context, size_t size, int clear);\n"
+  "  void* (*reallocate)(void* context, void* ptr, size_t old_size, size_t size);\n"
+  "  void*  context;\n"
+  "} taco_allocator_t;\n"
   "typedef struct {\n"
   "  int32_t      order;         // tensor order (number of modes)\n"
   "  int32_t*     dimensions;    // tensor dimensions\n"
@@ -55,12 +63,32 @@ const string cHeaders =
   "  uint8_t*     vals;          // tensor values\n"
   "  uint8_t*     fill_value;    // tensor fill value\n"
   "  int32_t      vals_size;     // values array size\n"
+  "  taco_allocator_t* allocator; // result array allocator (NULL uses malloc)\n"
   "} taco_tensor_t;\n"
   "#endif\n"
+  "#ifndef TACO_TASKS_PER_THREAD\n"
+  "#define TACO_TASKS_PER_THREAD 8\n"
+  "#endif\n"
+  "#ifndef TACO_GALLOP_RATIO\n"
+  "#define TACO_GALLOP_RATIO 32\n"
+  "#endif\n"
   "#if !_OPENMP\n"
   "int omp_get_thread_num() { return 0; }\n"
   "int omp_get_max_threads() { return 1; }\n"
   "#endif\n"
+  // Allocate and resize the arrays of results with the result's allocator
+  "void* taco_allocate(taco_allocator_t* allocator, size_t size, int clear) {\n"
+  "  if (allocator == NULL) {\n"
+  "    return clear ? calloc(1, size) : malloc(size);\n"
+  "  }\n"
+  "  return allocator->allocate(allocator->context, size, clear);\n"
+  "}\n"
+  "void* taco_reallocate(taco_allocator_t* allocator, void* ptr, size_t old_size, size_t size) {\n"
+  "  if (allocator == NULL) {\n"
+  "    return realloc(ptr, size);\n"
+  "  }\n"
+  "  return allocator->reallocate(allocator->context, ptr, old_size, size);\n"
+  "}\n"
   "int cmp(const void *a, const void *b) {\n"
   "  return *((const int*)a) - *((const int*)b);\n"
   "}\n"
@@ -86,6 +114,73 @@ const string cHeaders =
   "  }\n"
   "  return curr+1;\n"
   "}\n"
+  "int64_t taco_gallop64(int64_t *array, int64_t arrayStart, int64_t arrayEnd, int64_t target) {\n"
+  "  if (array[arrayStart] >= target || arrayStart >= arrayEnd) {\n"
+  "    return arrayStart;\n"
+  "  }\n"
+  "  int64_t step = 1;\n"
+  "  int64_t curr = arrayStart;\n"
+  "  while (curr + step < arrayEnd && array[curr + step] < target) {\n"
+  "    curr += step;\n"
+  "    step = step * 2;\n"
+  "  }\n"
+  "\n"
+  "  step = step / 2;\n"
+  "  while (step > 0) {\n"
+  "    if (curr + step < arrayEnd && array[curr + step] < target) {\n"
+  "      curr += step;\n"
+  "    }\n"
+  "    step = step / 2;\n"
+  "  }\n"
+  "  return curr+1;\n"
+  "}\n"
+  // Returns whether segments of the given lengths are merged faster by galloping
+  // through the longer one than by advancing both one coordinate at a time.
+  "int taco_prefer_gallop(int64_t aLength, int64_t bLength) {\n"
+  "  return aLength > TACO_GALLOP_RATIO * bLength ||\n"
+  "         bLength > TACO_GALLOP_RATIO * aLength;\n"
+  "}\n"
+  // Returns the first position of a[aStart, aEnd) whose coordinate is also in
+  // b[bStart, bEnd), or aEnd.  Blocks of four coordinates of both arrays are
+  // compared all-pairs at a time, with the rotations of one block.
+  "int taco_intersect_next(int *a, int aStart, int aEnd, int *b, int bStart, int bEnd) {\n"
+  "  while (aStart + 4 <= aEnd && bStart + 4 <= bEnd) {\n"
+  "#if __SSE2__\n"
+  "    __m128i va = _mm_loadu_si128((__m128i*)(a + aStart));\n"
+  "    __m128i vb = _mm_loadu_si128((__m128i*)(b + bStart));\n"
+  "    __m128i eq = _mm_or_si128(\n"
+  "        _mm_or_si128(_mm_cmpeq_epi32(va, vb),\n"
+  "                     _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x39))),\n"
+  "        _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x4e)),\n"
+  "                     _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x93))));\n"
+  "    int match = _mm_movemask_ps(_mm_castsi128_ps(eq));\n"
+  "#else\n"
+  "    int match = 0;\n"
+  "    for (int k = 0; k < 4; k++) {\n"
+  "      for (int l = 0; l < 4; l++) {\n"
+  "        match |= (a[aStart + k] == b[bStart + l]) << k;\n"
+  "      }\n"
+  "    }\n"
+  "#endif\n"
+  "    if (match) {\n"
+  "      return aStart + __builtin_ctz(match);\n"
+  "    }\n"
+  "    int aLast = a[aStart + 3];\n"
+  "    int bLast = b[bStart + 3];\n"
+  "    aStart += (aLast <= bLast) ? 4 : 0;\n"
+  "    bStart += (bLast <= aLast) ? 4 : 0;\n"
+  "  }\n"
+  "  while (aStart < aEnd && bStart < bEnd) {\n"
+  "    if (a[aStart] < b[bStart]) {\n"
+  "      aStart++;\n"
+  "    } else if (b[bStart] < a[aStart]) {\n"
+  "      bStart++;\n"
+  "    } else {\n"
+  "      return aStart;\n"
+  "    }\n"
+  "  }\n"
+  "  return aEnd;\n"
+  "}\n"
   "int taco_binarySearchAfter(int *array, int arrayStart, int arrayEnd, int target) {\n"
   "  if (array[arrayStart] >= target) {\n"
   "    return arrayStart;\n"
@@ -128,6 +223,108 @@ const string cHeaders =
   "  }\n"
   "  return lowerBound;\n"
   "}\n"
+  // Searches over the int64_t index arrays of formats with 64-bit positions.
+  "int64_t taco_binarySearchAfter64(int64_t *array, int64_t arrayStart, int64_t arrayEnd, int64_t target) {\n"
+  "  if (array[arrayStart] >= target) {\n"
+  "    return arrayStart;\n"
+  "  }\n"
+  "  int64_t lowerBound = arrayStart; // always < target\n"
+  "  int64_t upperBound = arrayEnd; // always >= target\n"
+  "  while (upperBound - lowerBound > 1) {\n"
+  "    int64_t mid = (upperBound + lowerBound) / 2;\n"
+  "    int64_t midValue = array[mid];\n"
+  "    if (midValue < target) {\n"
+  "      lowerBound = mid;\n"
+  "    }\n"
+  "    else if (midValue > target) {\n"
+  "      upperBound = mid;\n"
+  "    }\n"
+  "    else {\n"
+  "      return mid;\n"
+  "    }\n"
+  "  }\n"
+  "  return upperBound;\n"
+  "}\n"
+  "int64_t taco_binarySearchBefore64(int64_t *array, int64_t arrayStart, int64_t arrayEnd, int64_t target) {\n"
+  "  if (array[arrayEnd] <= target) {\n"
+  "    return arrayEnd;\n"
+  "  }\n"
+  "  int64_t lowerBound = arrayStart; // always <= target\n"
+  "  int64_t upperBound = arrayEnd; // always > target\n"
+  "  while (upperBound - lowerBound > 1) {\n"
+  "    int64_t mid = (upperBound + lowerBound) / 2;\n"
+  "    int64_t midValue = array[mid];\n"
+  "    if (midValue < target) {\n"
+  "      lowerBound = mid;\n"
+  "    }\n"
+  "    else if (midValue > target) {\n"
+  "      upperBound = mid;\n"
+  "    }\n"
+  "    else {\n"
+  "      return mid;\n"
+  "    }\n"
+  "  }\n"
+  "  return lowerBound;\n"
+  "}\n"
+  // Decode the coordinate at position pos of a packed mode's coordinate array.
+  // The layout is described in mode_format_packed.h (blocks of 128 coordinates).
+  "int taco_packed_crd(int *array, int pos) {\n"
+  "  int *block = array + 1 + 2 * (pos >> 7);\n"
+  "  int offset = block[1];\n"
+  "  int width = (block[3] - offset) >> 2;\n"
+  "  uint64_t bit = (uint64_t)(pos & 127) * width;\n"
+  "  uint32_t *word = (uint32_t*)(array + array[0] + offset) + (bit >> 5);\n"
+  "  uint64_t bits = ((uint64_t)word[1] << 32) | word[0];\n"
+  "  return block[0] + (int)((bits >> (bit & 31)) & ((1ull << width) - 1));\n"
+  "}\n"
+  // Like taco_binarySearchAfter, but over the coordinates of a packed mode.
+  "int taco_packed_binarySearchAfter(int *array, int arrayStart, int arrayEnd, int target) {\n"
+  "  if (arrayStart >= arrayEnd || taco_packed_crd(array, arrayStart) >= target) {\n"
+  "    return arrayStart;\n"
+  "  }\n"
+  "  int lowerBound = arrayStart; // always < target\n"
+  "  int upperBound = arrayEnd; // always >= target\n"
+  "  while (upperBound - lowerBound > 1) {\n"
+  "    int mid = (upperBound + lowerBound) / 2;\n"
+  "    int midValue = taco_packed_crd(array, mid);\n"
+  "    if (midValue < target) {\n"
+  "      lowerBound = mid;\n"
+  "    }\n"
+  "    else if (midValue > target) {\n"
+  "      upperBound = mid;\n"
+  "    }\n"
+  "    else {\n"
+  "      return mid;\n"
+  "    }\n"
+  "  }\n"
+  "  return upperBound;\n"
+  "}\n"
+  // Returns the slot of a hashed mode's fiber that holds coord, or the empty
+  // slot that it is inserted in (see mode_format_hashed.h).  A full fiber sets
+  // the overflow flag that follows the number of slots, and the tensor is then
+  // assembled again with larger tables.
+  "int taco_hash_locate(int *table, int *capacity, int parentPos, int coord) {\n"
+  "  int width = capacity[0];\n"
+  "  int begin = parentPos * width;\n"
+  "  uint32_t hash = (uint32_t)coord * 0x9E3779B1u;\n"
+  "  hash ^= hash >> 16;\n"
+  "  for (int probe = 0; probe < width; probe++) {\n"
+  "    int slot = begin + (int)((hash + probe) & (uint32_t)(width - 1));\n"
+  "    if (table[slot] == coord || table[slot] < 0) {\n"
+  "      return slot;\n"
+  "    }\n"
+  "  }\n"
+  "  capacity[1] = 1;\n"
+  "  return begin;\n"
+  "}\n"
+  // The bit of a bitmap mode's words that marks position pos, and the lowest
+  // marked position of a word (see mode_format_bitmap.h).
+  "uint64_t taco_bitmap_mask(int pos) {\n"
+  "  return (uint64_t)1 << (pos & 63);\n"
+  "}\n"
+  "int taco_bitmap_ctz(uint64_t word) {\n"
+  "  return __builtin_ctzll(word);\n"
+  "}\n"
   "taco_tensor_t* init_taco_tensor_t(int32_t order, int32_t csize,\n"
   "                                  int32_t* dimensions, int32_t* mode_ordering,\n"
   "                                  taco_mode_t* mode_types) {\n"
@@ -138,6 +335,7 @@ const string cHeaders =
   "  t->mode_types    = (taco_mode_t *) malloc(order * sizeof(taco_mode_t));\n"
   "  t->indices       = (uint8_t ***) malloc(order * sizeof(uint8_t***));\n"
   "  t->csize         = csize;\n"
+  "  t->allocator     = NULL;\n"
   "  for (int32_t i = 0; i < order; i++) {\n"
   "    t->dimensions[i]    = dimensions[i];\n"
   "    t->mode_ordering[i] = mode_ordering[i];\n"
@@ -293,6 +491,7 @@ void CodeGen_C::visit(const Function* func) {
   emittingCoroutine = (numYields > 0);
   funcName = func->name;
   labelCount = 0;
+  taskLoopDepth = 0;
 
   resetUniqueNameCounters();
   FindVars inputVarFinder(func->inputs, {}, this);
@@ -443,6 +642,21 @@ static string getParallelizePragma(LoopKind kind) {
   return ret.str();
 }
 
+// The outermost task loop starts a team of threads, one of which creates the
+// tasks while the others execute them, stealing tasks from each other as they
+// run out of work.  Nested task loops add their tasks to the same team, so
+// nested parallelism does not oversubscribe the cores.
+static string getTaskLoopPragma(bool nested) {
+  stringstream ret;
+  if (!nested) {
+    ret << "#pragma omp parallel\n";
+    ret << "#pragma omp single\n";
+  }
+  ret << "#pragma omp taskloop num_tasks(TACO_TASKS_PER_THREAD * "
+      << "omp_get_num_threads())";
+  return ret.str();
+}
+
 static string getUnrollPragma(size_t unrollFactor) {
   return "#pragma unroll " + std::to_string(unrollFactor);
 }
@@ -469,7 +683,11 @@ void CodeGen_C::visit(const For* op) {
       case LoopKind::Runtime:
       case LoopKind::Static_Chunked:
         doIndent();
-        out << getParallelizePragma(op->kind);
+        if (op->parallel_unit == ParallelUnit::CPUTask) {
+          out << getTaskLoopPragma(taskLoopDepth > 0);
+        } else {
+          out << getParallelizePragma(op->kind);
+        }
         out << "\n";
         break;
       default:
@@ -508,7 +726,12 @@ void CodeGen_C::visit(const For* op) {
   }
   stream << ") {\n";
 
+  const bool isTaskLoop = op->parallel_unit == ParallelUnit::CPUTask &&
+                          op->kind != LoopKind::Serial &&
+                          op->kind != LoopKind::Vectorized;
+  taskLoopDepth += isTaskLoop;
   op->contents.accept(this);
+  taskLoopDepth -= isTaskLoop;
   doIndent();
   stream << "}";
   stream << endl;
@@ -569,6 +792,43 @@ void CodeGen_C::visit(const Max* op) {
 void CodeGen_C::visit(const Allocate* op) {
   string elementType = printCType(op->var.type(), false);
 
+  // Arrays of a result tensor are allocated with the tensor's allocator, so
+  // callers can pool the memory of results that are computed repeatedly.
+  const GetProperty* property = op->var.as<GetProperty>();
+  if (property != nullptr && property->tensor.as<Var>() != nullptr &&
+      (property->property == TensorProperty::Indices ||
+       property->property == TensorProperty::Values)) {
+    const string allocator = property->tensor.as<Var>()->name + "->allocator";
+    doIndent();
+    op->var.accept(this);
+    stream << " = (" << elementType << "*)";
+    if (op->is_realloc) {
+      stream << "taco_reallocate(" << allocator << ", ";
+      op->var.accept(this);
+      stream << ", ";
+      if (op->old_elements.defined()) {
+        stream << "sizeof(" << elementType << ") * ";
+        parentPrecedence = MUL;
+        op->old_elements.accept(this);
+        parentPrecedence = TOP;
+      } else {
+        stream << "0";
+      }
+      stream << ", ";
+    } else {
+      stream << "taco_allocate(" << allocator << ", ";
+    }
+    stream << "sizeof(" << elementType << ") * ";
+    parentPrecedence = MUL;
+    op->num_elements.accept(this);
+    parentPrecedence = TOP;
+    if (!op->is_realloc) {
+      stream << ", " << (op->clear ? 1 : 0);
+    }
+    stream << ");" << endl;
+    return;
+  }
+
   doIndent();
   op->var.accept(this);
   stream << " = (";
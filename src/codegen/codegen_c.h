@@ -52,6 +52,7 @@ protected:
 
   std::string funcName;
   int labelCount;
+  int taskLoopDepth = 0;
   bool emittingCoroutine;
   bool emitHydride;
   bool mutated_expr;
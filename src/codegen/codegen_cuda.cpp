@@ -41,6 +41,11 @@ const string cHeaders =
   "#ifndef TACO_TENSOR_T_DEFINED\n"
   "#define TACO_TENSOR_T_DEFINED\n"
   "typedef enum { taco_mode_dense, taco_mode_sparse } taco_mode_t;\n"
+  "typedef struct taco_allocator_t {\n"
+  "  void* (*allocate)(void* context, size_t size, int clear);\n"
+  "  void* (*reallocate)(void* context, void* ptr, size_t old_size, size_t size);\n"
+  "  void*  context;\n"
+  "} taco_allocator_t;\n"
   "typedef struct {\n"
   "  int32_t      order;         // tensor order (number of modes)\n"
   "  int32_t*     dimensions;    // tensor dimensions\n"
@@ -51,6 +56,7 @@ const string cHeaders =
   "  uint8_t*     vals;          // tensor values\n"
   "  uint8_t*     fill_value;    // tensor fill value\n"
   "  int32_t      vals_size;     // values array size\n"
+  "  taco_allocator_t* allocator; // result array allocator (unused by CUDA kernels)\n"
   "} taco_tensor_t;\n"
   "#endif\n"
   "#endif\n\n"; // // https://stackoverflow.com/questions/14038589/what-is-the-canonical-way-to-check-for-errors-using-the-cuda-runtime-api
@@ -107,6 +113,103 @@ const string gpuAssertMacro =
   "  }\n"
   "  return lowerBound;\n"
   "}\n"
+  // Searches over the int64_t index arrays of formats with 64-bit positions.
+  "__device__ __host__ int64_t taco_binarySearchAfter64(int64_t *array, int64_t arrayStart, int64_t arrayEnd, int64_t target) {\n"
+  "  if (array[arrayStart] >= target) {\n"
+  "    return arrayStart;\n"
+  "  }\n"
+  "  int64_t lowerBound = arrayStart; // always < target\n"
+  "  int64_t upperBound = arrayEnd; // always >= target\n"
+  "  while (upperBound - lowerBound > 1) {\n"
+  "    int64_t mid = (upperBound + lowerBound) / 2;\n"
+  "    int64_t midValue = array[mid];\n"
+  "    if (midValue < target) {\n"
+  "      lowerBound = mid;\n"
+  "    }\n"
+  "    else if (midValue > target) {\n"
+  "      upperBound = mid;\n"
+  "    }\n"
+  "    else {\n"
+  "      return mid;\n"
+  "    }\n"
+  "  }\n"
+  "  return upperBound;\n"
+  "}\n"
+  "__device__ __host__ int64_t taco_binarySearchBefore64(int64_t *array, int64_t arrayStart, int64_t arrayEnd, int64_t target) {\n"
+  "  if (array[arrayEnd] <= target) {\n"
+  "    return arrayEnd;\n"
+  "  }\n"
+  "  int64_t lowerBound = arrayStart; // always <= target\n"
+  "  int64_t upperBound = arrayEnd; // always > target\n"
+  "  while (upperBound - lowerBound > 1) {\n"
+  "    int64_t mid = (upperBound + lowerBound) / 2;\n"
+  "    int64_t midValue = array[mid];\n"
+  "    if (midValue < target) {\n"
+  "      lowerBound = mid;\n"
+  "    }\n"
+  "    else if (midValue > target) {\n"
+  "      upperBound = mid;\n"
+  "    }\n"
+  "    else {\n"
+  "      return mid;\n"
+  "    }\n"
+  "  }\n"
+  "  return lowerBound;\n"
+  "}\n"
+  "__device__ __host__ int taco_packed_crd(int *array, int pos) {\n"
+  "  int *block = array + 1 + 2 * (pos >> 7);\n"
+  "  int offset = block[1];\n"
+  "  int width = (block[3] - offset) >> 2;\n"
+  "  uint64_t bit = (uint64_t)(pos & 127) * width;\n"
+  "  uint32_t *word = (uint32_t*)(array + array[0] + offset) + (bit >> 5);\n"
+  "  uint64_t bits = ((uint64_t)word[1] << 32) | word[0];\n"
+  "  return block[0] + (int)((bits >> (bit & 31)) & ((1ull << width) - 1));\n"
+  "}\n"
+  "__device__ __host__ int taco_packed_binarySearchAfter(int *array, int arrayStart, int arrayEnd, int target) {\n"
+  "  if (arrayStart >= arrayEnd || taco_packed_crd(array, arrayStart) >= target) {\n"
+  "    return arrayStart;\n"
+  "  }\n"
+  "  int lowerBound = arrayStart; // always < target\n"
+  "  int upperBound = arrayEnd; // always >= target\n"
+  "  while (upperBound - lowerBound > 1) {\n"
+  "    int mid = (upperBound + lowerBound) / 2;\n"
+  "    int midValue = taco_packed_crd(array, mid);\n"
+  "    if (midValue < target) {\n"
+  "      lowerBound = mid;\n"
+  "    }\n"
+  "    else if (midValue > target) {\n"
+  "      upperBound = mid;\n"
+  "    }\n"
+  "    else {\n"
+  "      return mid;\n"
+  "    }\n"
+  "  }\n"
+  "  return upperBound;\n"
+  "}\n"
+  "__device__ __host__ int taco_hash_locate(int *table, int *capacity, int parentPos, int coord) {\n"
+  "  int width = capacity[0];\n"
+  "  int begin = parentPos * width;\n"
+  "  uint32_t hash = (uint32_t)coord * 0x9E3779B1u;\n"
+  "  hash ^= hash >> 16;\n"
+  "  for (int probe = 0; probe < width; probe++) {\n"
+  "    int slot = begin + (int)((hash + probe) & (uint32_t)(width - 1));\n"
+  "    if (table[slot] == coord || table[slot] < 0) {\n"
+  "      return slot;\n"
+  "    }\n"
+  "  }\n"
+  "  capacity[1] = 1;\n"
+  "  return begin;\n"
+  "}\n"
+  "__device__ __host__ uint64_t taco_bitmap_mask(int pos) {\n"
+  "  return (uint64_t)1 << (pos & 63);\n"
+  "}\n"
+  "__device__ __host__ int taco_bitmap_ctz(uint64_t word) {\n"
+  "#ifdef __CUDA_ARCH__\n"
+  "  return __ffsll((long long)word) - 1;\n"
+  "#else\n"
+  "  return __builtin_ctzll(word);\n"
+  "#endif\n"
+  "}\n"
   "__global__ void taco_binarySearchBeforeBlock(int * __restrict__ array, int * __restrict__ results, int arrayStart, int arrayEnd, int values_per_block, int num_blocks) {\n"
   "  int thread = threadIdx.x;\n"
   "  int block = blockIdx.x;\n"
@@ -1314,7 +1417,9 @@ void CodeGen_CUDA::visit(const Call* op) {
     // argument. This pointer information isn't carried anywhere in
     // the argument expressions, so we need to special case and not
     // emit an invalid cast for that argument.
-    auto opIsBinarySearch = op->func == "taco_binarySearchAfter" || op->func == "taco_binarySearchBefore";
+    auto opIsBinarySearch = op->func == "taco_binarySearchAfter" || op->func == "taco_binarySearchBefore" ||
+                            op->func == "taco_binarySearchAfter64" || op->func == "taco_binarySearchBefore64" ||
+                            op->func == "taco_packed_binarySearchAfter";
     if (!opIsBinarySearch && (op->type != op->args[0].type() || isa<Literal>(op->args[0]))) {
       stream << "(" << printCUDAType(op->type, false) << ") ";
     }
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <fstream>
 #include <dlfcn.h>
+#include <mutex>
 #include <unistd.h>
 #if USE_OPENMP
 #include <omp.h>
@@ -31,6 +32,9 @@ void Module::setJITTmpdir() {
 }
 
 void Module::setJITLibname() {
+  // Modules may be created by several threads at once
+  static std::mutex genMutex;
+  std::lock_guard<std::mutex> lock(genMutex);
   libname.resize(12);
   for (int i=0; i<12; i++)
     libname[i] = chars[randint(gen)];
@@ -208,10 +212,33 @@ string Module::compile(bool emitHydride) {
   }
   lib_handle = dlopen(fullpath.data(), RTLD_NOW | RTLD_LOCAL);
   taco_uassert(lib_handle) << "Failed to load generated code, error is: " << dlerror();
+  resolveFuncs();
 
   return fullpath;
 }
 
+void Module::resolveFuncs() {
+  static_assert(sizeof(void*) == sizeof(PackedFunc),
+    "Unable to cast dlsym() returned void pointer to function pointer");
+  funcPtrs.clear();
+  packedFuncs.clear();
+  for (auto& func : funcs) {
+    const string& name = func.as<Function>()->name;
+    for (const string& symbol : {name, "_shim_" + name}) {
+      void* funcPtr = dlsym(lib_handle, symbol.data());
+      if (funcPtr != nullptr) {
+        funcPtrs[symbol] = funcPtr;
+      }
+    }
+    auto shim = funcPtrs.find("_shim_" + name);
+    if (shim != funcPtrs.end()) {
+      PackedFunc packedFunc;
+      *reinterpret_cast<void**>(&packedFunc) = shim->second;
+      packedFuncs[name] = packedFunc;
+    }
+  }
+}
+
 void Module::setSource(string source) {
   this->source << source;
   moduleFromUserSource = true;
@@ -221,17 +248,33 @@ string Module::getSource() {
   return source.str();
 }
 
-void* Module::getFuncPtr(std::string name) {
+void* Module::getFuncPtr(const std::string& name) const {
+  auto funcPtr = funcPtrs.find(name);
+  if (funcPtr != funcPtrs.end()) {
+    return funcPtr->second;
+  }
+  // Modules compiled from user source only know their functions by symbol
   return dlsym(lib_handle, name.data());
 }
 
-int Module::callFuncPackedRaw(std::string name, void** args) {
-  typedef int (*fnptr_t)(void**);
-  static_assert(sizeof(void*) == sizeof(fnptr_t),
-    "Unable to cast dlsym() returned void pointer to function pointer");
-  void* v_func_ptr = getFuncPtr(name);
-  fnptr_t func_ptr;
-  *reinterpret_cast<void**>(&func_ptr) = v_func_ptr;
+Module::PackedFunc Module::getPackedFunc(const std::string& name) const {
+  auto packedFunc = packedFuncs.find(name);
+  if (packedFunc != packedFuncs.end()) {
+    return packedFunc->second;
+  }
+  PackedFunc func;
+  *reinterpret_cast<void**>(&func) = getFuncPtr("_shim_" + name);
+  return func;
+}
+
+int Module::callFuncPackedRaw(const std::string& name, void** args) const {
+  PackedFunc func;
+  *reinterpret_cast<void**>(&func) = getFuncPtr(name);
+  return callFuncPacked(func, args);
+}
+
+int Module::callFuncPacked(PackedFunc func_ptr, void** args) const {
+  taco_uassert(func_ptr != nullptr) << "The module does not have the function";
 
 #if USE_OPENMP
   omp_sched_t existingSched;
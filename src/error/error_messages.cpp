@@ -37,6 +37,10 @@ const std::string assemble_without_compile =
 const std::string compute_without_compile =
    "The compile method must be called before compute.";
 
+const std::string recompute_without_assemble =
+   "The tensor must be assembled by its current kernel, without assembling "
+   "while computing, before it can be recomputed.";
+
 const std::string requires_matrix =
     "The argument must be a matrix.";
 
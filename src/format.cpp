@@ -9,6 +9,10 @@
 #include "taco/lower/mode_format_dense.h"
 #include "taco/lower/mode_format_compressed.h"
 #include "taco/lower/mode_format_singleton.h"
+#include "taco/lower/mode_format_packed.h"
+#include "taco/lower/mode_format_sliced.h"
+#include "taco/lower/mode_format_hashed.h"
+#include "taco/lower/mode_format_bitmap.h"
 
 #include "taco/error.h"
 #include "taco/util/strings.h"
@@ -99,6 +103,18 @@ void Format::setLevelArrayTypes(std::vector<std::vector<Datatype>> levelArrayTyp
   this->levelArrayTypes = levelArrayTypes;
 }
 
+Datatype Format::getIndexType() const {
+  Datatype indexType = Int32;
+  for (const auto& arrayTypes : levelArrayTypes) {
+    for (const auto& arrayType : arrayTypes) {
+      if (arrayType.getNumBits() > indexType.getNumBits()) {
+        indexType = arrayType;
+      }
+    }
+  }
+  return indexType;
+}
+
 
 bool operator==(const Format& a, const Format& b){
   const auto aModeTypePacks = a.getModeFormatPacks();
@@ -318,6 +334,10 @@ bool ModeFormat::defined() const {
   return impl != nullptr;
 }
 
+std::shared_ptr<const ModeFormatImpl> ModeFormat::getImpl() const {
+  return impl;
+}
+
 bool operator==(const ModeFormat& a, const ModeFormat& b) {
   return (a.defined() && b.defined() && (*a.impl == *b.impl));
 }
@@ -384,21 +404,37 @@ ModeFormat ModeFormat::Dense(std::make_shared<DenseModeFormat>());
 ModeFormat ModeFormat::Compressed(std::make_shared<CompressedModeFormat>());
 ModeFormat ModeFormat::Sparse = ModeFormat::Compressed;
 ModeFormat ModeFormat::Singleton(std::make_shared<SingletonModeFormat>());
+ModeFormat ModeFormat::Packed(std::make_shared<PackedModeFormat>());
+ModeFormat ModeFormat::Sliced(std::make_shared<SlicedModeFormat>());
+ModeFormat ModeFormat::Hashed(std::make_shared<HashedModeFormat>());
+ModeFormat ModeFormat::Bitmap(std::make_shared<BitmapModeFormat>());
 
 ModeFormat ModeFormat::dense = ModeFormat::Dense;
 ModeFormat ModeFormat::compressed = ModeFormat::Compressed;
 ModeFormat ModeFormat::sparse = ModeFormat::Compressed;
 ModeFormat ModeFormat::singleton = ModeFormat::Singleton;
+ModeFormat ModeFormat::packed = ModeFormat::Packed;
+ModeFormat ModeFormat::sliced = ModeFormat::Sliced;
+ModeFormat ModeFormat::hashed = ModeFormat::Hashed;
+ModeFormat ModeFormat::bitmap = ModeFormat::Bitmap;
 
 const ModeFormat Dense = ModeFormat::Dense;
 const ModeFormat Compressed = ModeFormat::Compressed;
 const ModeFormat Sparse = ModeFormat::Compressed;
 const ModeFormat Singleton = ModeFormat::Singleton;
+const ModeFormat Packed = ModeFormat::Packed;
+const ModeFormat Sliced = ModeFormat::Sliced;
+const ModeFormat Hashed = ModeFormat::Hashed;
+const ModeFormat Bitmap = ModeFormat::Bitmap;
 
 const ModeFormat dense = ModeFormat::Dense;
 const ModeFormat compressed = ModeFormat::Compressed;
 const ModeFormat sparse = ModeFormat::Compressed;
 const ModeFormat singleton = ModeFormat::Singleton;
+const ModeFormat packed = ModeFormat::Packed;
+const ModeFormat sliced = ModeFormat::Sliced;
+const ModeFormat hashed = ModeFormat::Hashed;
+const ModeFormat bitmap = ModeFormat::Bitmap;
 
 const Format CSR({Dense, Sparse}, {0,1});
 const Format CSC({Dense, Sparse}, {1,0});
@@ -430,6 +466,22 @@ const Format COO(int order, bool isUnique, bool isOrdered, bool isAoS,
          : Format(modeTypes, modeOrdering);
 }
 
+const Format Blocked(const Format& blockFormat) {
+  const int order = blockFormat.getOrder();
+  taco_uassert(order > 0) << "Only tensors with modes can be blocked";
+
+  std::vector<ModeFormatPack> modeFormatPacks =
+      blockFormat.getModeFormatPacks();
+  std::vector<int> modeOrdering = blockFormat.getModeOrdering();
+  for (int level = 0; level < order; level++) {
+    modeFormatPacks.push_back(Dense);
+    modeOrdering.push_back(order + blockFormat.getModeOrdering()[level]);
+  }
+  return Format(modeFormatPacks, modeOrdering);
+}
+
+const Format BCSR = Blocked(CSR);
+
 bool isDense(const Format& format) {
   for (ModeFormat modeFormat : format.getModeFormats()) {
     if (modeFormat != Dense) {
@@ -439,4 +491,23 @@ bool isDense(const Format& format) {
   return true;
 }
 
+bool isBlocked(const Format& format) {
+  const int order = format.getOrder();
+  if (order == 0 || order % 2 != 0) {
+    return false;
+  }
+  const int blockOrder = order / 2;
+  const std::vector<ModeFormat> modeFormats = format.getModeFormats();
+  const std::vector<int> modeOrdering = format.getModeOrdering();
+  bool hasSparseBlockLevel = false;
+  for (int level = 0; level < blockOrder; level++) {
+    hasSparseBlockLevel |= (modeFormats[level] != Dense);
+    if (modeFormats[blockOrder + level] != Dense ||
+        modeOrdering[blockOrder + level] != blockOrder + modeOrdering[level]) {
+      return false;
+    }
+  }
+  return hasSparseBlockLevel;
+}
+
 }
@@ -0,0 +1,665 @@
+#include "taco/index_notation/cost_model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <set>
+
+#include "taco/error.h"
+#include "taco/index_notation/index_notation_nodes.h"
+#include "taco/index_notation/index_notation_visitor.h"
+#include "taco/index_notation/provenance_graph.h"
+#include "taco/lower/mode_format_sliced.h"
+#include "taco/lower/mode_format_hashed.h"
+#include "taco/storage/storage.h"
+#include "taco/storage/index.h"
+#include "taco/storage/array.h"
+#include "taco/util/collections.h"
+
+using namespace std;
+
+namespace taco {
+
+static const double UNBOUNDED = numeric_limits<double>::infinity();
+
+// The number of bytes of a coordinate in the index of a sparse level
+static const double COORDINATE_BYTES = 4;
+
+static bool isDenseLevel(const ModeFormat& modeFormat) {
+  return modeFormat.hasLocate() && modeFormat.isFull();
+}
+
+// class TensorStatistics
+TensorStatistics::TensorStatistics() {
+}
+
+TensorStatistics::TensorStatistics(const vector<int>& dimensions,
+                                   const Format& format, size_t nnz)
+    : dimensions(dimensions), modeOrdering(format.getModeOrdering()) {
+  taco_uassert(format.getOrder() == (int)dimensions.size())
+      << "The format does not match the dimensions";
+  double parentPositions = 1;
+  for (int level = 0; level < format.getOrder(); level++) {
+    const double dimension = dimensions[modeOrdering[level]];
+    double positions = parentPositions * dimension;
+    if (!isDenseLevel(format.getModeFormats()[level])) {
+      positions = std::min(positions, (double)nnz);
+    }
+    numPositions.push_back(positions);
+    maxFiberLengths.push_back(positions / parentPositions);
+    parentPositions = positions;
+  }
+}
+
+TensorStatistics::TensorStatistics(const TensorStorage& storage)
+    : dimensions(storage.getDimensions()),
+      modeOrdering(storage.getFormat().getModeOrdering()) {
+  const Format& format = storage.getFormat();
+  const Index& index = storage.getIndex();
+  double parentPositions = 1;
+  for (int level = 0; level < format.getOrder(); level++) {
+    const double dimension = dimensions[modeOrdering[level]];
+    const ModeIndex modeIndex = index.getModeIndex(level);
+    double positions = parentPositions;
+    double maxFiberLength = 1;
+    if (isDenseLevel(format.getModeFormats()[level])) {
+      positions = parentPositions * dimension;
+      maxFiberLength = dimension;
+    } else if (format.getModeFormats()[level].getName() == Sliced.getName()) {
+      // Sliced levels store the physical range of every fiber, whose
+      // positions are a slice height apart, followed by the number of
+      // positions and the fiber in every slot
+      const Array& ranges = modeIndex.getIndexArray(0);
+      const size_t numFibers = (ranges.getSize() - 1) / 3;
+      const int sliceHeight = std::static_pointer_cast<const SlicedModeFormat>(
+          format.getModeFormats()[level].getImpl())->getSliceHeight();
+      positions = 0;
+      maxFiberLength = 0;
+      for (size_t i = 0; i < 2 * numFibers; i += 2) {
+        const double length = (ranges.get(i + 1).getAsIndex() -
+                               ranges.get(i).getAsIndex()) / sliceHeight;
+        positions += length;
+        maxFiberLength = std::max(maxFiberLength, length);
+      }
+    } else if (format.getModeFormats()[level].getName() == Hashed.getName()) {
+      // Position loops visit every slot of the tables of hashed levels
+      const int capacity = std::static_pointer_cast<const HashedModeFormat>(
+          format.getModeFormats()[level].getImpl())->getCapacity();
+      positions = parentPositions * capacity;
+      maxFiberLength = capacity;
+    } else if (format.getModeFormats()[level].getName() == Bitmap.getName()) {
+      // Bitmap loops only visit the marked positions of every fiber
+      const size_t wordsPerFiber =
+          modeIndex.getIndexArray(0).get(0).getAsIndex() / 64;
+      const Array& bits = modeIndex.getIndexArray(1);
+      const uint64_t* words = (const uint64_t*)bits.getData();
+      positions = 0;
+      maxFiberLength = 0;
+      for (size_t begin = 0; begin < bits.getSize(); begin += wordsPerFiber) {
+        double length = 0;
+        for (size_t w = begin; w < begin + wordsPerFiber; w++) {
+          length += __builtin_popcountll(words[w]);
+        }
+        positions += length;
+        maxFiberLength = std::max(maxFiberLength, length);
+      }
+    } else if (modeIndex.numIndexArrays() == 2) {
+      // Compressed levels delimit their fibers with a pos array
+      const Array& pos = modeIndex.getIndexArray(0);
+      maxFiberLength = 0;
+      for (size_t i = 1; i < pos.getSize(); i++) {
+        maxFiberLength = std::max(maxFiberLength,
+                                  (double)(pos.get(i).getAsIndex() -
+                                           pos.get(i - 1).getAsIndex()));
+      }
+      positions = (pos.getSize() > 0)
+                  ? (double)pos.get(pos.getSize() - 1).getAsIndex() : 0;
+    }
+    numPositions.push_back(positions);
+    maxFiberLengths.push_back(maxFiberLength);
+    parentPositions = positions;
+  }
+}
+
+const vector<int>& TensorStatistics::getDimensions() const {
+  return dimensions;
+}
+
+double TensorStatistics::getNumPositions(int level) const {
+  taco_iassert(level < (int)numPositions.size());
+  return numPositions[level];
+}
+
+double TensorStatistics::getAverageFiberLength(int level) const {
+  const double parentPositions = (level > 0) ? getNumPositions(level - 1) : 1;
+  return (parentPositions > 0) ? getNumPositions(level) / parentPositions : 0;
+}
+
+double TensorStatistics::getMaxFiberLength(int level) const {
+  taco_iassert(level < (int)maxFiberLengths.size());
+  return maxFiberLengths[level];
+}
+
+double TensorStatistics::getDensity(int level) const {
+  const double dimension = dimensions[modeOrdering[level]];
+  return (dimension > 0) ? getAverageFiberLength(level) / dimension : 0;
+}
+
+bool TensorStatistics::defined() const {
+  return !numPositions.empty() || !dimensions.empty();
+}
+
+
+// Cost estimation
+namespace {
+
+struct Loop {
+  IndexVar var;
+  vector<IndexVar> ancestors;
+  double trip;
+};
+
+/// The operations and memory traffic of serial code or of a parallel loop.
+struct Work {
+  double operations = 0;
+  double vectorizableOperations = 0;
+  double memoryTraffic = 0;
+};
+
+class CostEstimator {
+public:
+  CostEstimator(IndexStmt stmt, const map<TensorVar,TensorStatistics>& stats,
+                const CostModelParameters& parameters)
+      : graph(stmt), statistics(stats), parameters(parameters) {
+    taco_uassert(parameters.numThreads > 0) << "The number of threads must "
+                                            << "be positive";
+    if (isa<SuchThat>(stmt)) {
+      for (const IndexVarRel& rel : to<SuchThat>(stmt).getPredicate()) {
+        for (const IndexVar& child : rel.getNode()->getChildren()) {
+          relations.insert({child, rel});
+        }
+      }
+    }
+    for (const TensorVar& temporary : getTemporaries(stmt)) {
+      temporaries.insert(temporary);
+    }
+  }
+
+  Cost estimate(IndexStmt stmt) {
+    visit(stmt);
+    cost.operations = serial.operations + cost.parallelOperations;
+    cost.vectorizableOperations += serial.vectorizableOperations;
+    cost.memoryTraffic = serial.memoryTraffic + parallelTraffic;
+    cost.time += getTime(serial, 1);
+    return cost;
+  }
+
+private:
+  ProvenanceGraph graph;
+  const map<TensorVar,TensorStatistics>& statistics;
+  CostModelParameters parameters;
+  map<IndexVar,IndexVarRel> relations;
+  set<TensorVar> temporaries;
+
+  vector<Loop> loops;
+  map<IndexVar,double> underivedTrips;
+  set<IndexVar> boundVars;
+
+  bool inParallelLoop = false;
+  bool atomic = false;
+  bool vectorizable = false;
+  Work serial;
+  Work parallel;
+  double parallelTraffic = 0;
+  Cost cost;
+
+  TensorStatistics getStatistics(const TensorVar& tensor) {
+    if (util::contains(statistics, tensor)) {
+      return statistics.at(tensor);
+    }
+    vector<int> dimensions;
+    size_t size = 1;
+    for (const Dimension& dimension : tensor.getType().getShape()) {
+      dimensions.push_back(dimension.isFixed() ? (int)dimension.getSize() : 1);
+      size *= dimensions.back();
+    }
+    return TensorStatistics(dimensions, tensor.getFormat(), size);
+  }
+
+  /// Returns the storage level of the access that the variable indexes, or -1.
+  static int getLevel(const Access& access, const IndexVar& var) {
+    const vector<IndexVar>& indexVars = access.getIndexVars();
+    const Format& format = access.getTensorVar().getFormat();
+    if (format.getOrder() != (int)indexVars.size()) {
+      return -1;
+    }
+    for (int level = 0; level < format.getOrder(); level++) {
+      if (indexVars[format.getModeOrdering()[level]] == var) {
+        return level;
+      }
+    }
+    return -1;
+  }
+
+  double getDimension(IndexStmt stmt, const IndexVar& var) {
+    double dimension = 1;
+    match(stmt,
+      function<void(const AccessNode*)>([&](const AccessNode* op) {
+        Access access(op);
+        const int level = getLevel(access, var);
+        if (level >= 0) {
+          const Format& format = access.getTensorVar().getFormat();
+          TensorStatistics stats = getStatistics(access.getTensorVar());
+          dimension = stats.getDimensions()[format.getModeOrdering()[level]];
+        }
+      })
+    );
+    return dimension;
+  }
+
+  /// Returns the number of coordinates of `var` that an expression iterates,
+  /// given the variables of the enclosing loops, or UNBOUNDED if it does not
+  /// restrict them.  Multiplications intersect and additions union the
+  /// coordinates of their operands.
+  double getTrip(IndexExpr expr, const IndexVar& var,
+                 const set<IndexVar>& bound) {
+    if (isa<Access>(expr)) {
+      Access access = to<Access>(expr);
+      const int level = getLevel(access, var);
+      if (level < 0) {
+        return UNBOUNDED;
+      }
+      const Format& format = access.getTensorVar().getFormat();
+      TensorStatistics stats = getStatistics(access.getTensorVar());
+      if (isDenseLevel(format.getModeFormats()[level])) {
+        return stats.getDimensions()[format.getModeOrdering()[level]];
+      }
+      for (int parent = 0; parent < level; parent++) {
+        const IndexVar& parentVar =
+            access.getIndexVars()[format.getModeOrdering()[parent]];
+        if (!util::contains(bound, parentVar)) {
+          return stats.getDimensions()[format.getModeOrdering()[level]];
+        }
+      }
+      return stats.getAverageFiberLength(level);
+    } else if (isa<Mul>(expr)) {
+      return std::min(getTrip(to<Mul>(expr).getA(), var, bound),
+                      getTrip(to<Mul>(expr).getB(), var, bound));
+    } else if (isa<Div>(expr)) {
+      return std::min(getTrip(to<Div>(expr).getA(), var, bound),
+                      getTrip(to<Div>(expr).getB(), var, bound));
+    } else if (isa<Add>(expr)) {
+      return getTrip(to<Add>(expr).getA(), var, bound) +
+             getTrip(to<Add>(expr).getB(), var, bound);
+    } else if (isa<Sub>(expr)) {
+      return getTrip(to<Sub>(expr).getA(), var, bound) +
+             getTrip(to<Sub>(expr).getB(), var, bound);
+    } else if (isa<Neg>(expr)) {
+      return getTrip(to<Neg>(expr).getA(), var, bound);
+    } else if (isa<Sqrt>(expr)) {
+      return getTrip(to<Sqrt>(expr).getA(), var, bound);
+    } else if (isa<Cast>(expr)) {
+      return getTrip(to<Cast>(expr).getA(), var, bound);
+    } else if (isa<Reduction>(expr)) {
+      return getTrip(to<Reduction>(expr).getExpr(), var, bound);
+    }
+    return UNBOUNDED;
+  }
+
+  /// Returns the number of coordinates of the underived variable that the
+  /// assignments of a statement iterate.
+  double getTrip(IndexStmt stmt, const IndexVar& var,
+                 const set<IndexVar>& bound) {
+    const double dimension = getDimension(stmt, var);
+    double trip = 0;
+    match(stmt,
+      function<void(const AssignmentNode*)>([&](const AssignmentNode* op) {
+        trip = std::max(trip, std::min(dimension,
+                                       getTrip(op->rhs, var, bound)));
+      })
+    );
+    return std::max(trip, 1.0);
+  }
+
+  static size_t countOperations(IndexExpr expr) {
+    size_t operations = 0;
+    match(expr,
+      function<void(const UnaryExprNode*,Matcher*)>([&](
+          const UnaryExprNode* op, Matcher* ctx) {
+        operations++;
+        ctx->match(op->a);
+      }),
+      function<void(const BinaryExprNode*,Matcher*)>([&](
+          const BinaryExprNode* op, Matcher* ctx) {
+        operations++;
+        ctx->match(op->a);
+        ctx->match(op->b);
+      })
+    );
+    return operations;
+  }
+
+  static bool dependsOn(const Loop& loop, const Access& access) {
+    for (const IndexVar& var : access.getIndexVars()) {
+      if (util::contains(loop.ancestors, var)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// Returns the bytes an access moves between memory and the cache: the
+  /// footprint of the innermost loops that fits in the cache is loaded once
+  /// for every iteration of the loops around them.
+  double getTraffic(const Access& access) {
+    const TensorVar& tensor = access.getTensorVar();
+    const Format& format = tensor.getFormat();
+    if (tensor.getOrder() == 0 ||
+        format.getOrder() != (int)access.getIndexVars().size()) {
+      return 0;
+    }
+    TensorStatistics stats = getStatistics(tensor);
+
+    bool dense = true;
+    for (const ModeFormat& modeFormat : format.getModeFormats()) {
+      dense &= isDenseLevel(modeFormat);
+    }
+    double bytes = tensor.getType().getDataType().getNumBytes() +
+                   (dense ? 0 : COORDINATE_BYTES);
+    const double totalBytes = stats.getNumPositions(format.getOrder() - 1) *
+                              bytes;
+
+    // Dense accesses whose innermost loop does not follow the last level are
+    // strided, so every component costs a cache line
+    const IndexVar& lastVar =
+        access.getIndexVars()[format.getModeOrdering().back()];
+    for (auto loop = loops.rbegin(); loop != loops.rend(); ++loop) {
+      if (dependsOn(*loop, access)) {
+        if (dense && !util::contains(loop->ancestors, lastVar)) {
+          bytes = std::max(bytes, parameters.lineBytes);
+        }
+        break;
+      }
+    }
+
+    vector<double> footprints(loops.size() + 1);
+    footprints[loops.size()] = bytes;
+    for (size_t i = loops.size(); i > 0; i--) {
+      const Loop& loop = loops[i - 1];
+      footprints[i - 1] = dependsOn(loop, access)
+                          ? std::min(footprints[i] * loop.trip,
+                                     std::max(totalBytes, bytes))
+                          : footprints[i];
+    }
+    double reloads = 1;
+    for (size_t i = 0; i < loops.size(); i++) {
+      if (footprints[i] <= parameters.cacheBytes) {
+        return footprints[i] * reloads;
+      }
+      reloads *= loops[i].trip;
+    }
+    return footprints[loops.size()] * reloads;
+  }
+
+  double getExecutions() const {
+    double executions = 1;
+    for (const Loop& loop : loops) {
+      executions *= loop.trip;
+    }
+    return executions;
+  }
+
+  void visit(const Assignment& assignment) {
+    const double executions = getExecutions();
+    double operations = std::max((size_t)1,
+                                 countOperations(assignment.getRhs()) +
+                                 (assignment.getOperator().defined() ? 1 : 0));
+    if (atomic) {
+      operations += parameters.atomicOperations;
+    }
+    Work& work = inParallelLoop ? parallel : serial;
+    work.operations += executions * operations;
+    if (vectorizable && !atomic) {
+      work.vectorizableOperations += executions * operations;
+    }
+
+    const Access lhs = assignment.getLhs();
+    if (!util::contains(temporaries, lhs.getTensorVar())) {
+      work.memoryTraffic += getTraffic(lhs) *
+                            (assignment.getOperator().defined() ? 2 : 1);
+    }
+    match(assignment.getRhs(),
+      function<void(const AccessNode*)>([&](const AccessNode* op) {
+        Access access(op);
+        if (!util::contains(temporaries, access.getTensorVar())) {
+          work.memoryTraffic += getTraffic(access);
+        }
+      })
+    );
+  }
+
+  /// Returns the trip count of a loop over the variable, given the loops
+  /// around it.
+  double getTrip(const Forall& forall, const vector<IndexVar>& ancestors) {
+    double trip = 1;
+    set<IndexVar> bound = boundVars;
+    for (const IndexVar& ancestor : ancestors) {
+      if (!util::contains(underivedTrips, ancestor)) {
+        underivedTrips[ancestor] = getTrip(forall.getStmt(), ancestor, bound);
+      }
+      bound.insert(ancestor);
+      trip *= underivedTrips.at(ancestor);
+    }
+    // Loops derived from the same variables split its iterations
+    for (const Loop& loop : loops) {
+      for (const IndexVar& ancestor : ancestors) {
+        if (util::contains(loop.ancestors, ancestor)) {
+          trip /= loop.trip;
+          break;
+        }
+      }
+    }
+    trip = std::max(trip, 1.0);
+
+    const IndexVar& var = forall.getIndexVar();
+    if (util::contains(relations, var)) {
+      const IndexVarRel& rel = relations.at(var);
+      switch (rel.getRelType()) {
+        case SPLIT: {
+          auto split = rel.getNode<SplitRelNode>();
+          if (split->getOuterVar() == var) {
+            trip = std::ceil(trip / split->getSplitFactor());
+          }
+          break;
+        }
+        case DIVIDE: {
+          auto divide = rel.getNode<DivideRelNode>();
+          if (divide->getOuterVar() == var) {
+            trip = std::min(trip, (double)divide->getDivFactor());
+          }
+          break;
+        }
+        case BOUND:
+          trip = std::min(trip, (double)rel.getNode<BoundRelNode>()->getBound());
+          break;
+        default:
+          break;
+      }
+    }
+    return trip;
+  }
+
+  /// Returns true if the loop only iterates dense levels.
+  bool isDenseLoop(const Forall& forall, const vector<IndexVar>& ancestors) {
+    if (graph.isPosVariable(forall.getIndexVar())) {
+      return false;
+    }
+    bool dense = true;
+    match(forall.getStmt(),
+      function<void(const AccessNode*)>([&](const AccessNode* op) {
+        Access access(op);
+        for (const IndexVar& ancestor : ancestors) {
+          const int level = getLevel(access, ancestor);
+          if (level >= 0) {
+            const Format& format = access.getTensorVar().getFormat();
+            dense &= isDenseLevel(format.getModeFormats()[level]);
+          }
+        }
+      })
+    );
+    return dense;
+  }
+
+  /// Returns the ratio of the work of the busiest thread to the average work
+  /// of a thread if the loop is split evenly over the threads, which is
+  /// estimated from the fiber lengths of the compressed levels it iterates.
+  double getImbalance(const Forall& forall, const vector<IndexVar>& ancestors,
+                      double trip) {
+    const int numThreads = parameters.numThreads;
+    if (numThreads == 1 ||
+        forall.getParallelUnit() == ParallelUnit::CPUThreadBalanced ||
+        forall.getParallelUnit() == ParallelUnit::CPUTask) {
+      return 1;
+    }
+    IndexVar posAncestor;
+    if (graph.isPosVariable(forall.getIndexVar()) ||
+        graph.getPosIteratorAncestor(forall.getIndexVar(), &posAncestor)) {
+      return 1;
+    }
+    double imbalance = 1;
+    match(forall.getStmt(),
+      function<void(const AccessNode*)>([&](const AccessNode* op) {
+        Access access(op);
+        const Format& format = access.getTensorVar().getFormat();
+        for (const IndexVar& ancestor : ancestors) {
+          const int level = getLevel(access, ancestor);
+          if (level < 0 || level + 1 >= format.getOrder() ||
+              isDenseLevel(format.getModeFormats()[level + 1])) {
+            continue;
+          }
+          TensorStatistics stats = getStatistics(access.getTensorVar());
+          const double average = stats.getAverageFiberLength(level + 1);
+          const double perThread = std::max(1.0, trip / numThreads);
+          if (average > 0) {
+            imbalance = std::max(imbalance,
+                ((perThread - 1) * average + stats.getMaxFiberLength(level + 1))
+                / (perThread * average));
+          }
+        }
+      })
+    );
+    return std::min(imbalance, (double)numThreads);
+  }
+
+  double getTime(const Work& work, double threads) const {
+    const double operationTime =
+        (work.operations - work.vectorizableOperations +
+         work.vectorizableOperations / parameters.vectorWidth) /
+        (parameters.operationsPerSecond * threads);
+    const double bandwidth = std::min(parameters.bandwidth,
+                                      parameters.threadBandwidth * threads);
+    return std::max(operationTime, work.memoryTraffic / bandwidth);
+  }
+
+  void visit(const Forall& forall) {
+    vector<IndexVar> ancestors = graph.getUnderivedAncestors(forall.getIndexVar());
+    const double trip = getTrip(forall, ancestors);
+
+    const bool parallelized = !inParallelLoop &&
+        forall.getParallelUnit() != ParallelUnit::NotParallel;
+    double threads = 1;
+    if (parallelized) {
+      const double imbalance = getImbalance(forall, ancestors, trip);
+      threads = std::min((double)parameters.numThreads, trip) / imbalance;
+      cost.loadImbalance = std::max(cost.loadImbalance, imbalance);
+      inParallelLoop = true;
+      atomic = forall.getOutputRaceStrategy() == OutputRaceStrategy::Atomics;
+      parallel = Work();
+    }
+    const bool wasVectorizable = vectorizable;
+    vectorizable = isa<Assignment>(forall.getStmt()) &&
+                   isDenseLoop(forall, ancestors);
+
+    const set<IndexVar> wasBound = boundVars;
+    boundVars.insert(ancestors.begin(), ancestors.end());
+    loops.push_back({forall.getIndexVar(), ancestors, trip});
+    visit(forall.getStmt());
+    loops.pop_back();
+    boundVars = wasBound;
+    vectorizable = wasVectorizable;
+
+    if (parallelized) {
+      inParallelLoop = false;
+      atomic = false;
+      cost.parallelOperations += parallel.operations;
+      cost.vectorizableOperations += parallel.vectorizableOperations;
+      parallelTraffic += parallel.memoryTraffic;
+      cost.time += getTime(parallel, std::max(threads, 1.0));
+    }
+  }
+
+  void visit(IndexStmt stmt) {
+    if (isa<Forall>(stmt)) {
+      visit(to<Forall>(stmt));
+    } else if (isa<Assignment>(stmt)) {
+      visit(to<Assignment>(stmt));
+    } else if (isa<Where>(stmt)) {
+      Where where = to<Where>(stmt);
+      visit(where.getProducer());
+      visit(where.getConsumer());
+    } else if (isa<Sequence>(stmt)) {
+      visit(to<Sequence>(stmt).getDefinition());
+      visit(to<Sequence>(stmt).getMutation());
+    } else if (isa<Multi>(stmt)) {
+      visit(to<Multi>(stmt).getStmt1());
+      visit(to<Multi>(stmt).getStmt2());
+    } else if (isa<Assemble>(stmt)) {
+      visit(to<Assemble>(stmt).getQueries());
+      visit(to<Assemble>(stmt).getCompute());
+    } else if (isa<SuchThat>(stmt)) {
+      visit(to<SuchThat>(stmt).getStmt());
+    }
+  }
+};
+
+}
+
+Cost estimateCost(IndexStmt stmt,
+                  const map<TensorVar,TensorStatistics>& statistics,
+                  const CostModelParameters& parameters) {
+  string reason;
+  taco_uassert(isConcreteNotation(stmt, &reason))
+      << "The cost of a statement can only be estimated in concrete index "
+      << "notation. " << reason;
+  Cost cost = CostEstimator(stmt, statistics, parameters).estimate(stmt);
+  return cost;
+}
+
+vector<size_t>
+rankSchedules(const vector<IndexStmt>& stmts,
+              const map<TensorVar,TensorStatistics>& statistics,
+              const CostModelParameters& parameters) {
+  vector<double> times;
+  for (const IndexStmt& stmt : stmts) {
+    times.push_back(estimateCost(stmt, statistics, parameters).time);
+  }
+  vector<size_t> ranking(stmts.size());
+  std::iota(ranking.begin(), ranking.end(), 0);
+  std::stable_sort(ranking.begin(), ranking.end(), [&](size_t a, size_t b) {
+    return times[a] < times[b];
+  });
+  return ranking;
+}
+
+std::ostream& operator<<(std::ostream& os, const Cost& cost) {
+  return os << "operations: " << cost.operations
+            << " (vectorizable: " << cost.vectorizableOperations
+            << ", parallel: " << cost.parallelOperations << ")"
+            << ", memory traffic: " << cost.memoryTraffic << " bytes"
+            << ", load imbalance: " << cost.loadImbalance
+            << ", estimated time: " << cost.time << " s";
+}
+
+}
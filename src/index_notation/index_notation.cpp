@@ -1,6 +1,7 @@
 #include "taco/index_notation/index_notation.h"
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <memory>
 #include <vector>
@@ -208,7 +209,11 @@ struct Isomorphic : public IndexNotationVisitorStrict {
 
   bool check(TensorVar a, TensorVar b) {
     if (!util::contains(isoBTensor, a) && !util::contains(isoATensor, b)) {
-      if (a.getType() != b.getType() || a.getFormat() != b.getFormat()) {
+      // Format equality ignores index array types, but kernels compiled for
+      // one set of index types cannot be reused for another.
+      if (a.getType() != b.getType() || a.getFormat() != b.getFormat() ||
+          a.getFormat().getLevelArrayTypes() !=
+          b.getFormat().getLevelArrayTypes()) {
         return false;
       }
       isoBTensor.insert({a, b});
@@ -1907,6 +1912,66 @@ IndexStmt IndexStmt::reorder(std::vector<IndexVar> reorderedvars) const {
   return transformed;
 }
 
+IndexStmt IndexStmt::tile(std::vector<IndexVar> vars,
+                          std::vector<std::vector<size_t>> tileSizes) const {
+  taco_uassert(!vars.empty()) << "The tile transformation needs index variables";
+  taco_uassert(!tileSizes.empty()) << "The tile transformation needs at least "
+                                   << "one level of tile sizes";
+  for (size_t level = 0; level < tileSizes.size(); level++) {
+    taco_uassert(tileSizes[level].size() == vars.size())
+        << "Level " << level << " of the tile sizes does not have one size per "
+        << "index variable";
+    for (size_t v = 0; v < vars.size(); v++) {
+      taco_uassert(tileSizes[level][v] > 0) << "Tile sizes must be positive";
+      taco_uassert(level == 0 ||
+                   tileSizes[level - 1][v] % tileSizes[level][v] == 0)
+          << "The tile size of " << vars[v] << " at level " << level - 1
+          << " is not a multiple of its tile size at level " << level;
+    }
+  }
+
+  // Split every variable into a loop per level, which leaves the loops
+  // derived from each variable nested in the order of the levels
+  IndexStmt transformed = *this;
+  const size_t numLevels = tileSizes.size();
+  vector<vector<IndexVar>> tileVars(numLevels + 1);
+  for (size_t v = 0; v < vars.size(); v++) {
+    const string name = vars[v].getName();
+    IndexVar remaining = vars[v];
+    for (size_t level = 0; level < numLevels; level++) {
+      IndexVar outer(name + to_string(level));
+      IndexVar inner((level + 1 == numLevels) ? name + to_string(numLevels)
+                                              : name + "r" + to_string(level));
+      transformed = transformed.split(remaining, outer, inner,
+                                      tileSizes[level][v]);
+      tileVars[level].push_back(outer);
+      remaining = inner;
+    }
+    tileVars[numLevels].push_back(remaining);
+  }
+  if (vars.size() == 1) {
+    return transformed;
+  }
+
+  vector<IndexVar> order;
+  for (auto& levelVars : tileVars) {
+    order.insert(order.end(), levelVars.begin(), levelVars.end());
+  }
+  transformed = Reorder(order).apply(transformed);
+  taco_uassert(transformed.defined())
+      << "The loops over " << util::join(vars) << " must be directly nested "
+      << "to be tiled";
+  return transformed;
+}
+
+IndexStmt IndexStmt::tile(std::vector<IndexVar> vars) const {
+  vector<vector<size_t>> tileSizes =
+      getTileSizes(*this, vars, util::getCacheSizes());
+  taco_uassert(!tileSizes.empty())
+      << "The tiles of " << util::join(vars) << " do not fit in any cache";
+  return tile(vars, tileSizes);
+}
+
 IndexStmt IndexStmt::mergeby(IndexVar i, MergeStrategy strategy) const {
   string reason;
   IndexStmt transformed = SetMergeStrategy(i, strategy).apply(*this, &reason);
@@ -1916,9 +1981,43 @@ IndexStmt IndexStmt::mergeby(IndexVar i, MergeStrategy strategy) const {
   return transformed;
 }
 
+/// Assemble the results of the statement that are assembled by appending
+/// coordinates by inserting them instead, or return an undefined statement if
+/// there are no such results or they do not support ungrouped insertion.
+static IndexStmt assembleAppendedResultsByInsertion(IndexStmt stmt) {
+  const vector<TensorVar> insertedResults =
+      getAssembledByUngroupedInsertion(stmt);
+  IndexStmt assembled = stmt;
+  for (const TensorVar& result : getResults(stmt)) {
+    const vector<ModeFormat> modeFormats = result.getFormat().getModeFormats();
+    if (util::contains(insertedResults, result) ||
+        !util::any(modeFormats, [](ModeFormat m) { return m.hasAppend(); })) {
+      continue;
+    }
+    // The queries keep the index variables of the computation, so that they
+    // are parallelized together with it
+    assembled = SetAssembleStrategy(result, AssembleStrategy::Insert, false)
+                    .apply(assembled);
+    if (!assembled.defined()) {
+      return IndexStmt();
+    }
+  }
+  return (assembled != stmt) ? assembled : IndexStmt();
+}
+
 IndexStmt IndexStmt::parallelize(IndexVar i, ParallelUnit parallel_unit, OutputRaceStrategy output_race_strategy) const {
   string reason;
   IndexStmt transformed = Parallelize(i, parallel_unit, output_race_strategy).apply(*this, &reason);
+  if (!transformed.defined()) {
+    // Parallel iterations cannot append to the same results, so assemble them
+    // in two passes that are both parallelized: the first counts the
+    // coordinates of every segment, which are then scanned to build the pos
+    // arrays, and the second inserts the coordinates at their positions.
+    IndexStmt assembled = assembleAppendedResultsByInsertion(*this);
+    if (assembled.defined()) {
+      transformed = Parallelize(i, parallel_unit, output_race_strategy).apply(assembled);
+    }
+  }
   if (!transformed.defined()) {
     taco_uerror << reason;
   }
@@ -3665,6 +3764,68 @@ vector<IndexVar> getIndexVars(IndexExpr expr) {
   return visitor.indexVars;
 }
 
+vector<vector<size_t>> getTileSizes(IndexStmt stmt, const vector<IndexVar>& vars,
+                                    const vector<size_t>& cacheSizes) {
+  ProvenanceGraph provGraph(stmt);
+  set<IndexVar> tiledVars;
+  for (const IndexVar& var : vars) {
+    for (const IndexVar& ancestor : provGraph.getUnderivedAncestors(var)) {
+      tiledVars.insert(ancestor);
+    }
+  }
+
+  // The tile of an access with k tiled variables has t^k components for a
+  // tile size of t, of the component size plus a coordinate if sparse
+  vector<pair<int,double>> tileComponents;
+  auto addAccess = [&](const Access& access) {
+    int numTiled = 0;
+    for (const IndexVar& var : access.getIndexVars()) {
+      numTiled += util::contains(tiledVars, var) ? 1 : 0;
+    }
+    const TensorVar& tensor = access.getTensorVar();
+    double bytes = tensor.getType().getDataType().getNumBytes();
+    if (!isDense(tensor.getFormat())) {
+      bytes += sizeof(int);
+    }
+    tileComponents.push_back({numTiled, bytes});
+  };
+  for (const Access& access : getResultAccesses(stmt).first) {
+    addAccess(access);
+  }
+  for (const Access& access : getArgumentAccesses(stmt)) {
+    addAccess(access);
+  }
+  if (std::none_of(tileComponents.begin(), tileComponents.end(),
+                   [](const pair<int,double>& components) {
+                     return components.first > 0;
+                   })) {
+    return {};
+  }
+  auto getTileBytes = [&](size_t tileSize) {
+    double tileBytes = 0;
+    for (auto& components : tileComponents) {
+      tileBytes += std::pow((double)tileSize, components.first) *
+                   components.second;
+    }
+    return tileBytes;
+  };
+
+  vector<size_t> sortedCacheSizes = cacheSizes;
+  std::sort(sortedCacheSizes.begin(), sortedCacheSizes.end(),
+            std::greater<size_t>());
+  vector<vector<size_t>> tileSizes;
+  for (size_t cacheSize : sortedCacheSizes) {
+    size_t tileSize = 1;
+    while (getTileBytes(tileSize * 2) <= cacheSize / 2.0) {
+      tileSize *= 2;
+    }
+    if (tileSize > 1 && (tileSizes.empty() || tileSize < tileSizes.back()[0])) {
+      tileSizes.push_back(vector<size_t>(vars.size(), tileSize));
+    }
+  }
+  return tileSizes;
+}
+
 std::vector<IndexVar> getReductionVars(IndexStmt stmt) {
   const auto provGraph = ProvenanceGraph(stmt);
 
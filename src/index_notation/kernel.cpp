@@ -9,6 +9,7 @@
 #include "taco/storage/index.h"
 #include "taco/storage/array.h"
 #include "taco/taco_tensor_t.h"
+#include "taco/error.h"
 #include <taco/index_notation/transformations.h>
 #include "taco/index_notation/index_notation_nodes.h"
 
@@ -19,6 +20,10 @@ namespace taco {
 
 struct Kernel::Content {
   shared_ptr<ir::Module> module;
+
+  ir::Module::PackedFunc evaluate;
+  ir::Module::PackedFunc assemble;
+  ir::Module::PackedFunc compute;
 };
 
 Kernel::Kernel() : content(nullptr) {
@@ -31,6 +36,9 @@ Kernel::Kernel() : content(nullptr) {
 Kernel::Kernel(IndexStmt stmt, shared_ptr<ir::Module> module, void* evaluate,
                void* assemble, void* compute) : content(new Content) {
   content->module = module;
+  content->evaluate = module->getPackedFunc("evaluate");
+  content->assemble = module->getPackedFunc("assemble");
+  content->compute = module->getPackedFunc("compute");
   this->numResults = getResults(stmt).size();
   this->evaluateFunction = evaluate;
   this->assembleFunction = assemble;
@@ -64,11 +72,13 @@ void unpackResults(size_t numResults, const vector<void*> arguments,
         modeIndices.push_back(ModeIndex({size}));
         num *= ((int*)tensorData->indices[i][0])[0];
       } else if (modeType.getName() == Sparse.getName()) {
-        auto size = ((int*)tensorData->indices[i][0])[num];
-        Array pos = Array(type<int>(), tensorData->indices[i][0],
-                          num+1, Array::UserOwns);
-        Array idx = Array(type<int>(), tensorData->indices[i][1],
-                          size, Array::UserOwns);
+        Array pos = storage.adoptArray(format.getCoordinateTypePos(i),
+                                       tensorData->indices[i][0], num+1,
+                                       Array::UserOwns);
+        auto size = pos.get(num).getAsIndex();
+        Array idx = storage.adoptArray(format.getCoordinateTypeIdx(i),
+                                       tensorData->indices[i][1], size,
+                                       Array::UserOwns);
         modeIndices.push_back(ModeIndex({pos, idx}));
         num = size;
       } else {
@@ -76,34 +86,129 @@ void unpackResults(size_t numResults, const vector<void*> arguments,
       }
     }
     storage.setIndex(Index(format, modeIndices));
-    storage.setValues(Array(storage.getComponentType(), tensorData->vals, num));
+    storage.setValues(storage.adoptArray(storage.getComponentType(),
+                                         tensorData->vals, num, Array::Free));
   }
 }
 
 bool Kernel::operator()(const vector<TensorStorage>& args) const {
   vector<void*> arguments = packArguments(args);
-  int result = content->module->callFuncPacked("evaluate", arguments.data());
+  int result = content->module->callFuncPacked(content->evaluate,
+                                               arguments.data());
   unpackResults(this->numResults, arguments, args);
   return (result == 0);
 }
 
 bool Kernel::assemble(const vector<TensorStorage>& args) const {
   vector<void*> arguments = packArguments(args);
-  int result = content->module->callFuncPacked("assemble", arguments.data());
+  int result = content->module->callFuncPacked(content->assemble,
+                                               arguments.data());
   unpackResults(this->numResults, arguments, args);
   return (result == 0);
 }
 
 bool Kernel::compute(const vector<TensorStorage>& args) const {
   vector<void*> arguments = packArguments(args);
-  int result = content->module->callFuncPacked("compute", arguments.data());
+  int result = content->module->callFuncPacked(content->compute,
+                                               arguments.data());
   return (result == 0);
 }
 
+PreparedKernel Kernel::prepare(const vector<TensorStorage>& args) const {
+  taco_uassert(content != nullptr) << "Cannot prepare an undefined kernel";
+  return PreparedKernel(content->module, numResults, args);
+}
+
 bool Kernel::defined() {
   return content != nullptr;
 }
 
+
+// class PreparedKernel
+struct PreparedKernel::Content {
+  shared_ptr<ir::Module> module;
+  size_t                 numResults;
+  bool                   assembleWhileCompute;
+
+  ir::Module::PackedFunc evaluateFunction;
+  ir::Module::PackedFunc assembleFunction;
+  ir::Module::PackedFunc computeFunction;
+
+  vector<TensorStorage>  args;
+  vector<void*>          arguments;
+
+  bool call(ir::Module::PackedFunc function, bool unpack) {
+    taco_uassert(function != nullptr)
+        << "The kernel does not have the requested function";
+    int result = module->callFuncPacked(function, arguments.data());
+    if (unpack) {
+      unpackResults(numResults, arguments, args);
+      // Unpacking replaces the arrays of the results, so the taco_tensor_t
+      // structs must point to the new arrays before the next call
+      for (size_t i = 0; i < numResults; i++) {
+        arguments[i] = static_cast<taco_tensor_t*>(args[i]);
+      }
+    }
+    return (result == 0);
+  }
+};
+
+PreparedKernel::PreparedKernel() : content(nullptr) {
+}
+
+PreparedKernel::PreparedKernel(shared_ptr<ir::Module> module,
+                               size_t numResults,
+                               const vector<TensorStorage>& args,
+                               bool assembleWhileCompute)
+    : content(new Content) {
+  taco_iassert(numResults <= args.size());
+  content->module = module;
+  content->numResults = numResults;
+  content->assembleWhileCompute = assembleWhileCompute;
+  content->evaluateFunction = module->getPackedFunc("evaluate");
+  content->assembleFunction = module->getPackedFunc("assemble");
+  content->computeFunction = module->getPackedFunc("compute");
+  content->args = args;
+  content->arguments = packArguments(args);
+}
+
+bool PreparedKernel::operator()() const {
+  return content->call(content->evaluateFunction, true);
+}
+
+bool PreparedKernel::assemble() const {
+  return content->call(content->assembleFunction,
+                       !content->assembleWhileCompute);
+}
+
+bool PreparedKernel::compute() const {
+  return content->call(content->computeFunction,
+                       content->assembleWhileCompute);
+}
+
+void PreparedKernel::bind(size_t i, const TensorStorage& storage) {
+  taco_uassert(i < content->args.size())
+      << "The kernel has only " << content->args.size() << " arguments";
+  const TensorStorage& old = content->args[i];
+  taco_uassert(storage.getFormat() == old.getFormat() &&
+               storage.getDimensions() == old.getDimensions() &&
+               storage.getComponentType() == old.getComponentType())
+      << "The storage bound to a kernel argument must have the format, "
+      << "dimensions and component type it was prepared with";
+  content->args[i] = storage;
+  content->arguments[i] = static_cast<taco_tensor_t*>(storage);
+}
+
+const TensorStorage& PreparedKernel::getArgument(size_t i) const {
+  taco_uassert(i < content->args.size())
+      << "The kernel has only " << content->args.size() << " arguments";
+  return content->args[i];
+}
+
+bool PreparedKernel::defined() const {
+  return content != nullptr;
+}
+
 std::ostream& operator<<(std::ostream& os, const Kernel& kernel) {
   return os << kernel.content->module->getSource();
 }
@@ -194,14 +194,18 @@ IndexStmt SetMergeStrategy::apply(IndexStmt stmt, string* reason) const {
           if (!iterator.isOrdered()) {
             reason = "Precondition failed: Variable " 
             + i.getName() +
-            " is not ordered and cannot be galloped.";
+            " is not ordered and cannot be merged with the " +
+            MergeStrategy_NAMES[(int)transformation.getMergeStrategy()] +
+            " strategy.";
             return;
           }
         }
         if (lattice.points().size() != 1) {
           reason = "Precondition failed: The merge lattice of variable " 
                 + i.getName() +
-                " has more than 1 point and cannot be merged by galloping";
+                " has more than 1 point and cannot be merged with the " +
+                MergeStrategy_NAMES[(int)transformation.getMergeStrategy()] +
+                " strategy";
           return;
         }
 
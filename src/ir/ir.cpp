@@ -859,6 +859,20 @@ Expr GetProperty::make(Expr tensor, TensorProperty property, int mode,
   return gp;
 }
 
+Expr GetProperty::make(Expr tensor, TensorProperty property, int mode,
+                       int index, std::string name, Datatype type) {
+  taco_iassert(property == TensorProperty::Indices);
+  taco_iassert(type.isInt() || type.isUInt());
+  GetProperty* gp = new GetProperty;
+  gp->tensor = tensor;
+  gp->property = property;
+  gp->mode = mode;
+  gp->name = name;
+  gp->index = index;
+  gp->type = type;
+  return gp;
+}
+
 // Sort
 Stmt Sort::make(std::vector<Expr> args) {
   Sort* sort = new Sort;
@@ -37,8 +37,8 @@ Stmt doubleSizeIfFull(Expr a, Expr size, Expr needed) {
 }
 
 Stmt atLeastDoubleSizeIfFull(Expr a, Expr size, Expr needed) {
-  Expr newSizeVar = Var::make(util::toString(a) + "_new_size", Int());
   Expr newSize = Max::make(Mul::make(size, 2), Add::make(needed, 1));
+  Expr newSizeVar = Var::make(util::toString(a) + "_new_size", newSize.type());
   Stmt computeNewSize = VarDecl::make(newSizeVar, newSize);
   Stmt realloc = Allocate::make(a, newSizeVar, true, size);
   Stmt updateSize = Assign::make(size, newSizeVar);
@@ -433,13 +433,17 @@ ir::Stmt simplify(const ir::Stmt& stmt) {
         loopDependentVars(loopDependentVars) {}
 
     void visit(const For* op){
-      if (op->kind==LoopKind::Vectorized) 
+      // Loop bounds may refer to copy-propagated variables whose declarations
+      // are removed, so they must be rewritten too
+      Expr start = rewrite(op->start);
+      Expr end = rewrite(op->end);
+      if (op->kind==LoopKind::Vectorized)
         forLoopLevel++;
       Stmt contents = rewrite(op->contents);
-      if (contents == op->contents)
+      if (start == op->start && end == op->end && contents == op->contents)
         stmt = op;
       else
-        stmt = For::make(op->var,op->start,op->end,op->increment,contents,op->kind,op->parallel_unit,op->unrollFactor,op->vec_width);
+        stmt = For::make(op->var,start,end,op->increment,contents,op->kind,op->parallel_unit,op->unrollFactor,op->vec_width);
       if (op->kind == LoopKind::Vectorized) forLoopLevel--;
     }
 
@@ -510,6 +514,7 @@ ir::Stmt simplify(const ir::Stmt& stmt) {
 
     void visit(const Store* store){
       // arr[loc] = data
+      keepDeclaration(store->arr);
       Expr loc = rewrite(store->loc);
       Expr data = rewrite(store->data);
       stmt = (loc == store->loc && data == store->data) ? store 
@@ -519,6 +524,7 @@ ir::Stmt simplify(const ir::Stmt& stmt) {
     void visit(const Load* load){
       // arr[loc]
       // Replace loc if possible
+      keepDeclaration(load->arr);
       Expr loc = rewrite(load->loc);
       expr = (loc == load->loc)? load : Load::make(load->arr, loc, load->vector_width);
     }
@@ -529,6 +535,14 @@ ir::Stmt simplify(const ir::Stmt& stmt) {
         necessaryDecls.insert(declarations.get(expr));
       }
     }
+
+    // Arrays are not rewritten, but arrays declared in the function, such as
+    // the slices of parallel workspaces that every thread uses, must be kept
+    void keepDeclaration(Expr arr) {
+      if (declarations.contains(arr)) {
+        necessaryDecls.insert(declarations.get(arr));
+      }
+    }
   };
   Simplifier copyPropagation(findLoopDepVars.loopDependentVars);
   Stmt simplifiedStmt = copyPropagation.rewrite(stmt);
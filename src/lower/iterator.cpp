@@ -48,6 +48,10 @@ struct Iterator::Content {
   Iterator indexSetIterator;
 };
 
+static Datatype maxPositionType(Datatype a, Datatype b) {
+  return (b.getNumBits() > a.getNumBits()) ? b : a;
+}
+
 Iterator::Iterator() : content(nullptr) {
 }
 
@@ -87,12 +91,25 @@ Iterator::Iterator(IndexVar indexVar, Expr tensor, Mode mode, Iterator parent,
   if (useNameForPos) {
     posNamePrefix = name;
   }
-  content->posVar   = Var::make(name,            indexVar.getDataType());
-  content->endVar   = Var::make("p" + modeName + "_end",   indexVar.getDataType());
-  content->beginVar = Var::make("p" + modeName + "_begin", indexVar.getDataType());
+  // Positions must be wide enough to index the arrays of this level and to
+  // hold the positions of the parent level
+  Datatype posType = indexVar.getDataType();
+  if (parent.defined() && parent.getPosVar().defined()) {
+    posType = maxPositionType(posType, parent.getPosVar().type());
+  }
+  const ModePack modePack = mode.getModePack();
+  for (size_t i = 0; i < modePack.getNumArrays(); ++i) {
+    if (modePack.getArray(i).defined()) {
+      posType = maxPositionType(posType, modePack.getArray(i).type());
+    }
+  }
+
+  content->posVar   = Var::make(name,            posType);
+  content->endVar   = Var::make("p" + modeName + "_end",   posType);
+  content->beginVar = Var::make("p" + modeName + "_begin", posType);
 
   content->coordVar = Var::make(name, indexVar.getDataType());
-  content->segendVar = Var::make(modeName + "_segend", indexVar.getDataType());
+  content->segendVar = Var::make(modeName + "_segend", posType);
   content->validVar = Var::make("v" + modeName, Bool);
 }
 
@@ -290,6 +307,32 @@ ModeFunction Iterator::posAccess(const ir::Expr& pos,
   return getMode().getModeFormat().impl->posIterAccess(pos, coords, getMode());
 }
 
+ir::Expr Iterator::posStride() const {
+  taco_iassert(defined());
+  if (!content->mode.defined()) {
+    return 1;
+  }
+  return getMode().getModeFormat().impl->posIterStride(getMode());
+}
+
+ir::Expr Iterator::posBitmap() const {
+  taco_iassert(defined());
+  if (!content->mode.defined()) {
+    return ir::Expr();
+  }
+  return getMode().getModeFormat().impl->posIterBitmap(getMode());
+}
+
+ir::Expr Iterator::sliceFiber(const ir::Expr& slot,
+                              const ir::Expr& numFibers) const {
+  taco_iassert(defined());
+  if (!content->mode.defined()) {
+    return ir::Expr();
+  }
+  return getMode().getModeFormat().impl->posIterSliceFiber(slot, numFibers,
+                                                           getMode());
+}
+
 ModeFunction Iterator::locate(const std::vector<ir::Expr>& coords) const {
   taco_iassert(defined() && content->mode.defined());
   return getMode().getModeFormat().impl->locate(getParent().getPosVar(),
@@ -587,9 +630,13 @@ void Iterators::createAccessIterators(Access access, Format format, Expr tensorI
     taco_iassert(modeTypePack.getModeFormats().size() > 0);
 
     int modeNumber = format.getModeOrdering()[level-1];
+    std::vector<Datatype> arrayTypes;
+    if ((size_t)level <= format.getLevelArrayTypes().size()) {
+      arrayTypes = format.getLevelArrayTypes()[level-1];
+    }
     ModePack modePack(modeTypePack.getModeFormats().size(),
                       modeTypePack.getModeFormats()[0], tensorIR,
-                      modeNumber, level);
+                      modeNumber, level, arrayTypes);
 
     int pos = 0;
     for (auto& modeType : modeTypePack.getModeFormats()) {
@@ -626,7 +673,12 @@ void Iterators::createAccessIterators(Access access, Format format, Expr tensorI
         auto tvFormat = tv.getFormat();
         auto tvShape = tv.getType().getShape();
         auto accessIvar = access.getIndexVars()[modeNumber];
-        ModePack tvModePack(1, tvFormat.getModeFormats()[0], tvVar, 0, 1);
+        std::vector<Datatype> tvArrayTypes;
+        if (!tvFormat.getLevelArrayTypes().empty()) {
+          tvArrayTypes = tvFormat.getLevelArrayTypes()[0];
+        }
+        ModePack tvModePack(1, tvFormat.getModeFormats()[0], tvVar, 0, 1,
+                            tvArrayTypes);
         Mode tvMode(tvVar, tvShape.getDimension(0), 1, tvFormat.getModeFormats()[0], tvModePack, 0, ModeFormat());
         // Finally, construct the iterator and register it as an indexSetIterator.
         auto iter = Iterator(accessIvar, tvVar, tvMode, {tvVar}, accessIvar.getName() + tv.getName() + "_filter");
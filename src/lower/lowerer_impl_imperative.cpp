@@ -78,11 +78,151 @@ static void createCapacityVars(const map<TensorVar, Expr>& tensorVars,
                                map<Expr, Expr>* capacityVars) {
   for (auto& tensorVar : tensorVars) {
     Expr tensor = tensorVar.second;
-    Expr capacityVar = Var::make(util::toString(tensor) + "_capacity", Int());
+    Datatype capacityType = tensorVar.first.getFormat().getIndexType();
+    if (capacityType.getNumBits() < Int().getNumBits()) {
+      capacityType = Int();
+    }
+    Expr capacityVar = Var::make(util::toString(tensor) + "_capacity",
+                                 capacityType);
     capacityVars->insert({tensor, capacityVar});
   }
 }
 
+/// Returns true if loops of the parallel unit run on CPU threads (OpenMP),
+/// which cannot break out of the loop and index workspaces by thread.
+static bool isCPUThreadUnit(ParallelUnit unit) {
+  return unit == ParallelUnit::CPUThread || unit == ParallelUnit::CPUTask ||
+         unit == ParallelUnit::CPUThreadBalanced;
+}
+
+/// Returns the runtime function that searches index arrays of the given
+/// array's type, e.g. `taco_binarySearchAfter64` for int64_t arrays.
+static std::string indexArrayFunction(std::string name, Expr array) {
+  const int bits = array.type().getNumBits();
+  taco_uassert(bits == 32 || bits == 64)
+      << "Index arrays searched by " << name << " must have 32 or 64 bits";
+  return (bits == 64) ? name + "64" : name;
+}
+
+/// Returns true if consecutive positions of the iterator's fibers are adjacent.
+static bool hasUnitPosStride(const Iterator& iterator) {
+  Expr stride = iterator.posStride();
+  return isa<ir::Literal>(stride) && to<ir::Literal>(stride)->equalsScalar(1);
+}
+
+/// Returns true if the iterator's level stores its coordinates in a plain
+/// integer array, which can be searched by taco_gallop, unlike e.g. the words
+/// of packed or bitmap levels.
+static bool hasCoordinateArray(const Iterator& iterator) {
+  const std::string name = iterator.getMode().getModeFormat().getName();
+  return name == Compressed.getName() || name == Singleton.getName();
+}
+
+/// Returns the first position between `begin` and `end` of the iterator's
+/// level whose coordinate is not less than `target`.
+static Expr searchCoordinateAfter(const Iterator& iterator, Expr begin,
+                                  Expr end, Expr target, Datatype type) {
+  Expr crd = iterator.getMode().getModePack().getArray(1);
+  const std::string name = iterator.getMode().getModeFormat().getName();
+  if (name == Packed.getName()) {
+    return ir::Call::make("taco_packed_binarySearchAfter",
+                          {crd, begin, end, target}, type);
+  }
+  if (!hasCoordinateArray(iterator)) {
+    taco_uerror << "Searching for coordinates requires levels that store "
+                << "coordinates in an array, but " << iterator.getTensor()
+                << " has a " << name << " level";
+  }
+  return ir::Call::make(indexArrayFunction("taco_binarySearchAfter", crd),
+                        {crd, begin, end, target}, type);
+}
+
+/// Returns true if the iterator's coordinates can be intersected by
+/// taco_intersect_next, which requires a compressed level without duplicates
+/// whose coordinates are 32-bit integers.
+static bool canIntersectWithVectors(const Iterator& iterator) {
+  return iterator.hasPosIter() && iterator.isUnique() &&
+         iterator.isOrdered() && !iterator.isWindowed() &&
+         !iterator.hasIndexSet() &&
+         iterator.getMode().getModeFormat().getName() == Compressed.getName() &&
+         iterator.getMode().getModePack().getArray(1).type() == Int32;
+}
+
+/// Returns true if the iterator's segments can be merged either with two
+/// fingers or by galloping, which requires a compressed level without
+/// duplicates whose segments are contiguous and whose coordinates are stored
+/// in an array.
+static bool canGallopAdaptively(const Iterator& iterator) {
+  return iterator.hasPosIter() && iterator.isUnique() && !iterator.isFull() &&
+         hasUnitPosStride(iterator) && hasCoordinateArray(iterator) &&
+         !iterator.isWindowed() && !iterator.hasIndexSet();
+}
+
+/// Returns the position array of a compressed level whose segments are the
+/// iterations of a loop over the coordinates of a top-level dense mode, e.g.
+/// the rows of a CSR matrix, or an undefined expression if there is none.
+static Expr getBalancingPosArray(const vector<Iterator>& locators) {
+  for (auto& locator : locators) {
+    if (!locator.getParent().isRoot() || !locator.isFull()) {
+      continue;
+    }
+    Iterator child = locator.getChild();
+    if (!child.defined() || !child.hasPosIter() || child.isWindowed()) {
+      continue;
+    }
+    ModeFunction bounds = child.posBounds(locator.getPosVar());
+    const Load* begin = bounds[0].as<Load>();
+    if (!bounds.compute().defined() && begin != nullptr &&
+        begin->loc == locator.getPosVar()) {
+      return begin->arr;
+    }
+  }
+  return Expr();
+}
+
+/// Lowers a parallel loop over [begin, end) that gives every thread a range of
+/// iterations covering the same number of positions in posArray.  The loop
+/// runs one iteration per thread, and each thread binary searches posArray for
+/// the boundaries of its range.
+static Stmt lowerBalancedLoop(Expr coordinate, Expr begin, Expr end,
+                              Expr posArray, Stmt body) {
+  const string name = util::toString(coordinate);
+  const Datatype posType = posArray.type();
+  Expr numThreads = Var::make(name + "_threads", Int());
+  Expr thread = Var::make(name + "_thread", Int());
+  Expr threadBegin = Var::make(name + "_begin", coordinate.type());
+  Expr threadEnd = Var::make(name + "_end", coordinate.type());
+
+  Expr firstPos = Load::make(posArray, begin);
+  Expr numPos = ir::Sub::make(Load::make(posArray, end), firstPos);
+  auto split = [&](Expr t) {
+    Expr share = ir::Div::make(ir::Mul::make(ir::Cast::make(numPos, Int64),
+                                             ir::Cast::make(t, Int64)),
+                               ir::Cast::make(numThreads, Int64));
+    Expr target = ir::Add::make(firstPos, ir::Cast::make(share, posType));
+    return ir::Call::make(indexArrayFunction("taco_binarySearchAfter",
+                                             posArray),
+                          {posArray, begin, end, target}, posType);
+  };
+
+  // The first and last ranges end at the loop bounds, so iterations without
+  // positions at either end are not skipped.
+  Stmt threadBody = Block::make(
+      VarDecl::make(threadBegin, begin),
+      IfThenElse::make(Gt::make(thread, 0),
+                       Assign::make(threadBegin, split(thread))),
+      VarDecl::make(threadEnd, end),
+      IfThenElse::make(Lt::make(thread, ir::Sub::make(numThreads, 1)),
+                       Assign::make(threadEnd,
+                                    split(ir::Add::make(thread, 1)))),
+      For::make(coordinate, threadBegin, threadEnd, 1, body));
+  return Block::make(
+      VarDecl::make(numThreads,
+                    ir::Call::make("omp_get_max_threads", {}, Int())),
+      For::make(thread, 0, numThreads, 1, threadBody, LoopKind::Static,
+                ParallelUnit::CPUThreadBalanced));
+}
+
 static void createReducedValueVars(const vector<Access>& inputAccesses,
                                    map<Access, Expr>* reducedValueVars) {
   for (const auto& access : inputAccesses) {
@@ -213,7 +353,9 @@ static std::set<Expr> hasSparseInserts(IndexStmt stmt, Iterators iterators,
               [](Iterator it){ return !it.isFull() && 
                                       !it.isDimensionIterator(); }) ||
           any(lattice.points()[0].locators(), 
-              [](Iterator it) { return !it.isFull(); })) {
+              [](Iterator it) { return !it.isFull(); }) ||
+          any(lattice.results(),
+              [](Iterator it) { return it.hasInsert() && !it.isFull(); })) {
         for (const auto& result : lattice.results()) {
           // FIXME: Also zero init if result is assembled by ungrouped insertion
           // and is not compact or not unpadded (i.e., if result allocates
@@ -342,9 +484,17 @@ LowererImplImperative::lower(IndexStmt stmt, string name,
         // If the mode has an index set, then the dimension is the size of
         // the index set.
         return ir::Literal::make(a.getIndexSet(mode).size());
-      } else {
-        return GetProperty::make(tensorVars.at(tv), TensorProperty::Dimension, mode);
       }
+      // Small fixed block sizes of blocked formats are constants, so loops
+      // within blocks have constant trip counts that can be unrolled and
+      // vectorized.
+      const Dimension& size = tv.getType().getShape().getDimension(mode);
+      const Format& format = tv.getFormat();
+      if (isBlocked(format) && mode >= format.getOrder() / 2 &&
+          size.isFixed() && size.getSize() < 16) {
+        return ir::Literal::make((int)size.getSize());
+      }
+      return GetProperty::make(tensorVars.at(tv), TensorProperty::Dimension, mode);
     };
     match(stmt,
       function<void(const AssignmentNode*, Matcher*)>([&](
@@ -788,14 +938,24 @@ Stmt LowererImplImperative::lowerForall(Forall forall)
   if (temp != temporaryInitialization.end() && forall.getParallelUnit() ==
       ParallelUnit::NotParallel && !isScalar(temp->second.getTemporary().getType()))
     temporaryValuesInitFree = codeToInitializeTemporary(temp->second);
-  else if (temp != temporaryInitialization.end() && forall.getParallelUnit() ==
-           ParallelUnit::CPUThread && !isScalar(temp->second.getTemporary().getType())) {
+  else if (temp != temporaryInitialization.end() &&
+           isCPUThreadUnit(forall.getParallelUnit()) &&
+           !isScalar(temp->second.getTemporary().getType())) {
     temporaryValuesInitFree = codeToInitializeTemporaryParallel(temp->second, forall.getParallelUnit());
   }
 
   Stmt loops;
+  // Emit a loop over the words of bitmaps (optimization)
+  if (canLowerForallBitmap(forall, caseLattice)) {
+    loops = lowerForallBitmap(forall, caseLattice, reducedAccesses,
+                              recoveryStmt);
+  }
+  // Emit a loop over the slices of a sliced level (optimization)
+  else if (canLowerForallSlices(forall, caseLattice)) {
+    loops = lowerForallSlices(forall, caseLattice, recoveryStmt);
+  }
   // Emit a loop that iterates over over a single iterator (optimization)
-  if (caseLattice.iterators().size() == 1 && caseLattice.iterators()[0].isUnique()) {
+  else if (caseLattice.iterators().size() == 1 && caseLattice.iterators()[0].isUnique()) {
     MergeLattice loopLattice = caseLattice.getLoopLattice();
 
     MergePoint point = loopLattice.points()[0];
@@ -1090,6 +1250,8 @@ Stmt LowererImplImperative::searchForFusedPositionStart(Forall forall, Iterator
       }
       taco_iassert(blockSize.defined());
 
+      taco_uassert(posIteratorLevel.getMode().getModePack().getArray(0).type().getNumBits() == 32)
+          << "GPU position splits require 32-bit position arrays";
       if (i == (int) underivedAncestors.size() - 2) {
         std::vector<Expr> args = {
                 posIteratorLevel.getMode().getModePack().getArray(0), // array
@@ -1173,11 +1335,14 @@ Stmt LowererImplImperative::searchForFusedPositionStart(Forall forall, Iterator
     };
     Expr posVarUnknown = this->iterators.modeIterator(underivedAncestors[i]).getPosVar();
     searchForUnderivedStart.push_back(ir::VarDecl::make(posVarUnknown,
-                                                        ir::Call::make("taco_binarySearchBefore", binarySearchArgs,
+                                                        ir::Call::make(indexArrayFunction("taco_binarySearchBefore",
+                                                                                          binarySearchArgs[0]),
+                                                                       binarySearchArgs,
                                                                        getCoordinateVar(underivedAncestors[i]).type())));
     Stmt locateCoordVar;
     if (posIteratorLevel.getParent().hasPosIter()) {
-      locateCoordVar = ir::VarDecl::make(indexVarToExprMap[underivedAncestors[i]], ir::Load::make(posIteratorLevel.getParent().getMode().getModePack().getArray(1), posVarUnknown));
+      ModeFunction posAccess = posIteratorLevel.getParent().posAccess(posVarUnknown, {});
+      locateCoordVar = ir::VarDecl::make(indexVarToExprMap[underivedAncestors[i]], posAccess[0]);
     }
     else {
       locateCoordVar = ir::VarDecl::make(indexVarToExprMap[underivedAncestors[i]], posVarUnknown);
@@ -1216,6 +1381,16 @@ Stmt LowererImplImperative::lowerForallDimension(Forall forall,
   // Emit loop with preamble and postamble
   std::vector<ir::Expr> bounds = provGraph.deriveIterBounds(forall.getIndexVar(), definedIndexVarsOrdered, underivedBounds, indexVarToExprMap, iterators);
 
+  if (forall.getParallelUnit() == ParallelUnit::CPUThreadBalanced &&
+      !ignoreVectorize) {
+    Expr posArray = getBalancingPosArray(locators);
+    if (posArray.defined()) {
+      return Block::blanks(lowerBalancedLoop(coordinate, bounds[0], bounds[1],
+                                             posArray, body),
+                           posAppend);
+    }
+  }
+
   LoopKind kind = LoopKind::Serial;
   if (forall.getParallelUnit() == ParallelUnit::CPUVector && !ignoreVectorize) {
     kind = LoopKind::Vectorized;
@@ -1315,10 +1490,18 @@ Stmt LowererImplImperative::lowerForallPosition(Forall forall, Iterator iterator
   Expr coordinate = getCoordinateVar(forall.getIndexVar());
   Stmt declareCoordinate = Stmt();
   Stmt strideGuard = Stmt();
+  Stmt foundGuard = Stmt();
   Stmt boundsGuard = Stmt();
   if (provGraph.isCoordVariable(forall.getIndexVar())) {
-    Expr coordinateArray = iterator.posAccess(iterator.getPosVar(),
-                                              coordinates(iterator)).getResults()[0];
+    ModeFunction posAccess = iterator.posAccess(iterator.getPosVar(),
+                                                coordinates(iterator));
+    Expr coordinateArray = posAccess.getResults()[0];
+    // Skip positions that do not hold a coordinate, e.g. the empty slots of
+    // hashed levels
+    if (!isValue(posAccess.getResults()[1], true)) {
+      foundGuard = IfThenElse::make(ir::Neg::make(posAccess.getResults()[1]),
+                                    ir::Continue::make());
+    }
     // If the iterator is windowed, we must recover the coordinate index
     // variable from the windowed space.
     if (iterator.isWindowed()) {
@@ -1333,7 +1516,7 @@ Stmt LowererImplImperative::lowerForallPosition(Forall forall, Iterator iterator
       // If this forall is being parallelized via CPU threads (OpenMP), then we can't
       // emit a `break` statement, since OpenMP doesn't support breaking out of a
       // parallel loop. Instead, we'll bound the top of the loop and omit the check.
-      if (forall.getParallelUnit() != ParallelUnit::CPUThread) {
+      if (!isCPUThreadUnit(forall.getParallelUnit())) {
         boundsGuard = this->upperBoundGuardForWindowPosition(iterator, coordinate);
       }
     }
@@ -1377,7 +1560,7 @@ Stmt LowererImplImperative::lowerForallPosition(Forall forall, Iterator iterator
       // As discussed above, if this position loop is parallelized over CPU
       // threads (OpenMP), then we need to have an explicit upper bound to
       // the for loop, instead of breaking out of the loop in the middle.
-      if (forall.getParallelUnit() == ParallelUnit::CPUThread) {
+      if (isCPUThreadUnit(forall.getParallelUnit())) {
         endBound = this->searchForEndOfWindowPosition(iterator, startBoundCopy, endBound);
       }
     }
@@ -1394,7 +1577,8 @@ Stmt LowererImplImperative::lowerForallPosition(Forall forall, Iterator iterator
     endBound = endBounds[1];
   }
 
-  Stmt loop = Block::make(strideGuard, declareCoordinate, boundsGuard, body);
+  Stmt loop = Block::make(strideGuard, foundGuard, declareCoordinate,
+                          boundsGuard, body);
   if (iterator.isBranchless() && iterator.isCompact() && 
       (iterator.getParent().isRoot() || iterator.getParent().isUnique())) {
     loop = Block::make(VarDecl::make(iterator.getPosVar(), startBound), loop);
@@ -1409,7 +1593,8 @@ Stmt LowererImplImperative::lowerForallPosition(Forall forall, Iterator iterator
       kind = LoopKind::Runtime;
     }
 
-    loop = For::make(iterator.getPosVar(), startBound, endBound, 1, loop, kind,
+    loop = For::make(iterator.getPosVar(), startBound, endBound,
+                     iterator.posStride(), loop, kind,
                      ignoreVectorize ? ParallelUnit::NotParallel : forall.getParallelUnit(), 
 		     ignoreVectorize ? 0 : forall.getUnrollFactor(), (kind==LoopKind::Vectorized) * 4);
   }
@@ -1418,6 +1603,302 @@ Stmt LowererImplImperative::lowerForallPosition(Forall forall, Iterator iterator
   return Block::blanks(boundsCompute, loop, posAppend);
 }
 
+bool LowererImplImperative::canLowerForallBitmap(Forall forall,
+                                                 MergeLattice caseLattice) {
+  if (caseLattice.iterators().empty() ||
+      (forall.getParallelUnit() != ParallelUnit::NotParallel &&
+       !isCPUThreadUnit(forall.getParallelUnit())) ||
+      !provGraph.isUnderived(forall.getIndexVar())) {
+    return false;
+  }
+  for (const Iterator& iterator : caseLattice.iterators()) {
+    if (!iterator.posBitmap().defined() || iterator.isWindowed() ||
+        !(iterator.getParent().isRoot() || iterator.getParent().isUnique())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Stmt LowererImplImperative::lowerForallBitmap(Forall forall,
+                                              MergeLattice caseLattice,
+                                              set<Access> reducedAccesses,
+                                              ir::Stmt recoveryStmt)
+{
+  MergePoint point = caseLattice.points()[0];
+  vector<Iterator> appenders;
+  vector<Iterator> inserters;
+  tie(appenders, inserters) = splitAppenderAndInserters(point.results());
+
+  // Unmarked positions of bitmaps hold zeros, so the iterators of the lattice
+  // are located like the other operands
+  vector<Iterator> locators = combine(point.iterators(), point.locators());
+
+  // Combine the words of operands without which the loop body computes
+  // nothing with and, or else the words of all operands with or
+  vector<Iterator> required;
+  vector<Iterator> bitmaps;
+  for (const Iterator& locator : locators) {
+    if (!locator.posBitmap().defined() || locator.isWindowed() ||
+        !(locator.getParent().isRoot() || locator.getParent().isUnique())) {
+      continue;
+    }
+    bitmaps.push_back(locator);
+    Access access = iterators.modeAccess(locator).getAccess();
+    if (!zero(forall.getStmt(), {access}).defined()) {
+      required.push_back(locator);
+    }
+  }
+  taco_iassert(!bitmaps.empty());
+
+  IndexVar indexVar = forall.getIndexVar();
+  Expr wordVar = Var::make(indexVar.getName() + "w", Int());
+  Expr bitsVar = Var::make(indexVar.getName() + "bits", UInt64);
+  Expr bits;
+  for (const Iterator& bitmap : required.empty() ? bitmaps : required) {
+    Expr fiberBegin = ir::Div::make(ir::Mul::make(bitmap.getParent().getPosVar(),
+                                                  bitmap.getWidth()), 64);
+    Expr word = Load::make(bitmap.posBitmap(),
+                           ir::Add::make(fiberBegin, wordVar));
+    if (!bits.defined()) {
+      bits = word;
+    } else if (required.empty()) {
+      bits = ir::BitOr::make(bits, word);
+    } else {
+      bits = ir::BitAnd::make(bits, word);
+    }
+  }
+
+  if (forall.getParallelUnit() != ParallelUnit::NotParallel && forall.getOutputRaceStrategy() == OutputRaceStrategy::Atomics) {
+    markAssignsAtomicDepth++;
+  }
+
+  Expr coordinate = getCoordinateVar(indexVar);
+  Stmt body = lowerForallBody(coordinate, forall.getStmt(), locators,
+                              inserters, appenders, caseLattice,
+                              reducedAccesses, forall.getMergeStrategy());
+
+  if (forall.getParallelUnit() != ParallelUnit::NotParallel && forall.getOutputRaceStrategy() == OutputRaceStrategy::Atomics) {
+    markAssignsAtomicDepth--;
+  }
+
+  body = Block::make(recoveryStmt, body);
+
+  // Visit the marked positions of the word in order
+  Expr firstPos = ir::Call::make("taco_bitmap_ctz", {bitsVar}, Int());
+  Stmt declareCoordinate =
+      VarDecl::make(coordinate, ir::Add::make(ir::Mul::make(wordVar, 64),
+                                              firstPos));
+  Stmt clearPos = Assign::make(bitsVar,
+      ir::BitAnd::make(bitsVar, ir::Sub::make(bitsVar, 1)));
+  Stmt visitPositions = While::make(ir::Neq::make(bitsVar, 0),
+                                    Block::make(declareCoordinate, clearPos,
+                                                body));
+
+  // Words hold distinct coordinates, so they can be visited in parallel
+  LoopKind kind = LoopKind::Serial;
+  if (forall.getParallelUnit() != ParallelUnit::NotParallel &&
+      forall.getOutputRaceStrategy() != OutputRaceStrategy::ParallelReduction &&
+      !ignoreVectorize) {
+    kind = LoopKind::Runtime;
+  }
+  Expr numWords = ir::Div::make(bitmaps[0].getWidth(), 64);
+  Stmt loop = For::make(wordVar, 0, numWords, 1,
+                        Block::make(VarDecl::make(bitsVar, bits),
+                                    visitPositions),
+                        kind,
+                        ignoreVectorize ? ParallelUnit::NotParallel
+                                        : forall.getParallelUnit(),
+                        ignoreVectorize ? 0 : forall.getUnrollFactor());
+
+  // Code to append positions
+  Stmt posAppend = generateAppendPositions(appenders);
+
+  return Block::blanks(loop, posAppend);
+}
+
+bool LowererImplImperative::canLowerForallSlices(Forall forall,
+                                                 MergeLattice caseLattice) {
+  if (!generateComputeCode() ||
+      (forall.getParallelUnit() != ParallelUnit::NotParallel &&
+       !isCPUThreadUnit(forall.getParallelUnit())) ||
+      forall.getUnrollFactor() > 0 ||
+      !provGraph.isUnderived(forall.getIndexVar()) ||
+      caseLattice.iterators().size() != 1 ||
+      !caseLattice.iterators()[0].isDimensionIterator() ||
+      !isa<Where>(forall.getStmt())) {
+    return false;
+  }
+
+  // The rows reduce into a scalar that is assigned to a dense result
+  Where where = to<Where>(forall.getStmt());
+  TensorVar temporary = where.getTemporary();
+  if (!isScalar(temporary.getType()) || !isa<Assignment>(where.getConsumer()) ||
+      !isa<Forall>(where.getProducer())) {
+    return false;
+  }
+  Assignment consumer = to<Assignment>(where.getConsumer());
+  if ((consumer.getOperator().defined() &&
+       !isa<taco::Add>(consumer.getOperator())) ||
+      !isa<Access>(consumer.getRhs()) ||
+      to<Access>(consumer.getRhs()).getTensorVar() != temporary) {
+    return false;
+  }
+  for (const ModeFormat& modeFormat :
+       consumer.getLhs().getTensorVar().getFormat().getModeFormats()) {
+    if (modeFormat.getName() != Dense.getName()) {
+      return false;
+    }
+  }
+  Forall slices = to<Forall>(where.getProducer());
+  if (slices.getParallelUnit() != ParallelUnit::NotParallel ||
+      slices.getUnrollFactor() > 0 ||
+      !provGraph.isUnderived(slices.getIndexVar()) ||
+      !isa<Assignment>(slices.getStmt())) {
+    return false;
+  }
+  Assignment reduction = to<Assignment>(slices.getStmt());
+  if (reduction.getLhs().getTensorVar() != temporary ||
+      !isa<taco::Add>(reduction.getOperator())) {
+    return false;
+  }
+
+  // The loop over the rows of the slices is the only one that is merged
+  vector<Expr> bounds = provGraph.deriveIterBounds(forall.getIndexVar(),
+      definedIndexVarsOrdered, underivedBounds, indexVarToExprMap, iterators);
+  MergeLattice sliceLattice = getSliceLattice(slices);
+  if (!isValue(bounds[0], 0) || sliceLattice.iterators().size() != 1 ||
+      sliceLattice.points().size() != 1 ||
+      !sliceLattice.points()[0].results().empty()) {
+    return false;
+  }
+  Iterator iterator = sliceLattice.iterators()[0];
+  Iterator parent = iterator.getParent();
+  return iterator.sliceFiber(0, bounds[1]).defined() &&
+         !iterator.isWindowed() && !parent.isRoot() &&
+         parent.getParent().isRoot() && parent.hasLocate() &&
+         parent.getIndexVar() == forall.getIndexVar();
+}
+
+MergeLattice LowererImplImperative::getSliceLattice(Forall slices) {
+  definedIndexVars.insert(slices.getIndexVar());
+  MergeLattice sliceLattice = MergeLattice::make(slices, iterators, provGraph,
+                                                 definedIndexVars,
+                                                 whereTempsToResult);
+  definedIndexVars.erase(slices.getIndexVar());
+  return sliceLattice;
+}
+
+Stmt LowererImplImperative::lowerForallSlices(Forall forall,
+                                              MergeLattice caseLattice,
+                                              ir::Stmt recoveryStmt)
+{
+  Where where = to<Where>(forall.getStmt());
+  Assignment consumer = to<Assignment>(where.getConsumer());
+  Forall slices = to<Forall>(where.getProducer());
+  Assignment reduction = to<Assignment>(slices.getStmt());
+
+  MergePoint point = caseLattice.getLoopLattice().points()[0];
+  vector<Iterator> appenders;
+  vector<Iterator> inserters;
+  tie(appenders, inserters) = splitAppenderAndInserters(point.results());
+  MergeLattice sliceLattice = getSliceLattice(slices);
+  Iterator iterator = sliceLattice.iterators()[0];
+
+  IndexVar indexVar = forall.getIndexVar();
+  Expr numFibers = provGraph.deriveIterBounds(indexVar, definedIndexVarsOrdered,
+                                              underivedBounds,
+                                              indexVarToExprMap, iterators)[1];
+  Expr height = iterator.posStride();
+  Expr sliceVar = Var::make(indexVar.getName() + "s", Int());
+  Expr columnVar = Var::make(indexVar.getName() + "k", Int());
+  Expr laneVar = Var::make(indexVar.getName() + "c", Int());
+  Expr firstSlot = ir::Mul::make(sliceVar, height);
+
+  // The first fiber of a slice is as long as the slice
+  Expr numLanes = Var::make(indexVar.getName() + "lanes", Int());
+  Expr firstFiber = Var::make(indexVar.getName() + "first", Int());
+  Expr sliceBegin = Var::make(indexVar.getName() + "begin", Int());
+  Expr sliceLength = Var::make(indexVar.getName() + "length", Int());
+  ModeFunction sliceBounds = iterator.posBounds(firstFiber);
+  Stmt declareSlice = Block::make(
+      VarDecl::make(numLanes, ir::Min::make(height,
+                                            ir::Sub::make(numFibers,
+                                                          firstSlot))),
+      VarDecl::make(firstFiber, iterator.sliceFiber(firstSlot, numFibers)),
+      sliceBounds.compute(),
+      VarDecl::make(sliceBegin, sliceBounds[0]),
+      VarDecl::make(sliceLength,
+                    ir::Div::make(ir::Sub::make(sliceBounds[1], sliceBegin),
+                                  height)));
+
+  // Every lane of a slice holds a distinct row
+  Expr coordinate = getCoordinateVar(indexVar);
+  Stmt declareRow = Block::make(
+      VarDecl::make(coordinate,
+                    iterator.sliceFiber(ir::Add::make(firstSlot, laneVar),
+                                        numFibers)),
+      recoveryStmt,
+      declLocatePosVars(inserters, true),
+      declLocatePosVars(point.locators()));
+
+  // The rows of results that are assigned are cleared, since the columns of
+  // the slices add into them
+  Stmt clearRows;
+  if (!consumer.getOperator().defined()) {
+    Assignment clear(consumer.getLhs(),
+                     Literal::zero(consumer.getLhs().getDataType()));
+    clearRows = For::make(laneVar, 0, numLanes, 1,
+                          Block::make(declareRow, lower(clear)));
+  }
+
+  IndexVar sliceIndexVar = slices.getIndexVar();
+  definedIndexVars.insert(sliceIndexVar);
+  definedIndexVarsOrdered.push_back(sliceIndexVar);
+  Expr pos = iterator.getPosVar();
+  Expr sliceCoordinate = getCoordinateVar(sliceIndexVar);
+  ModeFunction posAccess = iterator.posAccess(pos, coordinates(iterator));
+  Assignment addToRow(consumer.getLhs(), reduction.getRhs(), taco::Add());
+  Stmt body = Block::make(
+      declareRow,
+      VarDecl::make(pos, ir::Add::make(sliceBegin,
+                                       ir::Add::make(ir::Mul::make(columnVar,
+                                                                   height),
+                                                     laneVar))),
+      VarDecl::make(sliceCoordinate, posAccess[0]),
+      declLocatePosVars(sliceLattice.points()[0].locators()),
+      lower(addToRow));
+  definedIndexVars.erase(sliceIndexVar);
+  definedIndexVarsOrdered.pop_back();
+
+  // The positions of the lanes of a column are adjacent
+  Stmt columns = For::make(columnVar, 0, sliceLength, 1,
+                           For::make(laneVar, 0, numLanes, 1, body,
+                                     LoopKind::Vectorized,
+                                     ParallelUnit::NotParallel, 0));
+
+  // Slices hold distinct rows, so they can be visited in parallel
+  LoopKind kind = LoopKind::Serial;
+  if (forall.getParallelUnit() != ParallelUnit::NotParallel &&
+      forall.getOutputRaceStrategy() != OutputRaceStrategy::ParallelReduction &&
+      !ignoreVectorize) {
+    kind = LoopKind::Runtime;
+  }
+  Expr numSlices = ir::Div::make(ir::Add::make(numFibers,
+                                               ir::Sub::make(height, 1)),
+                                 height);
+  Stmt loop = For::make(sliceVar, 0, numSlices, 1,
+                        Block::make(declareSlice, clearRows, columns),
+                        kind,
+                        ignoreVectorize ? ParallelUnit::NotParallel
+                                        : forall.getParallelUnit());
+
+  // Code to append positions
+  Stmt posAppend = generateAppendPositions(appenders);
+
+  return Block::blanks(loop, posAppend);
+}
+
 Stmt LowererImplImperative::lowerForallFusedPosition(Forall forall, Iterator iterator,
                                       vector<Iterator> locators,
                                       vector<Iterator> inserters,
@@ -1426,11 +1907,19 @@ Stmt LowererImplImperative::lowerForallFusedPosition(Forall forall, Iterator ite
                                       set<Access> reducedAccesses,
                                       ir::Stmt recoveryStmt)
 {
+  taco_uassert(hasUnitPosStride(iterator))
+      << "Levels whose positions are not contiguous, such as sliced levels, "
+      << "cannot be iterated by fused position loops";
+
   Expr coordinate = getCoordinateVar(forall.getIndexVar());
   Stmt declareCoordinate = Stmt();
   if (provGraph.isCoordVariable(forall.getIndexVar())) {
-    Expr coordinateArray = iterator.posAccess(iterator.getPosVar(),
-                                              coordinates(iterator)).getResults()[0];
+    ModeFunction posAccess = iterator.posAccess(iterator.getPosVar(),
+                                                coordinates(iterator));
+    taco_uassert(isValue(posAccess.getResults()[1], true))
+        << "Levels with empty positions, such as hashed levels, cannot be "
+        << "iterated by fused position loops";
+    Expr coordinateArray = posAccess.getResults()[0];
     declareCoordinate = VarDecl::make(coordinate, coordinateArray);
   }
 
@@ -1496,7 +1985,8 @@ Stmt LowererImplImperative::lowerForallFusedPosition(Forall forall, Iterator ite
       Expr loopcond = ir::Eq::make(posVarKnown, posBoundsLevel[1]);
       Stmt locateCoordVar;
       if (posIteratorLevel.getParent().hasPosIter()) {
-        locateCoordVar = ir::Assign::make(coordVarUnknown, ir::Load::make(posIteratorLevel.getParent().getMode().getModePack().getArray(1), posVarUnknown));
+        ModeFunction posAccess = posIteratorLevel.getParent().posAccess(posVarUnknown, {});
+        locateCoordVar = ir::Assign::make(coordVarUnknown, posAccess[0]);
       }
       else {
         locateCoordVar = ir::Assign::make(coordVarUnknown, posVarUnknown);
@@ -1608,16 +2098,40 @@ Stmt LowererImplImperative::lowerMergeLattice(MergeLattice caseLattice, IndexVar
           });
   bool resolvedCoordDeclared = !modeIteratorsNonMergers.empty();
 
-  vector<Stmt> mergeLoopsVec;
-  for (MergePoint point : loopLattice.points()) {
-    // Each iteration of this loop generates a while loop for one of the merge
-    // points in the merge lattice.
-    IndexStmt zeroedStmt = zero(statement, getExhaustedAccesses(point, caseLattice));
-    MergeLattice sublattice = caseLattice.subLattice(point);
-    Stmt mergeLoop = lowerMergePoint(sublattice, coordinate, coordinateVar, zeroedStmt, reducedAccesses, resolvedCoordDeclared, mergestrategy);
-    mergeLoopsVec.push_back(mergeLoop);
+  auto lowerMergeLoops = [&](MergeStrategy strategy) {
+    vector<Stmt> mergeLoopsVec;
+    for (MergePoint point : loopLattice.points()) {
+      // Each iteration of this loop generates a while loop for one of the merge
+      // points in the merge lattice.
+      IndexStmt zeroedStmt = zero(statement, getExhaustedAccesses(point, caseLattice));
+      MergeLattice sublattice = caseLattice.subLattice(point);
+      Stmt mergeLoop = lowerMergePoint(sublattice, coordinate, coordinateVar, zeroedStmt, reducedAccesses, resolvedCoordDeclared, strategy);
+      mergeLoopsVec.push_back(mergeLoop);
+    }
+    return Block::make(mergeLoopsVec);
+  };
+
+  Stmt mergeLoops;
+  if (mergestrategy == MergeStrategy::Adaptive) {
+    // Emit both strategies and gallop through the merges of segments whose
+    // lengths differ by more than TACO_GALLOP_RATIO times
+    if (loopLattice.points().size() == 1 && mergers.size() == 2 &&
+        util::all(mergers, canGallopAdaptively)) {
+      vector<Expr> lengths;
+      for (auto& merger : mergers) {
+        lengths.push_back(ir::Sub::make(merger.getEndVar(),
+                                        merger.getIteratorVar()));
+      }
+      Expr preferGallop = ir::Call::make("taco_prefer_gallop", lengths, Bool);
+      mergeLoops = IfThenElse::make(preferGallop,
+                                    lowerMergeLoops(MergeStrategy::Gallop),
+                                    lowerMergeLoops(MergeStrategy::TwoFinger));
+    } else {
+      mergeLoops = lowerMergeLoops(MergeStrategy::TwoFinger);
+    }
+  } else {
+    mergeLoops = lowerMergeLoops(mergestrategy);
   }
-  Stmt mergeLoops = Block::make(mergeLoopsVec);
 
   // Append position to the pos array
   Stmt appendPositions = generateAppendPositions(appenders);
@@ -1643,6 +2157,29 @@ Stmt LowererImplImperative::lowerMergePoint(MergeLattice pointLattice,
   taco_iassert(mergers.size() > 0);
   taco_iassert(rangers.size() > 0);
 
+  // Skip to the next coordinate that two compressed iterators have in common,
+  // which the remaining code then merges like a two finger merge
+  Stmt skipToIntersection;
+  if (mergeStrategy == MergeStrategy::Vectorized &&
+      pointLattice.points().size() == 1 && iterators.size() == 2 &&
+      mergers.size() == 2 && util::all(mergers, canIntersectWithVectors)) {
+    Expr aCrd = mergers[0].getMode().getModePack().getArray(1);
+    Expr bCrd = mergers[1].getMode().getModePack().getArray(1);
+    Expr aPos = mergers[0].getIteratorVar();
+    Expr bPos = mergers[1].getIteratorVar();
+    vector<Expr> intersectArgs = {aCrd, aPos, mergers[0].getEndVar(),
+                                  bCrd, bPos, mergers[1].getEndVar()};
+    vector<Expr> gallopArgs = {bCrd, bPos, mergers[1].getEndVar(),
+                               Load::make(aCrd, aPos)};
+    skipToIntersection = Block::make(
+        Assign::make(aPos, ir::Call::make("taco_intersect_next", intersectArgs,
+                                          aPos.type())),
+        IfThenElse::make(Gte::make(aPos, mergers[0].getEndVar()),
+                         ir::Break::make()),
+        Assign::make(bPos, ir::Call::make("taco_gallop", gallopArgs,
+                                          bPos.type())));
+  }
+
   // Load coordinates from position iterators
   Stmt loadPosIterCoordinates = codeToLoadCoordinatesFromPosIterators(iterators, !resolvedCoordDeclared);
 
@@ -1681,6 +2218,10 @@ Stmt LowererImplImperative::lowerMergePoint(MergeLattice pointLattice,
       ir::Assign::make(indexSetIter.getCoordVar(), indexSetIter.getPosVar())
     );
     // Code to increment both iterator variables.
+    taco_uassert(iter.getMode().getModeFormat().getName() != Packed.getName() &&
+                 indexSetIter.getMode().getModeFormat().getName() != Packed.getName() &&
+                 hasUnitPosStride(iter) && hasUnitPosStride(indexSetIter))
+        << "Index sets cannot be used with packed or sliced modes";
     auto ivar = iter.getIteratorVar();
     Expr iteratorParentPos = iter.getParent().getPosVar();
     ModeFunction iterBounds = iter.posBounds(iteratorParentPos);
@@ -1698,8 +2239,10 @@ Stmt LowererImplImperative::lowerMergePoint(MergeLattice pointLattice,
       setMatch
     };
     auto incr = ir::Block::make(
-      ir::Assign::make(ivar, ir::Call::make("taco_gallop", iterGallopArgs, ivar.type())),
-      ir::Assign::make(indexVar, ir::Call::make("taco_gallop", indexGallopArgs, indexVar.type())),
+      ir::Assign::make(ivar, ir::Call::make(indexArrayFunction("taco_gallop", iterGallopArgs[0]),
+                                            iterGallopArgs, ivar.type())),
+      ir::Assign::make(indexVar, ir::Call::make(indexArrayFunction("taco_gallop", indexGallopArgs[0]),
+                                                indexGallopArgs, indexVar.type())),
       ir::Continue::make()
     );
     // Code that uses the defined parts together in the if-then-else.
@@ -1734,7 +2277,8 @@ Stmt LowererImplImperative::lowerMergePoint(MergeLattice pointLattice,
 
   /// While loop over rangers
   return While::make(checkThatNoneAreExhausted(rangers),
-                     Block::make(loadPosIterCoordinates,
+                     Block::make(skipToIntersection,
+                                 loadPosIterCoordinates,
                                  ir::Block::make(indexSetStmts),
                                  resolvedCoordinate,
                                  loadLocatorPosVars,
@@ -2081,7 +2625,7 @@ Stmt LowererImplImperative::lowerForallBody(Expr coordinate, IndexStmt stmt,
                                   MergeStrategy mergeStrategy) {
 
   // Inserter positions
-  Stmt declInserterPosVars = declLocatePosVars(inserters);
+  Stmt declInserterPosVars = declLocatePosVars(inserters, true);
 
   // Locate positions
   Stmt declLocatorPosVars = declLocatePosVars(locators);
@@ -2531,8 +3075,9 @@ Stmt LowererImplImperative::lowerWhere(Where where) {
     if (it->second == where && it->first.getParallelUnit() ==
         ParallelUnit::NotParallel && !isScalar(temporary.getType())) {
       temporaryHoisted = true;
-    } else if (it->second == where && it->first.getParallelUnit() ==
-               ParallelUnit::CPUThread && !isScalar(temporary.getType())) {
+    } else if (it->second == where &&
+               isCPUThreadUnit(it->first.getParallelUnit()) &&
+               !isScalar(temporary.getType())) {
       temporaryHoisted = true;
       auto decls = codeToInitializeLocalTemporaryParallel(where, it->first.getParallelUnit());
 
@@ -2735,11 +3280,8 @@ Stmt LowererImplImperative::lowerAssemble(Assemble assemble) {
                           util::contains(reducedAccesses, resultAccess);
     if (generateAssembleCode()) {
       if (zeroInit && generateComputeCode()) {
-        const auto type = resultTensor.getType().getDataType();
-        Expr sizeOfElt = Sizeof::make(type);
-        Expr callocValues = ir::Call::make("calloc", {prevSize, sizeOfElt}, 
-                                           type);
-        Stmt allocResult = Assign::make(valuesArr, callocValues);
+        Stmt allocResult = Allocate::make(valuesArr, prevSize, false, Expr(),
+                                          true);
         initAssembleStmts.push_back(allocResult);
       } else {
         Stmt initValues = Allocate::make(valuesArr, prevSize);
@@ -3368,7 +3910,8 @@ Stmt LowererImplImperative::initValues(Expr tensor, Expr initVal, Expr begin, Ex
   return For::make(p, lower, upper, 1, zeroInit, parallel);
 }
 
-Stmt LowererImplImperative::declLocatePosVars(vector<Iterator> locators) {
+Stmt LowererImplImperative::declLocatePosVars(vector<Iterator> locators,
+                                              bool inserting) {
   vector<Stmt> result;
   for (Iterator& locator : locators) {
     accessibleIterators.insert(locator);
@@ -3384,8 +3927,8 @@ Stmt LowererImplImperative::declLocatePosVars(vector<Iterator> locators) {
 
     if (doLocate) {
       Iterator locateIterator = locator;
-      if (locateIterator.hasPosIter()) {
-        taco_iassert(!provGraph.isUnderived(locateIterator.getIndexVar()));
+      if (locateIterator.hasPosIter() &&
+          !provGraph.isUnderived(locateIterator.getIndexVar())) {
         continue; // these will be recovered with separate procedure
       }
       do {
@@ -3409,6 +3952,10 @@ Stmt LowererImplImperative::declLocatePosVars(vector<Iterator> locators) {
         Stmt declarePosVar = VarDecl::make(locateIterator.getPosVar(),
                                            locate.getResults()[0]);
         result.push_back(declarePosVar);
+        if (inserting && generateAssembleCode()) {
+          result.push_back(locateIterator.getInsertCoord(
+              locateIterator.getPosVar(), coords));
+        }
 
         if (locateIterator.isLeaf()) {
           break;
@@ -3506,14 +4053,10 @@ Stmt LowererImplImperative::codeToInitializeIteratorVar(Iterator iterator, vecto
           }
           result.push_back(VarDecl::make(iterator.getBeginVar(), binarySearchTarget));
 
-          vector<Expr> binarySearchArgs = {
-                  iterator.getMode().getModePack().getArray(1), // array
-                  bounds[0], // arrayStart
-                  bounds[1], // arrayEnd
-                  iterator.getBeginVar() // target
-          };
           result.push_back(
-                  VarDecl::make(iterVar, ir::Call::make("taco_binarySearchAfter", binarySearchArgs, iterVar.type())));
+                  VarDecl::make(iterVar, searchCoordinateAfter(iterator, bounds[0], bounds[1],
+                                                               iterator.getBeginVar(),
+                                                               iterVar.type())));
         }
         else {
           result.push_back(VarDecl::make(iterVar, bounds[0]));
@@ -3624,7 +4167,7 @@ Stmt LowererImplImperative::codeToIncIteratorVars(Expr coordinate, IndexVar coor
     Expr ivar = iterators[0].getIteratorVar();
 
     if (iterators[0].isUnique()) {
-      return compoundAssign(ivar, 1);
+      return compoundAssign(ivar, iterators[0].posStride());
     }
 
     // If iterator is over bottommost coordinate hierarchy level with
@@ -3650,6 +4193,14 @@ Stmt LowererImplImperative::codeToIncIteratorVars(Expr coordinate, IndexVar coor
         Expr increment = 1;
         result.push_back(compoundAssign(ivar, increment));
       } else if (strategy == MergeStrategy::Gallop) {
+        taco_uassert(hasUnitPosStride(iterator))
+            << "Galloping requires levels with contiguous positions";
+        if (!hasCoordinateArray(iterator)) {
+          taco_uerror << "Galloping requires levels that store coordinates in "
+                      << "an array, but " << iterator.getTensor() << " has a "
+                      << iterator.getMode().getModeFormat().getName()
+                      << " level";
+        }
         Expr iteratorParentPos = iterator.getParent().getPosVar();
         ModeFunction iterBounds = iterator.posBounds(iteratorParentPos);
         result.push_back(iterBounds.compute());
@@ -3658,9 +4209,13 @@ Stmt LowererImplImperative::codeToIncIteratorVars(Expr coordinate, IndexVar coor
           ivar, iterBounds[1],
           coordinate,
         };
-        result.push_back(ir::Assign::make(ivar, ir::Call::make("taco_gallop", gallopArgs, ivar.type())));
+        result.push_back(ir::Assign::make(ivar, ir::Call::make(indexArrayFunction("taco_gallop", gallopArgs[0]),
+                                                               gallopArgs, ivar.type())));
       } else { // strategy == MergeStrategy::TwoFinger
         Expr increment = ir::Cast::make(Eq::make(iterator.getCoordVar(), coordinate), ivar.type());
+        if (!hasUnitPosStride(iterator)) {
+          increment = ir::Mul::make(increment, iterator.posStride());
+        }
         result.push_back(compoundAssign(ivar, increment));
       }
     } else if (!iterator.isLeaf()) {
@@ -4030,29 +4585,21 @@ bool LowererImplImperative::hasStores(Stmt stmt) {
 
 Expr LowererImplImperative::searchForStartOfWindowPosition(Iterator iterator, ir::Expr start, ir::Expr end) {
     taco_iassert(iterator.isWindowed());
-    vector<Expr> args = {
-            // Search over the `crd` array of the level,
-            iterator.getMode().getModePack().getArray(1),
-            // between the start and end position,
-            start, end,
-            // for the beginning of the window.
-            iterator.getWindowLowerBound(),
-    };
-    return ir::Call::make("taco_binarySearchAfter", args, Datatype::UInt64);
+    // Search over the coordinates of the level between the start and end
+    // position for the beginning of the window.
+    return searchCoordinateAfter(iterator, start, end,
+                                 iterator.getWindowLowerBound(),
+                                 Datatype::UInt64);
 }
 
 
 Expr LowererImplImperative::searchForEndOfWindowPosition(Iterator iterator, ir::Expr start, ir::Expr end) {
     taco_iassert(iterator.isWindowed());
-    vector<Expr> args = {
-            // Search over the `crd` array of the level,
-            iterator.getMode().getModePack().getArray(1),
-            // between the start and end position,
-            start, end,
-            // for the end of the window.
-            iterator.getWindowUpperBound(),
-    };
-    return ir::Call::make("taco_binarySearchAfter", args, Datatype::UInt64);
+    // Search over the coordinates of the level between the start and end
+    // position for the end of the window.
+    return searchCoordinateAfter(iterator, start, end,
+                                 iterator.getWindowUpperBound(),
+                                 Datatype::UInt64);
 }
 
 
@@ -111,10 +111,29 @@ ModePack::ModePack(size_t numModes, ModeFormat modeType, ir::Expr tensor,
   content->arrays = modeType.impl->getArrays(tensor, mode, level);
 }
 
+ModePack::ModePack(size_t numModes, ModeFormat modeType, ir::Expr tensor,
+                   int mode, int level, const vector<Datatype>& arrayTypes)
+    : ModePack(numModes, modeType, tensor, mode, level) {
+  for (size_t i = 0; i < content->arrays.size() && i < arrayTypes.size(); ++i) {
+    const ir::GetProperty* array = content->arrays[i].as<ir::GetProperty>();
+    if (array == nullptr || array->property != ir::TensorProperty::Indices ||
+        array->type == arrayTypes[i]) {
+      continue;
+    }
+    content->arrays[i] = ir::GetProperty::make(array->tensor, array->property,
+                                               array->mode, array->index,
+                                               array->name, arrayTypes[i]);
+  }
+}
+
 size_t ModePack::getNumModes() const {
   return content->numModes;
 }
 
+size_t ModePack::getNumArrays() const {
+  return content->arrays.size();
+}
+
 ir::Expr ModePack::getArray(size_t i) const {
   return content->arrays[i];
 }
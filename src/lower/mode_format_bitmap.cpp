@@ -0,0 +1,229 @@
+#include "taco/lower/mode_format_bitmap.h"
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+#include "taco/util/strings.h"
+
+using namespace std;
+using namespace taco::ir;
+
+namespace taco {
+
+BitmapModeFormat::BitmapModeFormat() :
+    BitmapModeFormat(true, true, false) {
+}
+
+BitmapModeFormat::BitmapModeFormat(bool isOrdered, bool isUnique,
+                                   bool isZeroless) :
+    ModeFormatImpl("bitmap", false, isOrdered, isUnique, false, false,
+                   isZeroless, true, false, true, true, true, false, false,
+                   true, true) {
+}
+
+ModeFormat BitmapModeFormat::copy(
+    vector<ModeFormat::Property> properties) const {
+  bool isOrdered = this->isOrdered;
+  bool isUnique = this->isUnique;
+  bool isZeroless = this->isZeroless;
+  for (const auto property : properties) {
+    switch (property) {
+      case ModeFormat::ORDERED:
+        isOrdered = true;
+        break;
+      case ModeFormat::NOT_ORDERED:
+        isOrdered = false;
+        break;
+      case ModeFormat::UNIQUE:
+        isUnique = true;
+        break;
+      case ModeFormat::NOT_UNIQUE:
+        isUnique = false;
+        break;
+      case ModeFormat::ZEROLESS:
+        isZeroless = true;
+        break;
+      case ModeFormat::NOT_ZEROLESS:
+        isZeroless = false;
+        break;
+      default:
+        break;
+    }
+  }
+  const auto bitmapVariant =
+      std::make_shared<BitmapModeFormat>(isOrdered, isUnique, isZeroless);
+  return ModeFormat(bitmapVariant);
+}
+
+ModeFunction BitmapModeFormat::posIterBounds(Expr parentPos, Mode mode) const {
+  // Positions past the dimension are padding that is never marked
+  Expr pbegin = ir::Mul::make(parentPos, getWidth(mode));
+  Expr pend = ir::Add::make(pbegin, getSizeArray(mode.getModePack()));
+  return ModeFunction(Stmt(), {pbegin, pend});
+}
+
+ModeFunction BitmapModeFormat::posIterAccess(ir::Expr pos,
+                                             std::vector<ir::Expr> coords,
+                                             Mode mode) const {
+  taco_iassert(mode.getPackLocation() == 0);
+  taco_uassert(mode.getModePack().getNumModes() == 1)
+      << "Bitmap modes cannot share index arrays with other modes";
+
+  // Fibers start at multiples of W, so the coordinate is the offset from it
+  Expr idx = ir::Rem::make(pos, getWidth(mode));
+  Expr word = Load::make(getBitsArray(mode.getModePack()),
+                         ir::Div::make(pos, 64));
+  Expr mask = ir::Call::make("taco_bitmap_mask", {pos}, UInt64);
+  return ModeFunction(Stmt(), {idx, ir::Neq::make(ir::BitAnd::make(word, mask),
+                                                  0)});
+}
+
+Expr BitmapModeFormat::posIterBitmap(Mode mode) const {
+  return getBitsArray(mode.getModePack());
+}
+
+ModeFunction BitmapModeFormat::locate(ir::Expr parentPos,
+                                      std::vector<ir::Expr> coords,
+                                      Mode mode) const {
+  // Unmarked positions hold zeros, so every coordinate is found
+  Expr pos = ir::Add::make(ir::Mul::make(parentPos, getWidth(mode)),
+                           coords.back());
+  return ModeFunction(Stmt(), {pos, true});
+}
+
+Stmt BitmapModeFormat::getInsertCoord(Expr p, const std::vector<Expr>& i,
+                                      Mode mode) const {
+  return markPosition(p, mode);
+}
+
+Expr BitmapModeFormat::getWidth(Mode mode) const {
+  if (mode.getSize().isFixed()) {
+    return getWidth((int)mode.getSize().getSize());
+  }
+  Expr size = getSizeArray(mode.getModePack());
+  return ir::Mul::make(ir::Div::make(ir::Add::make(size, 63), 64), 64);
+}
+
+Stmt BitmapModeFormat::getInsertInitLevel(Expr szPrev, Expr sz,
+                                          Mode mode) const {
+  taco_uassert(!isValue(sz, 0))
+      << "Bitmap modes can only be inserted into below levels that are "
+      << "inserted into, such as dense levels";
+  return Allocate::make(getBitsArray(mode.getModePack()),
+                        ir::Div::make(sz, 64), false, Expr(), true);
+}
+
+Expr BitmapModeFormat::getAssembledSize(Expr prevSize, Mode mode) const {
+  return ir::Mul::make(prevSize, getWidth(mode));
+}
+
+Stmt BitmapModeFormat::getInitCoords(Expr prevSize,
+    std::vector<AttrQueryResult> queries, Mode mode) const {
+  Expr size = getAssembledSize(prevSize, mode);
+  return getInsertInitLevel(prevSize, size, mode);
+}
+
+ModeFunction BitmapModeFormat::getYieldPos(Expr parentPos,
+    std::vector<Expr> coords, Mode mode) const {
+  return locate(parentPos, coords, mode);
+}
+
+Stmt BitmapModeFormat::getInsertCoord(Expr parentPos, Expr pos,
+    std::vector<Expr> coords, Mode mode) const {
+  return markPosition(pos, mode);
+}
+
+vector<Expr> BitmapModeFormat::getArrays(Expr tensor, int mode,
+                                         int level) const {
+  std::string arraysName = util::toString(tensor) + std::to_string(level);
+  return {GetProperty::make(tensor, TensorProperty::Dimension, mode),
+          GetProperty::make(tensor, TensorProperty::Indices,
+                            level - 1, 1, arraysName + "_bits", UInt64)};
+}
+
+int BitmapModeFormat::getWidth(int dimension) {
+  return (dimension + 63) / 64 * 64;
+}
+
+void BitmapModeFormat::mark(const int* pos, const int* crd, const Array& vals,
+                            size_t numFibers, int width, Array* bits,
+                            Array* bitmapVals) {
+  taco_uassert(numFibers * width <= (size_t)INT_MAX)
+      << "Too many positions for a bitmap";
+  const size_t size = numFibers * width;
+  *bits = makeArray(UInt64, size / 64);
+  *bitmapVals = makeArray(vals.getType(), size);
+  bits->zero();
+  bitmapVals->zero();
+
+  uint64_t* bitsData = (uint64_t*)bits->getData();
+  char* bitmapValsData = (char*)bitmapVals->getData();
+  const char* valsData = (const char*)vals.getData();
+  const size_t valBytes = vals.getType().getNumBytes();
+  for (size_t fiber = 0; fiber < numFibers; fiber++) {
+    for (int p = pos[fiber]; p < pos[fiber + 1]; p++) {
+      const size_t bitmapP = fiber * width + crd[p];
+      bitsData[bitmapP / 64] |= (uint64_t)1 << (bitmapP % 64);
+      memcpy(bitmapValsData + bitmapP * valBytes, valsData + p * valBytes,
+             valBytes);
+    }
+  }
+}
+
+void BitmapModeFormat::compress(const uint64_t* bits, const Array& vals,
+                                size_t numFibers, int width, Array* pos,
+                                Array* crd, Array* compressedVals) {
+  const size_t wordsPerFiber = width / 64;
+  *pos = makeArray(type<int>(), numFibers + 1);
+  int* posData = (int*)pos->getData();
+  posData[0] = 0;
+  for (size_t fiber = 0; fiber < numFibers; fiber++) {
+    int count = 0;
+    for (size_t w = 0; w < wordsPerFiber; w++) {
+      count += __builtin_popcountll(bits[fiber * wordsPerFiber + w]);
+    }
+    posData[fiber + 1] = posData[fiber] + count;
+  }
+
+  const size_t size = posData[numFibers];
+  *crd = makeArray(type<int>(), size);
+  *compressedVals = makeArray(vals.getType(), size);
+  int* crdData = (int*)crd->getData();
+  char* compressedValsData = (char*)compressedVals->getData();
+  const char* valsData = (const char*)vals.getData();
+  const size_t valBytes = vals.getType().getNumBytes();
+  size_t p = 0;
+  for (size_t fiber = 0; fiber < numFibers; fiber++) {
+    for (size_t w = 0; w < wordsPerFiber; w++) {
+      for (uint64_t word = bits[fiber * wordsPerFiber + w]; word != 0;
+           word &= word - 1) {
+        const int coord = (int)(w * 64) + __builtin_ctzll(word);
+        crdData[p] = coord;
+        memcpy(compressedValsData + p * valBytes,
+               valsData + (fiber * width + coord) * valBytes, valBytes);
+        p++;
+      }
+    }
+  }
+}
+
+Expr BitmapModeFormat::getSizeArray(ModePack pack) const {
+  return pack.getArray(0);
+}
+
+Expr BitmapModeFormat::getBitsArray(ModePack pack) const {
+  return pack.getArray(1);
+}
+
+Stmt BitmapModeFormat::markPosition(Expr pos, Mode mode) const {
+  Expr bitsArray = getBitsArray(mode.getModePack());
+  Expr word = ir::Div::make(pos, 64);
+  Expr mask = ir::Call::make("taco_bitmap_mask", {pos}, UInt64);
+  // Positions that share a word may be marked by different iterations of a
+  // parallel loop, so the word is updated atomically
+  return Store::make(bitsArray, word,
+                     ir::BitOr::make(Load::make(bitsArray, word), mask), true);
+}
+
+}
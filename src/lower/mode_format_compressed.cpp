@@ -146,7 +146,7 @@ Stmt CompressedModeFormat::getAppendInitEdges(Expr pPrevBegin,
     return doubleSizeIfFull(posArray, posCapacity, pPrevEnd);
   }
 
-  Expr pVar = Var::make("p" + mode.getName(), Int());
+  Expr pVar = Var::make("p" + mode.getName(), posArray.type());
   Expr lb = ir::Add::make(pPrevBegin, 1);
   Expr ub = ir::Add::make(pPrevEnd, 1);
   Stmt initPos = For::make(pVar, lb, ub, 1, Store::make(posArray, pVar, 0));
@@ -174,7 +174,7 @@ Stmt CompressedModeFormat::getAppendInitLevel(Expr szPrev, Expr sz,
 
   if (mode.getParentModeType().defined() &&
       !mode.getParentModeType().hasAppend() && !szPrevIsZero) {
-    Expr pVar = Var::make("p" + mode.getName(), Int());
+    Expr pVar = Var::make("p" + mode.getName(), posArray.type());
     Stmt storePos = Store::make(posArray, pVar, 0);
     initStmts.push_back(For::make(pVar, 1, initCapacity, 1, storePos));
   }
@@ -197,13 +197,14 @@ Stmt CompressedModeFormat::getAppendFinalizeLevel(Expr szPrev,
     return Stmt();
   }
 
-  Expr csVar = Var::make("cs" + mode.getName(), Int());
+  Expr posArray = getPosArray(mode.getModePack());
+  Expr csVar = Var::make("cs" + mode.getName(), posArray.type());
   Stmt initCs = VarDecl::make(csVar, 0);
   
-  Expr pVar = Var::make("p" + mode.getName(), Int());
-  Expr loadPos = Load::make(getPosArray(mode.getModePack()), pVar);
+  Expr pVar = Var::make("p" + mode.getName(), posArray.type());
+  Expr loadPos = Load::make(posArray, pVar);
   Stmt incCs = Assign::make(csVar, ir::Add::make(csVar, loadPos));
-  Stmt updatePos = Store::make(getPosArray(mode.getModePack()), pVar, csVar);
+  Stmt updatePos = Store::make(posArray, pVar, csVar);
   Stmt body = Block::make({incCs, updatePos});
   Stmt finalizeLoop = For::make(pVar, 1, ir::Add::make(szPrev, 1), 1, body);
 
@@ -246,7 +247,7 @@ ModeFunction CompressedModeFormat::getYieldPos(Expr parentPos,
     std::vector<Expr> coords, Mode mode) const {
   Expr ptrArr = getPosArray(mode.getModePack());
   Expr loadPtr = Load::make(ptrArr, parentPos);
-  Expr pVar = Var::make("p" + mode.getName(), Int());
+  Expr pVar = Var::make("p" + mode.getName(), ptrArr.type());
   Stmt getPtr = VarDecl::make(pVar, loadPtr);
   Stmt incPtr = Store::make(ptrArr, parentPos, ir::Add::make(loadPtr, 1));
   return ModeFunction(Block::make(getPtr, incPtr), {pVar});
@@ -262,7 +263,7 @@ Stmt CompressedModeFormat::getInsertCoord(Expr parentPos, Expr pos,
 
 Stmt CompressedModeFormat::getFinalizeYieldPos(Expr prevSize, Mode mode) const {
   Expr posArr = getPosArray(mode.getModePack());
-  Expr pVar = Var::make("p", Int());
+  Expr pVar = Var::make("p", posArr.type());
   Stmt resetLoop = For::make(pVar, 0, prevSize, 1, 
       Store::make(posArr, ir::Sub::make(prevSize, pVar), 
                   Load::make(posArr, 
@@ -291,7 +292,8 @@ Expr CompressedModeFormat::getPosCapacity(Mode mode) const {
   const std::string varName = mode.getName() + "_pos_size";
  
   if (!mode.hasVar(varName)) {
-    Expr posCapacity = Var::make(varName, Int());
+    Expr posCapacity = Var::make(varName,
+                                 getPosArray(mode.getModePack()).type());
     mode.addVar(varName, posCapacity);
     return posCapacity;
   }
@@ -303,7 +305,8 @@ Expr CompressedModeFormat::getCoordCapacity(Mode mode) const {
   const std::string varName = mode.getName() + "_crd_size";
   
   if (!mode.hasVar(varName)) {
-    Expr idxCapacity = Var::make(varName, Int());
+    Expr idxCapacity = Var::make(varName,
+                                 getPosArray(mode.getModePack()).type());
     mode.addVar(varName, idxCapacity);
     return idxCapacity;
   }
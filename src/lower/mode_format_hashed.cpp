@@ -0,0 +1,272 @@
+#include "taco/lower/mode_format_hashed.h"
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "taco/util/strings.h"
+
+using namespace std;
+using namespace taco::ir;
+
+namespace taco {
+
+HashedModeFormat::HashedModeFormat() :
+    HashedModeFormat(DEFAULT_HASH_CAPACITY) {
+}
+
+HashedModeFormat::HashedModeFormat(int capacity) :
+    HashedModeFormat(capacity, false, true, false) {
+}
+
+HashedModeFormat::HashedModeFormat(int capacity, bool isFull, bool isUnique,
+                                   bool isZeroless) :
+    ModeFormatImpl("hashed", isFull, false, isUnique, false, false, isZeroless,
+                   true, false, true, true, true, false, false, true, true),
+    capacity(capacity) {
+  taco_uassert(capacity > 1 && (capacity & (capacity - 1)) == 0)
+      << "The capacity of hashed modes must be a power of two";
+}
+
+ModeFormat HashedModeFormat::copy(
+    vector<ModeFormat::Property> properties) const {
+  bool isFull = this->isFull;
+  bool isUnique = this->isUnique;
+  bool isZeroless = this->isZeroless;
+  for (const auto property : properties) {
+    switch (property) {
+      case ModeFormat::FULL:
+        isFull = true;
+        break;
+      case ModeFormat::NOT_FULL:
+        isFull = false;
+        break;
+      case ModeFormat::UNIQUE:
+        isUnique = true;
+        break;
+      case ModeFormat::NOT_UNIQUE:
+        isUnique = false;
+        break;
+      case ModeFormat::ZEROLESS:
+        isZeroless = true;
+        break;
+      case ModeFormat::NOT_ZEROLESS:
+        isZeroless = false;
+        break;
+      default:
+        break;
+    }
+  }
+  const auto hashedVariant =
+      std::make_shared<HashedModeFormat>(capacity, isFull, isUnique,
+                                         isZeroless);
+  return ModeFormat(hashedVariant);
+}
+
+ModeFunction HashedModeFormat::posIterBounds(Expr parentPos, Mode mode) const {
+  Expr capacity = getCapacity(mode.getModePack());
+  Expr pbegin = ir::Mul::make(parentPos, capacity);
+  Expr pend = ir::Add::make(pbegin, capacity);
+  return ModeFunction(Stmt(), {pbegin, pend});
+}
+
+ModeFunction HashedModeFormat::posIterAccess(ir::Expr pos,
+                                             std::vector<ir::Expr> coords,
+                                             Mode mode) const {
+  taco_iassert(mode.getPackLocation() == 0);
+  taco_uassert(mode.getModePack().getNumModes() == 1)
+      << "Hashed modes cannot share index arrays with other modes";
+
+  // Empty slots hold coordinate -1 and are skipped
+  Expr idx = Load::make(getCoordArray(mode.getModePack()), pos);
+  return ModeFunction(Stmt(), {idx, ir::Gte::make(idx, 0)});
+}
+
+ModeFunction HashedModeFormat::locate(ir::Expr parentPos,
+                                      std::vector<ir::Expr> coords,
+                                      Mode mode) const {
+  Expr pos = ir::Call::make("taco_hash_locate",
+                            {getCoordArray(mode.getModePack()),
+                             getCapacityArray(mode.getModePack()), parentPos,
+                             coords.back()}, Int32);
+  return ModeFunction(Stmt(), {pos, true});
+}
+
+Stmt HashedModeFormat::getInsertCoord(Expr p, const std::vector<Expr>& i,
+                                      Mode mode) const {
+  return Store::make(getCoordArray(mode.getModePack()), p, i.back());
+}
+
+Expr HashedModeFormat::getWidth(Mode mode) const {
+  return getCapacity(mode.getModePack());
+}
+
+Stmt HashedModeFormat::getInsertInitLevel(Expr szPrev, Expr sz,
+                                          Mode mode) const {
+  taco_uassert(!isValue(sz, 0))
+      << "Hashed modes can only be inserted into below levels that are "
+      << "inserted into, such as dense levels";
+  Expr crdArray = getCoordArray(mode.getModePack());
+  Expr pVar = Var::make("p" + mode.getName(), Int());
+  Stmt clearSlots = For::make(pVar, 0, sz, 1, Store::make(crdArray, pVar, -1));
+  return Block::make(Allocate::make(crdArray, sz), clearSlots);
+}
+
+Expr HashedModeFormat::getAssembledSize(Expr prevSize, Mode mode) const {
+  return ir::Mul::make(prevSize, getCapacity(mode.getModePack()));
+}
+
+Stmt HashedModeFormat::getInitCoords(Expr prevSize,
+    std::vector<AttrQueryResult> queries, Mode mode) const {
+  Expr size = getAssembledSize(prevSize, mode);
+  return getInsertInitLevel(prevSize, size, mode);
+}
+
+ModeFunction HashedModeFormat::getYieldPos(Expr parentPos,
+    std::vector<Expr> coords, Mode mode) const {
+  return locate(parentPos, coords, mode);
+}
+
+Stmt HashedModeFormat::getInsertCoord(Expr parentPos, Expr pos,
+    std::vector<Expr> coords, Mode mode) const {
+  return Store::make(getCoordArray(mode.getModePack()), pos, coords.back());
+}
+
+vector<Expr> HashedModeFormat::getArrays(Expr tensor, int mode,
+                                         int level) const {
+  std::string arraysName = util::toString(tensor) + std::to_string(level);
+  return {GetProperty::make(tensor, TensorProperty::Indices,
+                            level - 1, 0, arraysName + "_capacity"),
+          GetProperty::make(tensor, TensorProperty::Indices,
+                            level - 1, 1, arraysName + "_crd")};
+}
+
+int HashedModeFormat::getCapacity() const {
+  return capacity;
+}
+
+int HashedModeFormat::locate(const int* table, int begin, int capacity,
+                             int coord) {
+  // Must match taco_hash_locate in the generated code
+  uint32_t hash = (uint32_t)coord * 0x9E3779B1u;
+  hash ^= hash >> 16;
+  const uint32_t mask = capacity - 1;
+  for (int probe = 0; probe < capacity; probe++) {
+    const int slot = begin + (int)((hash + probe) & mask);
+    if (table[slot] == coord || table[slot] < 0) {
+      return slot;
+    }
+  }
+  taco_ierror << "Hashed fiber with " << capacity << " slots is full";
+  return -1;
+}
+
+bool HashedModeFormat::hasFullFiber(const int* table, size_t numFibers,
+                                    int capacity) {
+  for (size_t fiber = 0; fiber < numFibers; fiber++) {
+    const int* slots = table + fiber * capacity;
+    if (std::all_of(slots, slots + capacity,
+                    [](int coord) { return coord >= 0; })) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int HashedModeFormat::hash(const int* pos, const int* crd, const Array& vals,
+                           size_t numFibers, Array* table,
+                           Array* hashedVals) const {
+  // Double the slots until the largest fiber leaves one of them empty
+  int maxFiberSize = 0;
+  for (size_t fiber = 0; fiber < numFibers; fiber++) {
+    maxFiberSize = std::max(maxFiberSize, pos[fiber + 1] - pos[fiber]);
+  }
+  int capacity = this->capacity;
+  while (capacity <= maxFiberSize) {
+    taco_uassert(capacity <= INT_MAX / 2)
+        << "A fiber has too many coordinates to hash";
+    capacity *= 2;
+  }
+  taco_uassert(numFibers * capacity <= (size_t)INT_MAX)
+      << "Too many slots to hash";
+  const size_t size = numFibers * capacity;
+  *table = makeArray(type<int>(), size);
+  *hashedVals = makeArray(vals.getType(), size);
+  int* tableData = (int*)table->getData();
+  std::fill(tableData, tableData + size, -1);
+  hashedVals->zero();
+
+  char* hashedValsData = (char*)hashedVals->getData();
+  const char* valsData = (const char*)vals.getData();
+  const size_t valBytes = vals.getType().getNumBytes();
+  for (size_t fiber = 0; fiber < numFibers; fiber++) {
+    for (int p = pos[fiber]; p < pos[fiber + 1]; p++) {
+      const int slot = locate(tableData, (int)(fiber * capacity), capacity,
+                              crd[p]);
+      tableData[slot] = crd[p];
+      memcpy(hashedValsData + slot * valBytes, valsData + p * valBytes,
+             valBytes);
+    }
+  }
+  return capacity;
+}
+
+void HashedModeFormat::compress(const int* table, const Array& vals,
+                                size_t numFibers, int capacity, Array* pos,
+                                Array* crd, Array* compressedVals) {
+  *pos = makeArray(type<int>(), numFibers + 1);
+  int* posData = (int*)pos->getData();
+  posData[0] = 0;
+  for (size_t fiber = 0; fiber < numFibers; fiber++) {
+    const int* slots = table + fiber * capacity;
+    posData[fiber + 1] = posData[fiber] +
+        (int)std::count_if(slots, slots + capacity,
+                           [](int coord) { return coord >= 0; });
+  }
+
+  const size_t size = posData[numFibers];
+  *crd = makeArray(type<int>(), size);
+  *compressedVals = makeArray(vals.getType(), size);
+  int* crdData = (int*)crd->getData();
+  char* compressedValsData = (char*)compressedVals->getData();
+  const char* valsData = (const char*)vals.getData();
+  const size_t valBytes = vals.getType().getNumBytes();
+  vector<int> order;
+  for (size_t fiber = 0; fiber < numFibers; fiber++) {
+    const int begin = (int)(fiber * capacity);
+    order.clear();
+    for (int slot = begin; slot < begin + capacity; slot++) {
+      if (table[slot] >= 0) {
+        order.push_back(slot);
+      }
+    }
+    std::sort(order.begin(), order.end(),
+              [&](int a, int b) { return table[a] < table[b]; });
+    for (size_t k = 0; k < order.size(); k++) {
+      const size_t p = posData[fiber] + k;
+      crdData[p] = table[order[k]];
+      memcpy(compressedValsData + p * valBytes, valsData + order[k] * valBytes,
+             valBytes);
+    }
+  }
+}
+
+Expr HashedModeFormat::getCapacityArray(ModePack pack) const {
+  return pack.getArray(0);
+}
+
+Expr HashedModeFormat::getCapacity(ModePack pack) const {
+  return Load::make(getCapacityArray(pack), 0);
+}
+
+Expr HashedModeFormat::getCoordArray(ModePack pack) const {
+  return pack.getArray(1);
+}
+
+bool HashedModeFormat::equals(const ModeFormatImpl& other) const {
+  const auto& otherHashed = static_cast<const HashedModeFormat&>(other);
+  return ModeFormatImpl::equals(other) && capacity == otherHashed.capacity;
+}
+
+}
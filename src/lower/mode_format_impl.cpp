@@ -197,6 +197,19 @@ ModeFunction ModeFormatImpl::posIterAccess(ir::Expr pos,
   return ModeFunction();
 }
 
+ir::Expr ModeFormatImpl::posIterStride(Mode mode) const {
+  return 1;
+}
+
+ir::Expr ModeFormatImpl::posIterBitmap(Mode mode) const {
+  return ir::Expr();
+}
+
+ir::Expr ModeFormatImpl::posIterSliceFiber(ir::Expr slot, ir::Expr numFibers,
+                                           Mode mode) const {
+  return ir::Expr();
+}
+
 ModeFunction ModeFormatImpl::locate(ir::Expr parentPos,
                                   std::vector<ir::Expr> coords,
                                   Mode mode) const {
@@ -0,0 +1,183 @@
+#include "taco/lower/mode_format_packed.h"
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "taco/ir/ir_generators.h"
+#include "taco/ir/simplify.h"
+#include "taco/util/strings.h"
+
+using namespace std;
+using namespace taco::ir;
+
+namespace taco {
+
+PackedModeFormat::PackedModeFormat() :
+    PackedModeFormat(false, true, true, false) {
+}
+
+PackedModeFormat::PackedModeFormat(bool isFull, bool isOrdered,
+                                   bool isUnique, bool isZeroless) :
+    ModeFormatImpl("packed", isFull, isOrdered, isUnique, false, true,
+                   isZeroless, false, false, true, false, false, false, false,
+                   false, false) {
+}
+
+ModeFormat PackedModeFormat::copy(
+    vector<ModeFormat::Property> properties) const {
+  bool isFull = this->isFull;
+  bool isOrdered = this->isOrdered;
+  bool isUnique = this->isUnique;
+  bool isZeroless = this->isZeroless;
+  for (const auto property : properties) {
+    switch (property) {
+      case ModeFormat::FULL:
+        isFull = true;
+        break;
+      case ModeFormat::NOT_FULL:
+        isFull = false;
+        break;
+      case ModeFormat::ORDERED:
+        isOrdered = true;
+        break;
+      case ModeFormat::NOT_ORDERED:
+        isOrdered = false;
+        break;
+      case ModeFormat::UNIQUE:
+        isUnique = true;
+        break;
+      case ModeFormat::NOT_UNIQUE:
+        isUnique = false;
+        break;
+      case ModeFormat::ZEROLESS:
+        isZeroless = true;
+        break;
+      case ModeFormat::NOT_ZEROLESS:
+        isZeroless = false;
+        break;
+      default:
+        break;
+    }
+  }
+  const auto packedVariant =
+      std::make_shared<PackedModeFormat>(isFull, isOrdered, isUnique,
+                                         isZeroless);
+  return ModeFormat(packedVariant);
+}
+
+ModeFunction PackedModeFormat::posIterBounds(Expr parentPos, Mode mode) const {
+  Expr pbegin = Load::make(getPosArray(mode.getModePack()), parentPos);
+  Expr pend = Load::make(getPosArray(mode.getModePack()),
+                         ir::Add::make(parentPos, 1));
+  return ModeFunction(Stmt(), {pbegin, pend});
+}
+
+ModeFunction PackedModeFormat::coordBounds(Expr parentPos, Mode mode) const {
+  Expr pend = Load::make(getPosArray(mode.getModePack()),
+                         ir::Add::make(parentPos, 1));
+  Expr coordend = ir::Call::make("taco_packed_crd",
+                                 {getCoordArray(mode.getModePack()),
+                                  ir::Sub::make(pend, 1)}, Int());
+  return ModeFunction(Stmt(), {0, coordend});
+}
+
+ModeFunction PackedModeFormat::posIterAccess(ir::Expr pos,
+                                             std::vector<ir::Expr> coords,
+                                             Mode mode) const {
+  taco_iassert(mode.getPackLocation() == 0);
+  taco_uassert(mode.getModePack().getNumModes() == 1)
+      << "Packed modes cannot share index arrays with other modes";
+
+  Expr idx = ir::Call::make("taco_packed_crd",
+                            {getCoordArray(mode.getModePack()), pos}, Int());
+  return ModeFunction(Stmt(), {idx, true});
+}
+
+vector<Expr> PackedModeFormat::getArrays(Expr tensor, int mode,
+                                         int level) const {
+  std::string arraysName = util::toString(tensor) + std::to_string(level);
+  return {GetProperty::make(tensor, TensorProperty::Indices,
+                            level - 1, 0, arraysName + "_pos"),
+          GetProperty::make(tensor, TensorProperty::Indices,
+                            level - 1, 1, arraysName + "_crd")};
+}
+
+Expr PackedModeFormat::getPosArray(ModePack pack) const {
+  return pack.getArray(0);
+}
+
+Expr PackedModeFormat::getCoordArray(ModePack pack) const {
+  return pack.getArray(1);
+}
+
+Array PackedModeFormat::packCoordinates(const int* crd, size_t size) {
+  const size_t numBlocks = (size + PACKED_BLOCK_SIZE - 1) / PACKED_BLOCK_SIZE;
+  const size_t headerSize = 2 * numBlocks + 3;
+
+  // Compute the base and bit width of every block
+  vector<int> bases(numBlocks);
+  vector<int> widths(numBlocks);
+  size_t numWords = 0;
+  for (size_t b = 0; b < numBlocks; b++) {
+    const int* begin = crd + b * PACKED_BLOCK_SIZE;
+    const int* end = crd + std::min(size, (b + 1) * PACKED_BLOCK_SIZE);
+    const auto minmax = std::minmax_element(begin, end);
+    uint32_t range = (uint32_t)*minmax.second - (uint32_t)*minmax.first;
+    int width = 0;
+    while (range > 0) {
+      width++;
+      range >>= 1;
+    }
+    bases[b] = *minmax.first;
+    widths[b] = width;
+    numWords += width * PACKED_BLOCK_SIZE / 32;
+  }
+  // Coordinates are read two words at a time, and the words of the last block
+  // end where the padding starts, even if its width is zero
+  taco_uassert(headerSize + numWords + 2 <= (size_t)INT_MAX)
+      << "Too many coordinates to pack";
+
+  Array packed = makeArray(type<int>(), headerSize + numWords + 2);
+  int* data = (int*)packed.getData();
+  memset(data, 0, packed.getSize() * sizeof(int));
+  uint32_t* words = (uint32_t*)(data + headerSize);
+
+  data[0] = (int)headerSize;
+  int offset = 0;
+  for (size_t b = 0; b < numBlocks; b++) {
+    data[1 + 2*b] = bases[b];
+    data[2 + 2*b] = offset;
+
+    const size_t begin = b * PACKED_BLOCK_SIZE;
+    const size_t end = std::min(size, begin + PACKED_BLOCK_SIZE);
+    for (size_t p = begin; p < end; p++) {
+      const uint64_t delta = (uint32_t)crd[p] - (uint32_t)bases[b];
+      const uint64_t bit = (uint64_t)(p - begin) * widths[b];
+      uint32_t* word = words + offset + (bit / 32);
+      word[0] |= (uint32_t)(delta << (bit % 32));
+      if (bit % 32 + widths[b] > 32) {
+        word[1] |= (uint32_t)(delta >> (32 - bit % 32));
+      }
+    }
+    offset += widths[b] * PACKED_BLOCK_SIZE / 32;
+  }
+  data[1 + 2*numBlocks] = 0;
+  data[2 + 2*numBlocks] = offset;
+
+  return packed;
+}
+
+int PackedModeFormat::unpackCoordinate(const int* packed, size_t pos) {
+  const int* block = packed + 1 + 2 * (pos / PACKED_BLOCK_SIZE);
+  const int offset = block[1];
+  const int width = (block[3] - offset) / 4;
+  const uint64_t bit = (uint64_t)(pos % PACKED_BLOCK_SIZE) * width;
+  const uint32_t* word = (const uint32_t*)(packed + packed[0] + offset) +
+                         (bit / 32);
+  const uint64_t bits = ((uint64_t)word[1] << 32) | word[0];
+  return block[0] + (int)((bits >> (bit % 32)) & ((1ull << width) - 1));
+}
+
+}
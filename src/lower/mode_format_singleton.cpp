@@ -168,7 +168,8 @@ Expr SingletonModeFormat::getCoordCapacity(Mode mode) const {
   const std::string varName = mode.getName() + "_crd_size";
   
   if (!mode.hasVar(varName)) {
-    Expr idxCapacity = Var::make(varName, Int());
+    Expr idxCapacity = Var::make(varName,
+                                 getCoordArray(mode.getModePack()).type());
     mode.addVar(varName, idxCapacity);
     return idxCapacity;
   }
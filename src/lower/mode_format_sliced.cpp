@@ -0,0 +1,214 @@
+#include "taco/lower/mode_format_sliced.h"
+
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <numeric>
+
+#include "taco/ir/ir_generators.h"
+#include "taco/ir/simplify.h"
+#include "taco/util/strings.h"
+
+using namespace std;
+using namespace taco::ir;
+
+namespace taco {
+
+SlicedModeFormat::SlicedModeFormat() :
+    SlicedModeFormat(DEFAULT_SLICE_HEIGHT, DEFAULT_SORT_WINDOW) {
+}
+
+SlicedModeFormat::SlicedModeFormat(int sliceHeight, int sortWindow) :
+    SlicedModeFormat(sliceHeight, sortWindow, false, true, true, false) {
+}
+
+SlicedModeFormat::SlicedModeFormat(int sliceHeight, int sortWindow,
+                                   bool isFull, bool isOrdered,
+                                   bool isUnique, bool isZeroless) :
+    ModeFormatImpl("sliced", isFull, isOrdered, isUnique, false, false,
+                   isZeroless, true, false, true, false, false, false, false,
+                   false, false),
+    sliceHeight(sliceHeight), sortWindow(sortWindow) {
+  taco_uassert(sliceHeight > 0) << "Slices must hold at least one fiber";
+  taco_uassert(sortWindow > 0) << "Sort windows must hold at least one fiber";
+}
+
+ModeFormat SlicedModeFormat::copy(
+    vector<ModeFormat::Property> properties) const {
+  bool isFull = this->isFull;
+  bool isOrdered = this->isOrdered;
+  bool isUnique = this->isUnique;
+  bool isZeroless = this->isZeroless;
+  for (const auto property : properties) {
+    switch (property) {
+      case ModeFormat::FULL:
+        isFull = true;
+        break;
+      case ModeFormat::NOT_FULL:
+        isFull = false;
+        break;
+      case ModeFormat::ORDERED:
+        isOrdered = true;
+        break;
+      case ModeFormat::NOT_ORDERED:
+        isOrdered = false;
+        break;
+      case ModeFormat::UNIQUE:
+        isUnique = true;
+        break;
+      case ModeFormat::NOT_UNIQUE:
+        isUnique = false;
+        break;
+      case ModeFormat::ZEROLESS:
+        isZeroless = true;
+        break;
+      case ModeFormat::NOT_ZEROLESS:
+        isZeroless = false;
+        break;
+      default:
+        break;
+    }
+  }
+  const auto slicedVariant =
+      std::make_shared<SlicedModeFormat>(sliceHeight, sortWindow, isFull,
+                                         isOrdered, isUnique, isZeroless);
+  return ModeFormat(slicedVariant);
+}
+
+ModeFunction SlicedModeFormat::posIterBounds(Expr parentPos, Mode mode) const {
+  Expr pbegin = Load::make(getPosArray(mode.getModePack()),
+                           ir::Mul::make(parentPos, 2));
+  Expr pend = Load::make(getPosArray(mode.getModePack()),
+                         ir::Add::make(ir::Mul::make(parentPos, 2), 1));
+  return ModeFunction(Stmt(), {pbegin, pend});
+}
+
+ModeFunction SlicedModeFormat::coordBounds(Expr parentPos, Mode mode) const {
+  Expr pbegin = Load::make(getPosArray(mode.getModePack()),
+                           ir::Mul::make(parentPos, 2));
+  Expr pend = Load::make(getPosArray(mode.getModePack()),
+                         ir::Add::make(ir::Mul::make(parentPos, 2), 1));
+  // The last coordinate of an empty fiber in the first slice would be read
+  // from before the start of the coordinate array
+  Expr coordend = Var::make("coordend" + mode.getName(), Int());
+  Stmt computeCoordend = Block::make(
+      VarDecl::make(coordend, 0),
+      IfThenElse::make(Lt::make(pbegin, pend),
+                       Assign::make(coordend,
+                                    Load::make(getCoordArray(mode.getModePack()),
+                                               ir::Sub::make(pend,
+                                                             sliceHeight)))));
+  return ModeFunction(computeCoordend, {0, coordend});
+}
+
+ModeFunction SlicedModeFormat::posIterAccess(ir::Expr pos,
+                                             std::vector<ir::Expr> coords,
+                                             Mode mode) const {
+  taco_iassert(mode.getPackLocation() == 0);
+  taco_uassert(mode.getModePack().getNumModes() == 1)
+      << "Sliced modes cannot share index arrays with other modes";
+
+  Expr idx = Load::make(getCoordArray(mode.getModePack()), pos);
+  return ModeFunction(Stmt(), {idx, true});
+}
+
+Expr SlicedModeFormat::posIterStride(Mode mode) const {
+  return sliceHeight;
+}
+
+Expr SlicedModeFormat::posIterSliceFiber(Expr slot, Expr numFibers,
+                                         Mode mode) const {
+  // The slots follow the ranges of the fibers and the number of positions
+  Expr slots = ir::Add::make(ir::Mul::make(numFibers, 2), 1);
+  return Load::make(getPosArray(mode.getModePack()),
+                    ir::Add::make(slots, slot));
+}
+
+vector<Expr> SlicedModeFormat::getArrays(Expr tensor, int mode,
+                                         int level) const {
+  std::string arraysName = util::toString(tensor) + std::to_string(level);
+  return {GetProperty::make(tensor, TensorProperty::Indices,
+                            level - 1, 0, arraysName + "_pos"),
+          GetProperty::make(tensor, TensorProperty::Indices,
+                            level - 1, 1, arraysName + "_crd")};
+}
+
+int SlicedModeFormat::getSliceHeight() const {
+  return sliceHeight;
+}
+
+int SlicedModeFormat::getSortWindow() const {
+  return sortWindow;
+}
+
+void SlicedModeFormat::slice(const int* pos, const int* crd, const Array& vals,
+                             size_t numFibers, Array* slicedPos,
+                             Array* slicedCrd, Array* slicedVals) const {
+  const size_t height = sliceHeight;
+  auto length = [&](size_t fiber) { return pos[fiber + 1] - pos[fiber]; };
+
+  // Sort the fibers of every window by decreasing length
+  vector<size_t> order(numFibers);
+  std::iota(order.begin(), order.end(), 0);
+  for (size_t begin = 0; begin < numFibers; begin += sortWindow) {
+    const size_t end = std::min(numFibers, begin + sortWindow);
+    std::stable_sort(order.begin() + begin, order.begin() + end,
+                     [&](size_t a, size_t b) { return length(a) > length(b); });
+  }
+
+  // Every slice is as long as its first fiber, which is its longest one
+  const size_t numSlices = (numFibers + height - 1) / height;
+  vector<size_t> sliceBegin(numSlices + 1, 0);
+  for (size_t s = 0; s < numSlices; s++) {
+    const size_t end = std::min(numFibers, (s + 1) * height);
+    std::stable_sort(order.begin() + s * height, order.begin() + end,
+                     [&](size_t a, size_t b) { return length(a) > length(b); });
+    sliceBegin[s + 1] = sliceBegin[s] + length(order[s * height]) * height;
+  }
+  const size_t size = sliceBegin[numSlices];
+  taco_uassert(size <= (size_t)INT_MAX && 3 * numFibers < (size_t)INT_MAX)
+      << "Too many positions to slice";
+
+  *slicedPos = makeArray(type<int>(), 3 * numFibers + 1);
+  *slicedCrd = makeArray(type<int>(), size);
+  *slicedVals = makeArray(vals.getType(), size);
+  slicedCrd->zero();
+  slicedVals->zero();
+
+  int* slicedPosData = (int*)slicedPos->getData();
+  int* slicedCrdData = (int*)slicedCrd->getData();
+  char* slicedValsData = (char*)slicedVals->getData();
+  const char* valsData = (const char*)vals.getData();
+  const size_t valBytes = vals.getType().getNumBytes();
+  for (size_t k = 0; k < numFibers; k++) {
+    const size_t fiber = order[k];
+    const size_t begin = sliceBegin[k / height] + k % height;
+    slicedPosData[2 * fiber] = (int)begin;
+    slicedPosData[2 * fiber + 1] = (int)(begin + length(fiber) * height);
+    slicedPosData[2 * numFibers + 1 + k] = (int)fiber;
+    for (int p = pos[fiber]; p < pos[fiber + 1]; p++) {
+      const size_t slicedP = begin + (p - pos[fiber]) * height;
+      slicedCrdData[slicedP] = crd[p];
+      memcpy(slicedValsData + slicedP * valBytes, valsData + p * valBytes,
+             valBytes);
+    }
+  }
+  slicedPosData[2 * numFibers] = (int)size;
+}
+
+Expr SlicedModeFormat::getPosArray(ModePack pack) const {
+  return pack.getArray(0);
+}
+
+Expr SlicedModeFormat::getCoordArray(ModePack pack) const {
+  return pack.getArray(1);
+}
+
+bool SlicedModeFormat::equals(const ModeFormatImpl& other) const {
+  const auto& otherSliced = static_cast<const SlicedModeFormat&>(other);
+  return ModeFormatImpl::equals(other) &&
+         sliceHeight == otherSliced.sliceHeight &&
+         sortWindow == otherSliced.sortWindow;
+}
+
+}
@@ -0,0 +1,333 @@
+#include "taco/storage/allocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if USE_OPENMP
+#include <omp.h>
+#endif
+
+#include "taco/error.h"
+
+using namespace std;
+
+namespace taco {
+
+// class Allocator
+Allocator::~Allocator() {
+}
+
+void* Allocator::reallocate(void* ptr, size_t oldSize, size_t size) {
+  taco_uassert(ptr == nullptr || oldSize > 0)
+      << "The allocator cannot resize an allocation of unknown size";
+  void* result = allocate(size, false);
+  if (ptr != nullptr) {
+    memcpy(result, ptr, std::min(oldSize, size));
+    deallocate(ptr);
+  }
+  return result;
+}
+
+
+// class MallocAllocator
+void* MallocAllocator::allocate(size_t size, bool clear) {
+  void* result = clear ? calloc(1, size) : malloc(size);
+  taco_uassert(result != nullptr || size == 0) << "Out of memory";
+  return result;
+}
+
+void* MallocAllocator::reallocate(void* ptr, size_t oldSize, size_t size) {
+  void* result = realloc(ptr, size);
+  taco_uassert(result != nullptr || size == 0) << "Out of memory";
+  return result;
+}
+
+void MallocAllocator::deallocate(void* ptr) {
+  free(ptr);
+}
+
+
+// class HugePageAllocator
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+void* HugePageAllocator::allocate(size_t size, bool clear) {
+  if (size < HUGE_PAGE_SIZE) {
+    return MallocAllocator().allocate(size, clear);
+  }
+  size_t alignedSize = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE *
+                       HUGE_PAGE_SIZE;
+  void* result = nullptr;
+  taco_uassert(posix_memalign(&result, HUGE_PAGE_SIZE, alignedSize) == 0)
+      << "Out of memory";
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  madvise(result, alignedSize, MADV_HUGEPAGE);
+#endif
+  if (clear) {
+    memset(result, 0, size);
+  }
+  return result;
+}
+
+void HugePageAllocator::deallocate(void* ptr) {
+  free(ptr);
+}
+
+
+// The blocks of the NUMA and arena allocators start with a header, which is
+// large enough to keep the data 16-byte aligned.
+static const size_t HEADER_SIZE = 16;
+
+
+// class NumaAllocator
+// Arrays smaller than this are left to the C allocator, since NUMA placement
+// works at page granularity.
+static const size_t MIN_NUMA_SIZE = 64 * 1024;
+
+// Every block starts with a header that records the length of its mapping,
+// which is zero for blocks from the C allocator, and its usable size.
+struct NumaHeader {
+  size_t mappedSize;
+  size_t size;
+};
+static_assert(sizeof(NumaHeader) == HEADER_SIZE, "unexpected header size");
+
+static NumaHeader& getNumaHeader(void* ptr) {
+  return *(NumaHeader*)((char*)ptr - HEADER_SIZE);
+}
+
+// Parses a node list such as "0-1,4" from sysfs.
+static vector<int> getOnlineNodes() {
+  vector<int> nodes;
+  std::ifstream file("/sys/devices/system/node/online");
+  string range;
+  while (std::getline(file, range, ',')) {
+    std::istringstream stream(range);
+    int first = 0, last = 0;
+    char dash = 0;
+    if (!(stream >> first)) {
+      continue;
+    }
+    last = (stream >> dash >> last) ? last : first;
+    for (int node = first; node <= last; node++) {
+      nodes.push_back(node);
+    }
+  }
+  if (nodes.empty()) {
+    nodes.push_back(0);
+  }
+  return nodes;
+}
+
+static const vector<int>& getNodes() {
+  static const vector<int> nodes = getOnlineNodes();
+  return nodes;
+}
+
+#if defined(__linux__) && defined(SYS_mbind)
+#define TACO_NUMA_MMAP 1
+static const int MPOL_INTERLEAVE_MODE = 3;
+
+static void interleave(void* data, size_t size) {
+  const vector<int>& nodes = getNodes();
+  if (nodes.size() < 2) {
+    return;
+  }
+  const size_t bitsPerWord = sizeof(unsigned long) * 8;
+  vector<unsigned long> mask(nodes.back() / bitsPerWord + 1, 0);
+  for (int node : nodes) {
+    mask[node / bitsPerWord] |= 1ul << (node % bitsPerWord);
+  }
+  // Placement is a hint, so the memory stays usable if the kernel refuses
+  syscall(SYS_mbind, data, size, MPOL_INTERLEAVE_MODE, mask.data(),
+          mask.size() * bitsPerWord + 1, 0);
+}
+
+// Writes every page once from a statically scheduled parallel loop, so that
+// each page is placed on the node of the thread whose iterations it holds.
+static void touchPages(void* data, size_t size) {
+  const long pageSize = sysconf(_SC_PAGESIZE);
+  const long numPages = (long)((size + pageSize - 1) / pageSize);
+  #if USE_OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif
+  for (long page = 0; page < numPages; page++) {
+    ((volatile char*)data)[page * pageSize] = 0;
+  }
+}
+#endif
+
+NumaAllocator::NumaAllocator(Policy policy) : policy(policy) {
+}
+
+void* NumaAllocator::allocate(size_t size, bool clear) {
+  void* block = nullptr;
+  size_t mappedSize = 0;
+#if TACO_NUMA_MMAP
+  if (size >= MIN_NUMA_SIZE) {
+    mappedSize = size + HEADER_SIZE;
+    block = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    taco_uassert(block != MAP_FAILED) << "Out of memory";
+    if (policy == Interleave) {
+      interleave(block, mappedSize);
+    } else if (clear) {
+      touchPages(block, mappedSize);
+    }
+  }
+#endif
+  if (block == nullptr) {
+    // Mapped memory is zero already
+    block = MallocAllocator().allocate(size + HEADER_SIZE, clear);
+  }
+  void* ptr = (char*)block + HEADER_SIZE;
+  getNumaHeader(ptr) = {mappedSize, size};
+  return ptr;
+}
+
+void* NumaAllocator::reallocate(void* ptr, size_t oldSize, size_t size) {
+  if (ptr == nullptr) {
+    return allocate(size, false);
+  }
+  const NumaHeader header = getNumaHeader(ptr);
+#if TACO_NUMA_MMAP && defined(MREMAP_MAYMOVE)
+  // Moving a mapping keeps its placement policy and the pages it has placed
+  if (header.mappedSize > 0 && size >= MIN_NUMA_SIZE) {
+    const size_t mappedSize = size + HEADER_SIZE;
+    void* block = mremap((char*)ptr - HEADER_SIZE, header.mappedSize,
+                         mappedSize, MREMAP_MAYMOVE);
+    taco_uassert(block != MAP_FAILED) << "Out of memory";
+    void* result = (char*)block + HEADER_SIZE;
+    getNumaHeader(result) = {mappedSize, size};
+    return result;
+  }
+#endif
+  void* result = allocate(size, false);
+  memcpy(result, ptr, std::min(header.size, size));
+  deallocate(ptr);
+  return result;
+}
+
+void NumaAllocator::deallocate(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  void* block = (char*)ptr - HEADER_SIZE;
+  const size_t mappedSize = getNumaHeader(ptr).mappedSize;
+#if TACO_NUMA_MMAP
+  if (mappedSize > 0) {
+    munmap(block, mappedSize);
+    return;
+  }
+#endif
+  taco_iassert(mappedSize == 0);
+  free(block);
+}
+
+NumaAllocator::Policy NumaAllocator::getPolicy() const {
+  return policy;
+}
+
+int NumaAllocator::getNumNodes() {
+  return (int)getNodes().size();
+}
+
+
+// class ArenaAllocator
+// Every block starts with a header that records its size class.
+static const size_t MIN_SIZE_CLASS = 6;
+
+static size_t getSizeClass(size_t size) {
+  size_t sizeClass = MIN_SIZE_CLASS;
+  while (((size_t)1 << sizeClass) < size + HEADER_SIZE) {
+    sizeClass++;
+  }
+  return sizeClass;
+}
+
+static size_t& getHeader(void* ptr) {
+  return *(size_t*)((char*)ptr - HEADER_SIZE);
+}
+
+ArenaAllocator::ArenaAllocator(shared_ptr<Allocator> backing)
+    : backing(backing), freeBlocks(sizeof(size_t) * 8) {
+  taco_uassert(backing != nullptr) << "An arena needs a backing allocator";
+}
+
+ArenaAllocator::~ArenaAllocator() {
+  trim();
+}
+
+void* ArenaAllocator::allocate(size_t size, bool clear) {
+  const size_t sizeClass = getSizeClass(size);
+  void* block = nullptr;
+  {
+    lock_guard<std::mutex> lock(freeBlocksMutex);
+    vector<void*>& blocks = freeBlocks[sizeClass];
+    if (!blocks.empty()) {
+      block = blocks.back();
+      blocks.pop_back();
+    } else {
+      numBackingAllocations++;
+    }
+  }
+  if (block == nullptr) {
+    block = backing->allocate((size_t)1 << sizeClass, false);
+  }
+
+  void* ptr = (char*)block + HEADER_SIZE;
+  getHeader(ptr) = sizeClass;
+  if (clear) {
+    memset(ptr, 0, size);
+  }
+  return ptr;
+}
+
+void* ArenaAllocator::reallocate(void* ptr, size_t oldSize, size_t size) {
+  if (ptr == nullptr) {
+    return allocate(size, false);
+  }
+  const size_t capacity = ((size_t)1 << getHeader(ptr)) - HEADER_SIZE;
+  if (size <= capacity) {
+    return ptr;
+  }
+  void* result = allocate(size, false);
+  memcpy(result, ptr, (oldSize > 0) ? std::min(oldSize, capacity) : capacity);
+  deallocate(ptr);
+  return result;
+}
+
+void ArenaAllocator::deallocate(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  const size_t sizeClass = getHeader(ptr);
+  taco_iassert(sizeClass < freeBlocks.size());
+  lock_guard<std::mutex> lock(freeBlocksMutex);
+  freeBlocks[sizeClass].push_back((char*)ptr - HEADER_SIZE);
+}
+
+void ArenaAllocator::trim() {
+  lock_guard<std::mutex> lock(freeBlocksMutex);
+  for (auto& blocks : freeBlocks) {
+    for (void* block : blocks) {
+      backing->deallocate(block);
+    }
+    blocks.clear();
+  }
+}
+
+size_t ArenaAllocator::getNumBackingAllocations() const {
+  lock_guard<std::mutex> lock(freeBlocksMutex);
+  return numBackingAllocations;
+}
+
+}
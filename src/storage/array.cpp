@@ -18,8 +18,13 @@ struct Array::Content : util::Uncopyable {
   void*  data;
   size_t size;
   Policy policy = Array::UserOwns;
+  std::function<void(void*)> deleter;
 
   ~Content() {
+    if (deleter) {
+      deleter(data);
+      return;
+    }
     switch (policy) {
       case UserOwns:
         // do nothing
@@ -98,6 +103,14 @@ Array::Array(Datatype type, void* data, size_t size, Policy policy) : Array() {
   content->policy = policy;
 }
 
+Array::Array(Datatype type, void* data, size_t size,
+             std::function<void(void*)> deleter) : Array() {
+  content->type = type;
+  content->data = data;
+  content->size = size;
+  content->deleter = deleter;
+}
+
 const Datatype& Array::getType() const {
   return content->type;
 }
@@ -123,7 +136,23 @@ TypedComponentRef Array::operator[] (const int index) const {
 }
 
 void Array::zero() {
-  memset(getData(), 0, getSize() * getType().getNumBytes());
+  const size_t numBytes = getSize() * getType().getNumBytes();
+#if USE_OPENMP
+  // Zero large arrays with a statically scheduled parallel loop, so that pages
+  // not touched before are placed on the nodes of the threads that use them
+  const size_t blockSize = 64 * 1024;
+  const long numBlocks = (long)((numBytes + blockSize - 1) / blockSize);
+  if (numBlocks > 1) {
+    #pragma omp parallel for schedule(static)
+    for (long block = 0; block < numBlocks; block++) {
+      const size_t begin = block * blockSize;
+      memset((char*)getData() + begin, 0,
+             std::min(blockSize, numBytes - begin));
+    }
+    return;
+  }
+#endif
+  memset(getData(), 0, numBytes);
 }
 
 template<typename T>
@@ -0,0 +1,395 @@
+#include "storage/component_writer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+#if USE_OPENMP
+#include <omp.h>
+#endif
+
+#include "taco/tensor.h"
+#include "taco/format.h"
+#include "taco/error.h"
+#include "taco/lower/mode_format_packed.h"
+#include "taco/lower/mode_format_sliced.h"
+#include "taco/storage/storage.h"
+#include "taco/storage/index.h"
+#include "taco/storage/array.h"
+
+using namespace std;
+
+namespace taco {
+
+/// The number of components formatted into a buffer before it is written.
+static const size_t COMPONENTS_PER_BUFFER = 1 << 16;
+
+// Number formatting
+
+static void appendUnsigned(string& out, unsigned long long value) {
+  char buffer[24];
+  char* end = buffer + sizeof(buffer);
+  char* begin = end;
+  do {
+    *--begin = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  out.append(begin, end - begin);
+}
+
+static void appendSigned(string& out, long long value) {
+  if (value < 0) {
+    out.push_back('-');
+    appendUnsigned(out, 0ull - (unsigned long long)value);
+  } else {
+    appendUnsigned(out, (unsigned long long)value);
+  }
+}
+
+static double parseFloat(const char* str, double) {
+  return strtod(str, nullptr);
+}
+
+static float parseFloat(const char* str, float) {
+  return strtof(str, nullptr);
+}
+
+/// Append the shortest decimal representation of the value that reads back to
+/// the same value.
+template <typename T>
+static void appendFloat(string& out, T value) {
+  // Integral values are common (e.g. counts and test data) and much cheaper
+  // to format without going through printf
+  if (value == std::trunc(value) && std::fabs(value) < (T)1e15 &&
+      !(value == 0 && std::signbit(value))) {
+    appendSigned(out, (long long)value);
+    return;
+  }
+
+  char buffer[32];
+  int length = 0;
+  for (int precision = numeric_limits<T>::digits10;
+       precision <= numeric_limits<T>::max_digits10; precision++) {
+    length = snprintf(buffer, sizeof(buffer), "%.*g", precision,
+                      (double)value);
+    if (parseFloat(buffer, value) == value) {
+      break;
+    }
+  }
+  out.append(buffer, length);
+}
+
+template <typename T>
+static typename enable_if<is_integral<T>::value && is_signed<T>::value>::type
+appendValue(string& out, T value) {
+  appendSigned(out, (long long)value);
+}
+
+template <typename T>
+static typename enable_if<is_integral<T>::value && !is_signed<T>::value>::type
+appendValue(string& out, T value) {
+  appendUnsigned(out, (unsigned long long)value);
+}
+
+static void appendValue(string& out, float value) {
+  appendFloat(out, value);
+}
+
+static void appendValue(string& out, double value) {
+  appendFloat(out, value);
+}
+
+template <typename T>
+static void appendValue(string& out, const complex<T>& value) {
+  out.push_back('(');
+  appendFloat(out, value.real());
+  out.push_back(',');
+  appendFloat(out, value.imag());
+  out.push_back(')');
+}
+
+// Component formatting
+
+/// Formats the components of a tensor by walking its index arrays. Only
+/// dense, compressed, packed, sliced, hashed, bitmap and singleton levels are
+/// supported, and sliced levels cannot be the top level.
+template <typename T>
+class ComponentFormatter {
+public:
+  ComponentFormatter(const TensorBase& tensor, bool writeCoordinates)
+      : writeCoordinates(writeCoordinates), order(tensor.getOrder()),
+        levelOfMode(order), supported(true) {
+    const TensorStorage& storage = tensor.getStorage();
+    const Format& format = storage.getFormat();
+    const Index& index = storage.getIndex();
+    for (size_t k = 0; k < order; k++) {
+      levelOfMode[format.getModeOrdering()[k]] = k;
+
+      Level level;
+      const string name = format.getModeFormats()[k].getName();
+      const ModeIndex& modeIndex = index.getModeIndex(k);
+      if (name == Dense.getName()) {
+        level.kind = Level::Dense;
+        level.dimension = getIndexData(modeIndex, 0)[0];
+      } else if (name == Compressed.getName()) {
+        level.kind = Level::Compressed;
+        setPosData(modeIndex, &level);
+        level.crd = getIndexData(modeIndex, 1);
+      } else if (name == Packed.getName()) {
+        level.kind = Level::Packed;
+        setPosData(modeIndex, &level);
+        level.crd = getIndexData(modeIndex, 1);
+      } else if (name == Sliced.getName() && k > 0) {
+        level.kind = Level::Sliced;
+        level.pos = getIndexData(modeIndex, 0);
+        level.crd = getIndexData(modeIndex, 1);
+        level.stride = std::static_pointer_cast<const SlicedModeFormat>(
+            format.getModeFormats()[k].getImpl())->getSliceHeight();
+      } else if (name == Hashed.getName()) {
+        level.kind = Level::Hashed;
+        level.crd = getIndexData(modeIndex, 1);
+        level.dimension = getIndexData(modeIndex, 0)[0];
+      } else if (name == Bitmap.getName()) {
+        level.kind = Level::Bitmap;
+        level.dimension = getIndexData(modeIndex, 0)[0];
+        level.bits = (const uint64_t*)modeIndex.getIndexArray(1).getData();
+      } else if (name == Singleton.getName()) {
+        level.kind = Level::Singleton;
+        level.crd = getIndexData(modeIndex, 1);
+      } else {
+        supported = false;
+      }
+      levels.push_back(level);
+    }
+    vals = (const T*)storage.getValues().getData();
+  }
+
+  /// True if the formatter supports the tensor's format.
+  bool isSupported() const {
+    return supported;
+  }
+
+  /// The number of positions in the top level of the tensor.
+  size_t getNumTopPositions() const {
+    size_t begin, end;
+    getRange(0, 0, &begin, &end);
+    return end - begin;
+  }
+
+  /// Format the components below positions [begin, end) of the top level.
+  void format(size_t begin, size_t end, string& out) const {
+    if (order == 0) {
+      appendValue(out, vals[0]);
+      out.push_back('\n');
+      return;
+    }
+    vector<int> coords(order);
+    formatLevel(0, 0, begin, end, coords.data(), out);
+  }
+
+private:
+  struct Level {
+    enum Kind {Dense, Compressed, Packed, Sliced, Hashed, Bitmap, Singleton};
+    Kind       kind;
+    int        dimension = 0;
+    int        stride = 1;
+    const int* pos = nullptr;
+    const int64_t* pos64 = nullptr;
+    const int* crd = nullptr;
+    const uint64_t* bits = nullptr;
+  };
+
+  const bool          writeCoordinates;
+  const size_t        order;
+  vector<Level>       levels;
+  vector<size_t>      levelOfMode;
+  const T*            vals;
+  bool                supported;
+
+  const int* getIndexData(const ModeIndex& modeIndex, int i) {
+    const Array& array = modeIndex.getIndexArray(i);
+    if (array.getType() != Int32) {
+      supported = false;
+    }
+    return (const int*)array.getData();
+  }
+
+  void setPosData(const ModeIndex& modeIndex, Level* level) {
+    const Array& array = modeIndex.getIndexArray(0);
+    if (array.getType() == Int64) {
+      level->pos64 = (const int64_t*)array.getData();
+    } else {
+      level->pos = getIndexData(modeIndex, 0);
+    }
+  }
+
+  void getRange(size_t k, size_t parentPos, size_t* begin, size_t* end) const {
+    const Level& level = levels[k];
+    switch (level.kind) {
+      case Level::Dense:
+      case Level::Hashed:
+      case Level::Bitmap:
+        *begin = parentPos * level.dimension;
+        *end = *begin + level.dimension;
+        break;
+      case Level::Compressed:
+      case Level::Packed:
+        if (level.pos64 != nullptr) {
+          *begin = level.pos64[parentPos];
+          *end = level.pos64[parentPos + 1];
+        } else {
+          *begin = level.pos[parentPos];
+          *end = level.pos[parentPos + 1];
+        }
+        break;
+      case Level::Sliced:
+        *begin = level.pos[2 * parentPos];
+        *end = level.pos[2 * parentPos + 1];
+        break;
+      case Level::Singleton:
+        *begin = parentPos;
+        *end = parentPos + 1;
+        break;
+      default:
+        taco_unreachable;
+        *begin = 0;
+        *end = 0;
+        break;
+    }
+  }
+
+  void formatLevel(size_t k, size_t parentPos, size_t begin, size_t end,
+                   int* coords, string& out) const {
+    const Level& level = levels[k];
+    for (size_t p = begin; p < end; p += level.stride) {
+      switch (level.kind) {
+        case Level::Dense:
+          coords[k] = (int)(p - parentPos * level.dimension);
+          break;
+        case Level::Packed:
+          coords[k] = PackedModeFormat::unpackCoordinate(level.crd, p);
+          break;
+        case Level::Hashed:
+          // Skip empty slots
+          if (level.crd[p] < 0) {
+            continue;
+          }
+          coords[k] = level.crd[p];
+          break;
+        case Level::Bitmap:
+          // Skip unmarked positions
+          if (!(level.bits[p / 64] & ((uint64_t)1 << (p % 64)))) {
+            continue;
+          }
+          coords[k] = (int)(p - parentPos * level.dimension);
+          break;
+        default:
+          coords[k] = level.crd[p];
+          break;
+      }
+      if (k + 1 < order) {
+        size_t childBegin, childEnd;
+        getRange(k + 1, p, &childBegin, &childEnd);
+        formatLevel(k + 1, p, childBegin, childEnd, coords, out);
+      } else {
+        if (writeCoordinates) {
+          for (size_t mode = 0; mode < order; mode++) {
+            appendUnsigned(out, coords[levelOfMode[mode]] + 1);
+            out.push_back(' ');
+          }
+        }
+        appendValue(out, vals[p]);
+        out.push_back('\n');
+      }
+    }
+  }
+};
+
+template <typename T>
+static void writeComponentsTyped(ostream& stream, const TensorBase& tensor,
+                                 bool writeCoordinates) {
+  // Creating an iterator packs or computes the tensor if needed
+  tensor.iterator<T>();
+
+  ComponentFormatter<T> formatter(tensor, writeCoordinates);
+  if (!formatter.isSupported()) {
+    string out;
+    for (auto& value : iterate<T>(tensor)) {
+      if (writeCoordinates) {
+        for (int k = 0; k < tensor.getOrder(); ++k) {
+          appendUnsigned(out, value.first[k] + 1);
+          out.push_back(' ');
+        }
+      }
+      appendValue(out, value.second);
+      out.push_back('\n');
+      if (out.size() >= COMPONENTS_PER_BUFFER * 16) {
+        stream.write(out.data(), out.size());
+        out.clear();
+      }
+    }
+    stream.write(out.data(), out.size());
+    return;
+  }
+
+  // Split the top level into blocks of roughly COMPONENTS_PER_BUFFER
+  // components and format one batch of blocks in parallel at a time, so that
+  // the buffered output stays bounded.
+  const size_t numTopPositions = (tensor.getOrder() > 0)
+                                 ? formatter.getNumTopPositions() : 1;
+  const size_t numComponents = tensor.getStorage().getValues().getSize();
+  const size_t numBlocks = std::max((size_t)1, std::min(numTopPositions,
+      numComponents / COMPONENTS_PER_BUFFER));
+  int numThreads = 1;
+#if USE_OPENMP
+  numThreads = std::max(1, taco_get_num_threads());
+#endif
+
+  vector<string> buffers(std::min((size_t)numThreads, numBlocks));
+  for (size_t first = 0; first < numBlocks; first += buffers.size()) {
+    const long numBatchBlocks = (long)std::min(buffers.size(),
+                                               numBlocks - first);
+    #if USE_OPENMP
+    #pragma omp parallel for num_threads(numThreads) schedule(static, 1)
+    #endif
+    for (long i = 0; i < numBatchBlocks; i++) {
+      const size_t block = first + i;
+      buffers[i].clear();
+      formatter.format(numTopPositions * block / numBlocks,
+                       numTopPositions * (block + 1) / numBlocks, buffers[i]);
+    }
+    for (long i = 0; i < numBatchBlocks; i++) {
+      stream.write(buffers[i].data(), buffers[i].size());
+    }
+  }
+}
+
+void writeComponents(ostream& stream, const TensorBase& tensor,
+                     bool writeCoordinates) {
+  switch(tensor.getComponentType().getKind()) {
+    case Datatype::Bool: writeComponentsTyped<bool>(stream, tensor, writeCoordinates); break;
+    case Datatype::UInt8: writeComponentsTyped<uint8_t>(stream, tensor, writeCoordinates); break;
+    case Datatype::UInt16: writeComponentsTyped<uint16_t>(stream, tensor, writeCoordinates); break;
+    case Datatype::UInt32: writeComponentsTyped<uint32_t>(stream, tensor, writeCoordinates); break;
+    case Datatype::UInt64: writeComponentsTyped<uint64_t>(stream, tensor, writeCoordinates); break;
+    case Datatype::UInt128: writeComponentsTyped<unsigned long long>(stream, tensor, writeCoordinates); break;
+    case Datatype::Int8: writeComponentsTyped<int8_t>(stream, tensor, writeCoordinates); break;
+    case Datatype::Int16: writeComponentsTyped<int16_t>(stream, tensor, writeCoordinates); break;
+    case Datatype::Int32: writeComponentsTyped<int32_t>(stream, tensor, writeCoordinates); break;
+    case Datatype::Int64: writeComponentsTyped<int64_t>(stream, tensor, writeCoordinates); break;
+    case Datatype::Int128: writeComponentsTyped<long long>(stream, tensor, writeCoordinates); break;
+    case Datatype::Float32: writeComponentsTyped<float>(stream, tensor, writeCoordinates); break;
+    case Datatype::Float64: writeComponentsTyped<double>(stream, tensor, writeCoordinates); break;
+    case Datatype::Complex64: writeComponentsTyped<std::complex<float>>(stream, tensor, writeCoordinates); break;
+    case Datatype::Complex128: writeComponentsTyped<std::complex<double>>(stream, tensor, writeCoordinates); break;
+    case Datatype::Undefined: taco_ierror; break;
+    default:
+      taco_unreachable;
+  }
+}
+
+}
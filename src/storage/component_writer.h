@@ -0,0 +1,21 @@
+#ifndef TACO_STORAGE_COMPONENT_WRITER_H
+#define TACO_STORAGE_COMPONENT_WRITER_H
+
+#include <ostream>
+
+namespace taco {
+class TensorBase;
+
+/// Write the components of a tensor to a stream, one component per line, in
+/// the order they are stored. Each line contains the one-based coordinates of
+/// the component (if `writeCoordinates` is true) followed by its value.
+///
+/// The writer walks the packed index and value arrays directly, formats
+/// numbers into per-thread buffers (each floating-point value with the fewest
+/// digits that read back to the same value), and writes the buffers to the
+/// stream in large sequential writes.
+void writeComponents(std::ostream& stream, const TensorBase& tensor,
+                     bool writeCoordinates);
+
+}
+#endif
@@ -5,6 +5,7 @@
 #include <sstream>
 #include <cstdlib>
 #include <climits>
+#include <algorithm>
 
 #include "taco/tensor.h"
 #include "taco/format.h"
@@ -12,6 +13,7 @@
 #include "taco/util/strings.h"
 #include "taco/util/timers.h"
 #include "taco/util/files.h"
+#include "storage/component_writer.h"
 
 using namespace std;
 
@@ -81,6 +83,95 @@ TensorBase readMTX(std::istream& stream, const Format& format, bool pack) {
   return dispatchReadMTX(stream, format, pack);
 }
 
+TensorBase readMTXStreaming(std::string filename, const Format& format,
+                            size_t chunkSize) {
+  std::fstream file;
+  util::openStream(file, filename, fstream::in);
+  TensorBase tensor = readMTXStreaming(file, format, chunkSize);
+  file.close();
+  return tensor;
+}
+
+TensorBase readMTXStreaming(std::istream& stream, const Format& format,
+                            size_t chunkSize) {
+  string line;
+  if (!std::getline(stream, line)) {
+    return TensorBase();
+  }
+
+  // Read Header
+  std::stringstream headerStream(line);
+  string head, type, formats, field, symmetry;
+  headerStream >> head >> type >> formats >> field >> symmetry;
+  taco_uassert(head=="%%MatrixMarket") << "Unknown header of MatrixMarket";
+  taco_uassert((type=="matrix") || (type=="tensor"))
+                                       << "Unknown type of MatrixMarket";
+  taco_uassert((formats=="coordinate") || (formats=="array"))
+                                       << "MatrixMarket format not available";
+  taco_uassert(field=="real")          << "MatrixMarket field not available";
+  taco_uassert((symmetry=="general") || (symmetry=="symmetric"))
+                                       << "MatrixMarket symmetry not available";
+  const bool symm = (symmetry=="symmetric");
+  const bool coordinate = (formats=="coordinate");
+
+  // Skip comments at the top of the file
+  std::getline(stream, line);
+  string token;
+  do {
+    std::stringstream lineStream(line);
+    lineStream >> token;
+    if (token[0] != '%') {
+      break;
+    }
+  } while (std::getline(stream, line));
+
+  // The first non-comment line is the header with dimensions (and the number
+  // of components if the file stores coordinates)
+  vector<int> dimensions;
+  char* linePtr = (char*)line.data();
+  while (size_t dimension = strtoul(linePtr, &linePtr, 10)) {
+    taco_uassert(dimension <= INT_MAX) << "Dimension exceeds INT_MAX";
+    dimensions.push_back(static_cast<int>(dimension));
+  }
+  if (coordinate) {
+    dimensions.pop_back();
+  }
+  if (symm)
+    taco_uassert(dimensions.size()==2) << "Symmetry only available for matrix";
+  taco_uassert((size_t)format.getOrder() == dimensions.size())
+      << "The format order does not match the order of the tensor in the file";
+
+  StreamPacker packer(dimensions, format, chunkSize);
+  const size_t order = dimensions.size();
+  std::vector<int> coord(order);
+  size_t n = 0;
+  while (std::getline(stream, line)) {
+    linePtr = (char*)line.data();
+    if (coordinate) {
+      for (size_t mode = 0; mode < order; mode++) {
+        long index = strtol(linePtr, &linePtr, 10);
+        taco_uassert(index <= INT_MAX) << "Index exceeds INT_MAX";
+        coord[mode] = static_cast<int>(index) - 1;
+      }
+    } else {
+      // Array files list components in column-major order
+      size_t index = n++;
+      for (size_t mode = 0; mode < order; mode++) {
+        coord[mode] = index % dimensions[mode];
+        index = index / dimensions[mode];
+      }
+    }
+    double val = strtod(linePtr, &linePtr);
+    packer.insert(coord.data(), val);
+    if (symm && coord.front() != coord.back()) {
+      std::reverse(coord.begin(), coord.end());
+      packer.insert(coord.data(), val);
+    }
+  }
+
+  return packer.finalize();
+}
+
 template <typename T>
 TensorBase dispatchReadSparse(std::istream& stream, const T& format, 
                               bool symm) {
@@ -244,25 +335,7 @@ void writeMTX(std::ostream& stream, const TensorBase& tensor) {
     writeSparse(stream, tensor);
 }
 
-template<typename T>
-static void writeSparseTyped(std::ostream& stream, const TensorBase& tensor) {
-  if(tensor.getOrder() == 2)
-    stream << "%%MatrixMarket matrix coordinate real general" << std::endl;
-  else
-    stream << "%%MatrixMarket tensor coordinate real general" << std::endl;
-  stream << "%"                                             << std::endl;
-  stream << util::join(tensor.getDimensions(), " ") << " ";
-  stream << tensor.getStorage().getIndex().getSize() << endl;
-  for (auto& value : iterate<T>(tensor)) {
-    for (int k = 0; k < tensor.getOrder(); ++k) {
-      stream << value.first[k]+1 << " ";
-    }
-    stream << value.second << endl;
-  }
-}
-
-template<typename T>
-static void writeSparseCharTyped(std::ostream& stream, const TensorBase& tensor) {
+void writeSparse(std::ostream& stream, const TensorBase& tensor) {
   if(tensor.getOrder() == 2)
     stream << "%%MatrixMarket matrix coordinate real general" << std::endl;
   else
@@ -270,86 +343,17 @@ static void writeSparseCharTyped(std::ostream& stream, const TensorBase& tensor)
   stream << "%"                                             << std::endl;
   stream << util::join(tensor.getDimensions(), " ") << " ";
   stream << tensor.getStorage().getIndex().getSize() << endl;
-  for (auto& value : iterate<T>(tensor)) {
-    for (int k = 0; k < tensor.getOrder(); ++k) {
-      stream << value.first[k]+1 << " ";
-    }
-    stream << static_cast<int>(value.second) << endl;
-  }
+  writeComponents(stream, tensor, true);
 }
 
-
-void writeSparse(std::ostream& stream, const TensorBase& tensor) {
-  switch(tensor.getComponentType().getKind()) {
-    case Datatype::Bool: writeSparseTyped<bool>(stream, tensor); break;
-    case Datatype::UInt8: writeSparseCharTyped<uint8_t>(stream, tensor); break;
-    case Datatype::UInt16: writeSparseTyped<uint16_t>(stream, tensor); break;
-    case Datatype::UInt32: writeSparseTyped<uint32_t>(stream, tensor); break;
-    case Datatype::UInt64: writeSparseTyped<uint64_t>(stream, tensor); break;
-    case Datatype::UInt128: writeSparseTyped<unsigned long long>(stream, tensor); break;
-    case Datatype::Int8: writeSparseCharTyped<int8_t>(stream, tensor); break;
-    case Datatype::Int16: writeSparseTyped<int16_t>(stream, tensor); break;
-    case Datatype::Int32: writeSparseTyped<int32_t>(stream, tensor); break;
-    case Datatype::Int64: writeSparseTyped<int64_t>(stream, tensor); break;
-    case Datatype::Int128: writeSparseTyped<long long>(stream, tensor); break;
-    case Datatype::Float32: writeSparseTyped<float>(stream, tensor); break;
-    case Datatype::Float64: writeSparseTyped<double>(stream, tensor); break;
-    case Datatype::Complex64: writeSparseTyped<std::complex<float>>(stream, tensor); break;
-    case Datatype::Complex128: writeSparseTyped<std::complex<double>>(stream, tensor); break;
-    case Datatype::Undefined: taco_ierror; break;
-    default:
-      taco_unreachable;
-  }
-}
-
-template<typename T>
-void writeDenseTyped(std::ostream& stream, const TensorBase& tensor) {
-  if(tensor.getOrder() == 2)
-    stream << "%%MatrixMarket matrix array real general" << std::endl;
-  else
-    stream << "%%MatrixMarket tensor array real general" << std::endl;
-  stream << "%"                                        << std::endl;
-  stream << util::join(tensor.getDimensions(), " ") << " " << endl;
-  for (auto& value : iterate<T>(tensor)) {
-    stream << value.second << endl;
-  }
-}
-
-template<typename T>
-void writeDenseCharTyped(std::ostream& stream, const TensorBase& tensor) {
+void writeDense(std::ostream& stream, const TensorBase& tensor) {
   if(tensor.getOrder() == 2)
     stream << "%%MatrixMarket matrix array real general" << std::endl;
   else
     stream << "%%MatrixMarket tensor array real general" << std::endl;
   stream << "%"                                        << std::endl;
   stream << util::join(tensor.getDimensions(), " ") << " " << endl;
-  for (auto& value : iterate<T>(tensor)) {
-    stream << static_cast<int>(value.second) << endl;
-  }
-}
-
-
-void writeDense(std::ostream& stream, const TensorBase& tensor) {
-  switch(tensor.getComponentType().getKind()) {
-    case Datatype::Bool: writeDenseTyped<bool>(stream, tensor); break;
-    case Datatype::UInt8: writeDenseCharTyped<uint8_t>(stream, tensor); break;
-    case Datatype::UInt16: writeDenseTyped<uint16_t>(stream, tensor); break;
-    case Datatype::UInt32: writeDenseTyped<uint32_t>(stream, tensor); break;
-    case Datatype::UInt64: writeDenseTyped<uint64_t>(stream, tensor); break;
-    case Datatype::UInt128: writeDenseTyped<unsigned long long>(stream, tensor); break;
-    case Datatype::Int8: writeDenseCharTyped<int8_t>(stream, tensor); break;
-    case Datatype::Int16: writeDenseTyped<int16_t>(stream, tensor); break;
-    case Datatype::Int32: writeDenseTyped<int32_t>(stream, tensor); break;
-    case Datatype::Int64: writeDenseTyped<int64_t>(stream, tensor); break;
-    case Datatype::Int128: writeDenseTyped<long long>(stream, tensor); break;
-    case Datatype::Float32: writeDenseTyped<float>(stream, tensor); break;
-    case Datatype::Float64: writeDenseTyped<double>(stream, tensor); break;
-    case Datatype::Complex64: writeDenseTyped<std::complex<float>>(stream, tensor); break;
-    case Datatype::Complex128: writeDenseTyped<std::complex<double>>(stream, tensor); break;
-    case Datatype::Undefined: taco_ierror; break;
-    default:
-      taco_unreachable;
-  }
+  writeComponents(stream, tensor, false);
 }
 
 }
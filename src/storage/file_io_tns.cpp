@@ -13,6 +13,7 @@
 #include "taco/error.h"
 #include "taco/util/strings.h"
 #include "taco/util/files.h"
+#include "storage/component_writer.h"
 
 using namespace std;
 
@@ -94,55 +95,54 @@ TensorBase readTNS(std::istream& stream, const Format& format, bool pack) {
   return dispatchReadTNS(stream, format, pack);
 }
 
-void writeTNS(std::string filename, const TensorBase& tensor) {
+TensorBase readTNSStreaming(std::string filename, const Format& format,
+                            size_t chunkSize) {
   std::fstream file;
-  util::openStream(file, filename, fstream::out);
-  writeTNS(file, tensor);
+  util::openStream(file, filename, fstream::in);
+  TensorBase tensor = readTNSStreaming(file, format, chunkSize);
   file.close();
+  return tensor;
 }
 
-template<typename T>
-static void writeTypedTNS(std::ostream& stream, const TensorBase& tensor) {
-  for (auto& value : iterate<T>(tensor)) {
-    for (int k = 0; k < tensor.getOrder(); ++k) {
-      stream << value.first[k]+1 << " ";
-    }
-    stream << value.second << endl;
+TensorBase readTNSStreaming(std::istream& stream, const Format& format,
+                            size_t chunkSize) {
+  std::string line;
+  if (!std::getline(stream, line)) {
+    return TensorBase();
   }
-}
 
-template<typename T>
-static void writeCharTNS(std::ostream& stream, const TensorBase& tensor) {
-  for (auto& value : iterate<T>(tensor)) {
-    for (int k = 0; k < tensor.getOrder(); ++k) {
-      stream << value.first[k]+1 << " ";
+  // Infer tensor order from the first coordinate. The dimensions are inferred
+  // by the packer from the largest coordinate in each mode.
+  vector<string> toks = util::split(line, " ");
+  size_t order = toks.size()-1;
+  taco_uassert((size_t)format.getOrder() == order)
+      << "The format order does not match the order of the tensor in the file";
+  StreamPacker packer(std::vector<int>(order, 0), format, chunkSize);
+  std::vector<int> coordinate(order);
+
+  do {
+    char* linePtr = (char*)line.data();
+    for (size_t i = 0; i < order; i++) {
+      long idx = strtol(linePtr, &linePtr, 10);
+      taco_uassert(idx <= INT_MAX)<<"Coordinate in file is larger than INT_MAX";
+      coordinate[i] = (int)idx - 1;
     }
-    stream << static_cast<int>(value.second) << endl;
-  }
+    double val = strtod(linePtr, &linePtr);
+    packer.insert(coordinate.data(), val);
+  } while (std::getline(stream, line));
+
+  return packer.finalize();
 }
 
+void writeTNS(std::string filename, const TensorBase& tensor) {
+  std::fstream file;
+  util::openStream(file, filename, fstream::out);
+  writeTNS(file, tensor);
+  file.close();
+}
 
 void writeTNS(std::ostream& stream, const TensorBase& tensor) {
-  switch(tensor.getComponentType().getKind()) {
-    case Datatype::Bool: writeTypedTNS<bool>(stream, tensor); break;
-    case Datatype::UInt8: writeCharTNS<uint8_t>(stream, tensor); break;
-    case Datatype::UInt16: writeTypedTNS<uint16_t>(stream, tensor); break;
-    case Datatype::UInt32: writeTypedTNS<uint32_t>(stream, tensor); break;
-    case Datatype::UInt64: writeTypedTNS<uint64_t>(stream, tensor); break;
-    case Datatype::UInt128: writeTypedTNS<unsigned long long>(stream, tensor); break;
-    case Datatype::Int8: writeCharTNS<int8_t>(stream, tensor); break;
-    case Datatype::Int16: writeTypedTNS<int16_t>(stream, tensor); break;
-    case Datatype::Int32: writeTypedTNS<int32_t>(stream, tensor); break;
-    case Datatype::Int64: writeTypedTNS<int64_t>(stream, tensor); break;
-    case Datatype::Int128: writeTypedTNS<long long>(stream, tensor); break;
-    case Datatype::Float32: writeTypedTNS<float>(stream, tensor); break;
-    case Datatype::Float64: writeTypedTNS<double>(stream, tensor); break;
-    case Datatype::Complex64: writeTypedTNS<std::complex<float>>(stream, tensor); break;
-    case Datatype::Complex128: writeTypedTNS<std::complex<double>>(stream, tensor); break;
-    case Datatype::Undefined: taco_ierror; break;
-    default:
-      taco_unreachable;
-  }
+  writeComponents(stream, tensor, true);
 }
 
 }
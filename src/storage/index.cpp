@@ -57,8 +57,16 @@ size_t Index::getSize() const {
     auto modeIndex = getModeIndex(i);
     if (modeType.getName() == Dense.getName()) {
       size *= modeIndex.getIndexArray(0).get(0).getAsIndex();
-    } else if (modeType.getName() == Sparse.getName()) {
+    } else if (modeType.getName() == Sparse.getName() ||
+               modeType.getName() == Packed.getName()) {
       size = modeIndex.getIndexArray(0).get(size).getAsIndex();
+    } else if (modeType.getName() == Sliced.getName()) {
+      // The last entry of the range array is the number of positions
+      size = modeIndex.getIndexArray(0).get(2 * size).getAsIndex();
+    } else if (modeType.getName() == Hashed.getName() ||
+               modeType.getName() == Bitmap.getName()) {
+      // Every fiber has as many slots as the capacity (width of bitmaps)
+      size *= modeIndex.getIndexArray(0).get(0).getAsIndex();
     } else {
       taco_not_supported_yet;
     }
@@ -1,7 +1,14 @@
 #include "taco/storage/pack.h"
 
 #include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <queue>
 
+#include "taco/tensor.h"
 #include "taco/format.h"
 #include "taco/error.h"
 #include "taco/ir/ir.h"
@@ -10,6 +17,8 @@
 #include "taco/storage/index.h"
 #include "taco/storage/array.h"
 #include "taco/util/collections.h"
+#include "taco/util/env.h"
+#include "taco/util/uncopyable.h"
 
 using namespace std;
 
@@ -195,4 +204,494 @@ TensorStorage pack(Datatype                             componentType,
   return storage;
 }
 
+
+// class StreamPacker
+
+/// A growable array of index or value data. Unlike std::vector, the memory can
+/// be handed to an Array without copying it.
+template <typename T>
+class GrowableArray : util::Uncopyable {
+public:
+  GrowableArray() : data(nullptr), size(0), capacity(0) {}
+  ~GrowableArray() {
+    free(data);
+  }
+
+  void push_back(T value) {
+    if (size == capacity) {
+      capacity = std::max((size_t)1024, 2 * capacity);
+      data = (T*)realloc(data, capacity * sizeof(T));
+      taco_uassert(data != nullptr) << "Out of memory while packing";
+    }
+    data[size++] = value;
+  }
+
+  void clear() {
+    size = 0;
+  }
+
+  /// Release the data to an array that frees it.
+  Array release() {
+    T* released = (T*)realloc(data, std::max(size, (size_t)1) * sizeof(T));
+    Array array(type<T>(), released, size, Array::Free);
+    data = nullptr;
+    size = 0;
+    capacity = 0;
+    return array;
+  }
+
+  T*     data;
+  size_t size;
+  size_t capacity;
+};
+
+/// Packs components that are sorted lexicographically in storage order into
+/// the index and value arrays of a dense/compressed format.
+struct SortedPacker {
+  SortedPacker(const std::vector<bool>& dense,
+               const std::vector<size_t>& dimensions)
+      : dense(dense), dimensions(dimensions), order(dense.size()),
+        pos(order), crd(order), currPos(order), prev(order), empty(true) {
+  }
+
+  /// Returns true if the coordinate sorts strictly after the last one packed.
+  bool isAfterLast(const int* coord) const {
+    return empty || std::lexicographical_compare(prev.begin(), prev.end(),
+                                                 coord, coord + order);
+  }
+
+  void insert(const int* coord, double value) {
+    size_t level = 0;
+    if (!empty) {
+      while (level < order && coord[level] == prev[level]) {
+        level++;
+      }
+      if (level == order) {
+        vals.data[currPos[order-1]] += value;
+        return;
+      }
+      taco_iassert(coord[level] > prev[level]) << "Components are not sorted";
+    }
+
+    size_t p = (level == 0) ? 0 : currPos[level-1];
+    for (size_t k = level; k < order; k++) {
+      if (dense[k]) {
+        p = p * dimensions[k] + coord[k];
+      } else {
+        // Start the segments of all parent positions up to p
+        while (pos[k].size <= p) {
+          pos[k].push_back((int)crd[k].size);
+        }
+        crd[k].push_back(coord[k]);
+        p = crd[k].size - 1;
+      }
+      currPos[k] = p;
+    }
+    taco_uassert(p < (size_t)INT_MAX) << "Tensor has more than INT_MAX values";
+
+    if (dense[order-1]) {
+      while (vals.size < p) {
+        vals.push_back(0.0);
+      }
+    }
+    vals.push_back(value);
+    std::copy(coord, coord + order, prev.begin());
+    empty = false;
+  }
+
+  /// Call f(coord, value) for every packed component in storage order. Zeros
+  /// stored in a dense bottom level are skipped.
+  template <typename F>
+  void forEach(F f) const {
+    std::vector<int> coord(order);
+    forEach(0, 0, coord, f);
+  }
+
+  template <typename F>
+  void forEach(size_t k, size_t parentPos, std::vector<int>& coord, F f) const {
+    size_t begin, end;
+    if (dense[k]) {
+      size_t dimension = (k == 0 && dimensions[0] == 0)
+                         ? (empty ? 0 : prev[0] + 1) : dimensions[k];
+      begin = parentPos * dimension;
+      end = begin + dimension;
+    } else {
+      begin = (parentPos < pos[k].size) ? pos[k].data[parentPos] : crd[k].size;
+      end = (parentPos + 1 < pos[k].size) ? pos[k].data[parentPos + 1]
+                                          : crd[k].size;
+    }
+    for (size_t p = begin; p < end; p++) {
+      coord[k] = dense[k] ? (int)(p - begin) : crd[k].data[p];
+      if (k + 1 < order) {
+        forEach(k + 1, p, coord, f);
+      } else if (p < vals.size && (!dense[k] || vals.data[p] != 0.0)) {
+        f(coord.data(), vals.data[p]);
+      }
+    }
+  }
+
+  /// Complete the index and value arrays and return them as mode indices.
+  std::vector<ModeIndex> finalize(Array* values) {
+    std::vector<ModeIndex> modeIndices;
+    size_t size = 1;
+    for (size_t k = 0; k < order; k++) {
+      if (dense[k]) {
+        size *= dimensions[k];
+        modeIndices.push_back(ModeIndex({makeArray({(int)dimensions[k]})}));
+      } else {
+        while (pos[k].size <= size) {
+          pos[k].push_back((int)crd[k].size);
+        }
+        size = crd[k].size;
+        modeIndices.push_back(ModeIndex({pos[k].release(), crd[k].release()}));
+      }
+    }
+    taco_uassert(size <= (size_t)INT_MAX) << "Tensor has more than INT_MAX values";
+    while (vals.size < size) {
+      vals.push_back(0.0);
+    }
+    *values = vals.release();
+    return modeIndices;
+  }
+
+  const std::vector<bool>   dense;
+  std::vector<size_t>       dimensions;
+  const size_t              order;
+
+  std::vector<GrowableArray<int>> pos;
+  std::vector<GrowableArray<int>> crd;
+  GrowableArray<double>           vals;
+
+  std::vector<size_t> currPos;
+  std::vector<int>    prev;
+  bool                empty;
+};
+
+/// The most spilled runs that are merged at once, which bounds the number of
+/// open run files and read buffers.
+static const size_t MAX_MERGED_RUNS = 64;
+
+/// A sorted run of components spilled to a file. Each record stores the
+/// coordinate (in storage order) followed by the value.
+struct SpilledRun {
+  SpilledRun(size_t order, std::string path)
+      : order(order), path(path), numRecords(0), next(0), buffered(0) {
+    file = fopen(path.c_str(), "w+b");
+    taco_uassert(file != nullptr) << "Unable to create spill file: " << path;
+  }
+
+  ~SpilledRun() {
+    if (file != nullptr) {
+      fclose(file);
+    }
+    std::remove(path.c_str());
+  }
+
+  size_t recordSize() const {
+    return order * sizeof(int) + sizeof(double);
+  }
+
+  void write(const int* coord, double value) {
+    size_t written = fwrite(coord, sizeof(int), order, file);
+    written += fwrite(&value, sizeof(double), 1, file);
+    taco_uassert(written == order + 1) << "Unable to write spill file: " << path;
+    numRecords++;
+  }
+
+  /// Rewind the run for reading.
+  void startReading(size_t bufferRecords) {
+    taco_uassert(fflush(file) == 0) << "Unable to write spill file: " << path;
+    rewind(file);
+    buffer.resize(bufferRecords * recordSize());
+    next = 0;
+    buffered = 0;
+  }
+
+  /// Advance to the next record, returning false at the end of the run. The
+  /// first call positions the run at its first record.
+  bool advance() {
+    if (buffered > 0) {
+      next++;
+    }
+    if (next >= buffered) {
+      buffered = fread(buffer.data(), recordSize(),
+                       buffer.size() / recordSize(), file);
+      next = 0;
+    }
+    return next < buffered;
+  }
+
+  const int* coord() const {
+    return (const int*)&buffer[next * recordSize()];
+  }
+
+  double value() const {
+    double value;
+    memcpy(&value, &buffer[next * recordSize() + order * sizeof(int)],
+           sizeof(double));
+    return value;
+  }
+
+  const size_t      order;
+  const std::string path;
+  FILE*             file;
+  size_t            numRecords;
+
+  std::vector<char> buffer;
+  size_t            next;
+  size_t            buffered;
+};
+
+struct StreamPacker::Content {
+  Format              format;
+  std::vector<int>    dimensions;
+  std::vector<int>    modeOrdering;
+  std::vector<bool>   dense;
+  size_t              order;
+  size_t              chunkSize;
+
+  // Current chunk of components, with coordinates in storage order.
+  std::vector<int>    chunkCoords;
+  std::vector<double> chunkVals;
+  std::vector<int>    maxCoords;
+
+  std::shared_ptr<SortedPacker>            packer;
+  std::vector<std::shared_ptr<SpilledRun>> runs;
+  size_t                                   numSpilledRuns;
+
+  /// True if the packer can be created before all dimensions are known,
+  /// which is the case if only the outermost level may be dense.
+  bool canPackEagerly() const {
+    for (size_t k = 1; k < order; k++) {
+      if (dense[k] && dimensions[modeOrdering[k]] == 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// Returns the dimension of each level, or zero if it is not yet known.
+  std::vector<size_t> getLevelDimensions(bool allComponentsSeen) const {
+    std::vector<size_t> levelDimensions(order);
+    for (size_t k = 0; k < order; k++) {
+      const int mode = modeOrdering[k];
+      levelDimensions[k] = (dimensions[mode] > 0) ? dimensions[mode] :
+                           (allComponentsSeen ? maxCoords[mode] + 1 : 0);
+    }
+    return levelDimensions;
+  }
+
+  std::shared_ptr<SortedPacker> makePacker(bool allComponentsSeen) const {
+    return std::make_shared<SortedPacker>(dense,
+                                          getLevelDimensions(allComponentsSeen));
+  }
+
+  std::shared_ptr<SpilledRun> makeRun() const {
+    static std::atomic<size_t> numRuns(0);
+    std::string path = util::getTmpdir() + "stream_run_" +
+                       std::to_string(numRuns++);
+    return std::make_shared<SpilledRun>(order, path);
+  }
+
+  void flushChunk(bool isLast) {
+    const size_t numComponents = chunkVals.size();
+    if (numComponents == 0) {
+      return;
+    }
+
+    // Sort the chunk through a permutation to avoid moving components
+    std::vector<size_t> perm(numComponents);
+    for (size_t i = 0; i < numComponents; i++) {
+      perm[i] = i;
+    }
+    const int* coords = chunkCoords.data();
+    const size_t n = order;
+    auto lessThan = [coords, n](size_t a, size_t b) {
+      return std::lexicographical_compare(&coords[a*n], &coords[a*n] + n,
+                                          &coords[b*n], &coords[b*n] + n);
+    };
+    if (!std::is_sorted(perm.begin(), perm.end(), lessThan)) {
+      std::sort(perm.begin(), perm.end(), lessThan);
+    }
+
+    const int* first = &coords[perm[0]*n];
+    if (runs.empty() && !packer && (isLast || canPackEagerly())) {
+      packer = makePacker(isLast);
+    }
+    if (runs.empty() && packer && packer->isAfterLast(first)) {
+      for (size_t i : perm) {
+        packer->insert(&coords[i*n], chunkVals[i]);
+      }
+    } else {
+      // The chunk overlaps components that were already packed, so switch to
+      // an external sort by spilling the packed components as the first run.
+      if (packer) {
+        auto run = makeRun();
+        packer->forEach([&run](const int* coord, double value) {
+          run->write(coord, value);
+        });
+        runs.push_back(run);
+        packer = nullptr;
+      }
+      auto run = makeRun();
+      for (size_t i : perm) {
+        run->write(&coords[i*n], chunkVals[i]);
+      }
+      runs.push_back(run);
+      numSpilledRuns = runs.size();
+    }
+
+    chunkCoords.clear();
+    chunkVals.clear();
+  }
+
+  /// Merge the runs in order, passing every record to `emit`. The runs share
+  /// read buffers of about a chunk of records.
+  template <typename Emit>
+  void merge(const std::vector<std::shared_ptr<SpilledRun>>& runs,
+             Emit emit) const {
+    const size_t bufferRecords = std::max((size_t)1024, chunkSize /
+                                          std::max(runs.size(), (size_t)1));
+    for (auto& run : runs) {
+      run->startReading(bufferRecords);
+    }
+
+    const size_t n = order;
+    auto greaterThan = [n](const SpilledRun* a, const SpilledRun* b) {
+      return std::lexicographical_compare(b->coord(), b->coord() + n,
+                                          a->coord(), a->coord() + n);
+    };
+    std::priority_queue<SpilledRun*, std::vector<SpilledRun*>,
+                        decltype(greaterThan)> heap(greaterThan);
+    for (auto& run : runs) {
+      if (run->advance()) {
+        heap.push(run.get());
+      }
+    }
+    while (!heap.empty()) {
+      SpilledRun* run = heap.top();
+      heap.pop();
+      emit(run->coord(), run->value());
+      if (run->advance()) {
+        heap.push(run);
+      }
+    }
+  }
+
+  /// Merge the spilled runs into a new packer. At most MAX_MERGED_RUNS runs
+  /// are merged at once, so while there are more runs, groups of them are
+  /// merged into longer runs first.
+  void mergeRuns() {
+    while (runs.size() > MAX_MERGED_RUNS) {
+      std::vector<std::shared_ptr<SpilledRun>> merged;
+      for (size_t begin = 0; begin < runs.size(); begin += MAX_MERGED_RUNS) {
+        const size_t end = std::min(runs.size(), begin + MAX_MERGED_RUNS);
+        std::vector<std::shared_ptr<SpilledRun>> group(runs.begin() + begin,
+                                                       runs.begin() + end);
+        auto run = makeRun();
+        merge(group, [&run](const int* coord, double value) {
+          run->write(coord, value);
+        });
+        merged.push_back(run);
+      }
+      runs = merged;
+    }
+
+    packer = makePacker(true);
+    merge(runs, [this](const int* coord, double value) {
+      packer->insert(coord, value);
+    });
+    runs.clear();
+  }
+};
+
+StreamPacker::StreamPacker(const std::vector<int>& dimensions,
+                           const Format& format, size_t chunkSize)
+    : content(new Content) {
+  taco_uassert(supports(format))
+      << "Stream packing only supports dense and compressed modes with Int32 "
+      << "index arrays";
+  taco_uassert(dimensions.size() == (size_t)format.getOrder() &&
+               !dimensions.empty())
+      << "The number of dimensions must match the format order";
+  taco_uassert(chunkSize > 0) << "The chunk size must be positive";
+
+  content->format = format;
+  content->dimensions = dimensions;
+  content->modeOrdering = format.getModeOrdering();
+  content->order = dimensions.size();
+  content->chunkSize = chunkSize;
+  content->maxCoords = std::vector<int>(content->order, -1);
+  content->numSpilledRuns = 0;
+  for (auto& modeFormat : format.getModeFormats()) {
+    content->dense.push_back(modeFormat.getName() == Dense.getName());
+  }
+  content->chunkCoords.reserve(std::min(chunkSize, (size_t)1 << 20) *
+                               content->order);
+}
+
+bool StreamPacker::supports(const Format& format) {
+  for (auto& modeFormat : format.getModeFormats()) {
+    if (modeFormat.getName() != Dense.getName() &&
+        modeFormat.getName() != Sparse.getName()) {
+      return false;
+    }
+  }
+  for (auto& arrayTypes : format.getLevelArrayTypes()) {
+    for (auto& arrayType : arrayTypes) {
+      if (arrayType != Int32) {
+        return false;
+      }
+    }
+  }
+  return format.getOrder() > 0;
+}
+
+void StreamPacker::insert(const int* coordinate, double value) {
+  for (size_t k = 0; k < content->order; k++) {
+    const int mode = content->modeOrdering[k];
+    const int coord = coordinate[mode];
+    taco_uassert(coord >= 0 && (content->dimensions[mode] == 0 ||
+                                coord < content->dimensions[mode]))
+        << "Coordinate " << coord << " is out of bounds in mode " << mode;
+    content->maxCoords[mode] = std::max(content->maxCoords[mode], coord);
+    content->chunkCoords.push_back(coord);
+  }
+  content->chunkVals.push_back(value);
+  if (content->chunkVals.size() >= content->chunkSize) {
+    content->flushChunk(false);
+  }
+}
+
+TensorBase StreamPacker::finalize() {
+  content->flushChunk(true);
+  if (!content->runs.empty()) {
+    content->mergeRuns();
+  } else if (!content->packer) {
+    content->packer = content->makePacker(true);
+  }
+
+  // Dimensions that were inferred while packing eagerly are only known now
+  content->packer->dimensions = content->getLevelDimensions(true);
+  std::vector<int> dimensions(content->order);
+  for (size_t k = 0; k < content->order; k++) {
+    const int mode = content->modeOrdering[k];
+    dimensions[mode] = (int)content->packer->dimensions[k];
+  }
+
+  TensorBase tensor(type<double>(), dimensions, content->format);
+  TensorStorage storage = tensor.getStorage();
+  Array values;
+  storage.setIndex(Index(tensor.getFormat(),
+                         content->packer->finalize(&values)));
+  storage.setValues(values);
+  tensor.setStorage(storage);
+  content->packer = nullptr;
+  return tensor;
+}
+
+size_t StreamPacker::getNumSpilledRuns() const {
+  return content->numSpilledRuns;
+}
+
 }
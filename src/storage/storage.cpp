@@ -7,6 +7,7 @@
 #include "taco/type.h"
 #include "taco/format.h"
 #include "taco/error.h"
+#include "taco/cuda.h"
 #include "taco/storage/index.h"
 #include "taco/storage/array.h"
 #include "taco/util/strings.h"
@@ -29,6 +30,9 @@ struct TensorStorage::Content {
 
   Literal       fillValue;
 
+  shared_ptr<Allocator> allocator;
+  taco_allocator_t      allocatorData;
+
   Content(Datatype componentType, vector<int> dimensions, Format format, Literal fill)
       : componentType(componentType), dimensions(dimensions), format(format),
         index(format) {
@@ -52,6 +56,11 @@ struct TensorStorage::Content {
         modeTypes[i] = taco_mode_sparse;
       } else if (modeType.getName() == Singleton.getName()) {
         modeTypes[i] = taco_mode_sparse;
+      } else if (modeType.getName() == Packed.getName() ||
+                 modeType.getName() == Sliced.getName() ||
+                 modeType.getName() == Hashed.getName() ||
+                 modeType.getName() == Bitmap.getName()) {
+        modeTypes[i] = taco_mode_sparse;
       } else {
         taco_not_supported_yet;
       }
@@ -144,8 +153,12 @@ TensorStorage::operator struct taco_tensor_t*() const {
       const Array& size = modeIndex.getIndexArray(0);
       tensorData->indices[i][0] = (uint8_t*)size.getData();
     }
-    // Sparse levels have two indices (pos and idx)
-    else if (modeType.getName() == Sparse.getName()) {
+    // Sparse, packed, sliced, hashed and bitmap levels have two indices
+    else if (modeType.getName() == Sparse.getName() ||
+             modeType.getName() == Packed.getName() ||
+             modeType.getName() == Sliced.getName() ||
+             modeType.getName() == Hashed.getName() ||
+             modeType.getName() == Bitmap.getName()) {
       // TODO Uncomment assert and remove conditional
       // taco_iassert(modeIndex.numIndexArrays() == 2)
       //     << modeIndex.numIndexArrays();
@@ -184,6 +197,58 @@ void TensorStorage::setValues(const Array& values) {
   content->values = values;
 }
 
+static void* allocateWith(void* context, size_t size, int clear) {
+  return ((Allocator*)context)->allocate(size, clear != 0);
+}
+
+static void* reallocateWith(void* context, void* ptr, size_t oldSize,
+                            size_t size) {
+  return ((Allocator*)context)->reallocate(ptr, oldSize, size);
+}
+
+void TensorStorage::setAllocator(shared_ptr<Allocator> allocator) {
+  taco_uassert(allocator == nullptr || !should_use_CUDA_codegen())
+      << "Allocators are not supported by the CUDA backend";
+  content->allocator = allocator;
+  if (allocator == nullptr) {
+    content->tensorData->allocator = NULL;
+    return;
+  }
+  content->allocatorData.allocate = allocateWith;
+  content->allocatorData.reallocate = reallocateWith;
+  content->allocatorData.context = allocator.get();
+  content->tensorData->allocator = &content->allocatorData;
+}
+
+shared_ptr<Allocator> TensorStorage::getAllocator() const {
+  return content->allocator;
+}
+
+Array TensorStorage::adoptArray(Datatype type, void* data, size_t size,
+                                Array::Policy policy) const {
+  // Kernels that do not reallocate an array leave the old one in place
+  vector<Array> arrays = {getValues()};
+  const Index& index = getIndex();
+  for (int i = 0; i < index.numModeIndices(); i++) {
+    const ModeIndex& modeIndex = index.getModeIndex(i);
+    for (int j = 0; j < modeIndex.numIndexArrays(); j++) {
+      arrays.push_back(modeIndex.getIndexArray(j));
+    }
+  }
+  for (const Array& array : arrays) {
+    if (data != nullptr && array.getData() == data) {
+      return Array(type, data, size, [array](void*) {});
+    }
+  }
+
+  if (content->allocator != nullptr) {
+    shared_ptr<Allocator> allocator = content->allocator;
+    return Array(type, data, size,
+                 [allocator](void* data) { allocator->deallocate(data); });
+  }
+  return Array(type, data, size, policy);
+}
+
 bool equals(TensorStorage a, TensorStorage b) {
   return false;
 }
@@ -21,10 +21,15 @@
 //#include "codegen/codegen_cuda.h"
 //#include "taco/taco_tensor_t.h"
 #include "taco/index_notation/index_notation_visitor.h"
+#include "taco/index_notation/index_notation_rewriter.h"
 #include "taco/index_notation/transformations.h"
 #include "taco/ir/ir.h"
 #include "taco/ir/ir_printer.h"
 #include "taco/lower/lower.h"
+#include "taco/lower/mode_format_packed.h"
+#include "taco/lower/mode_format_sliced.h"
+#include "taco/lower/mode_format_hashed.h"
+#include "taco/lower/mode_format_bitmap.h"
 #include "taco/storage/storage.h"
 #include "taco/storage/index.h"
 #include "taco/storage/array.h"
@@ -84,6 +89,21 @@ TensorBase::TensorBase(std::string name, Datatype ctype, std::vector<int> dimens
     : TensorBase(name, ctype, dimensions, ModeFormat::compressed, fill) {
 }
 
+/// Returns true if tensors with modes of the format are packed as compressed
+/// modes that are converted when the tensor data is unpacked.
+static bool isPackedAsCompressed(const ModeFormat& modeFormat) {
+  return modeFormat.getName() == Packed.getName() ||
+         modeFormat.getName() == Sliced.getName() ||
+         modeFormat.getName() == Hashed.getName() ||
+         modeFormat.getName() == Bitmap.getName();
+}
+
+/// Returns true if results can have modes of the format, which requires insert
+/// or append capabilities.
+static bool canBeAssembled(const ModeFormat& modeFormat) {
+  return modeFormat.hasInsert() || modeFormat.hasAppend();
+}
+
 static Format initFormat(Format format) {
   // Initialize coordinate types for Format if not already set
   if (format.getLevelArrayTypes().size() < (size_t)format.getOrder()) {
@@ -99,6 +119,15 @@ static Format initFormat(Format format) {
       } else if (modeType.getName() == Singleton.getName()) {
         arrayTypes.push_back(Int32);
         arrayTypes.push_back(Int32);
+      } else if (modeType.getName() == Packed.getName() ||
+                 modeType.getName() == Sliced.getName() ||
+                 modeType.getName() == Hashed.getName()) {
+        arrayTypes.push_back(Int32);
+        arrayTypes.push_back(Int32);
+      } else if (modeType.getName() == Bitmap.getName()) {
+        // The bits are stored in 64-bit words
+        arrayTypes.push_back(Int32);
+        arrayTypes.push_back(UInt64);
       } else {
         taco_not_supported_yet;
       }
@@ -106,6 +135,34 @@ static Format initFormat(Format format) {
     }
     format.setLevelArrayTypes(levelArrayTypes);
   }
+  for (int i = 0; i < format.getOrder(); ++i) {
+    if (format.getModeFormats()[i].getName() == Packed.getName()) {
+      taco_uassert(format.getCoordinateTypePos(i) == Int32 &&
+                   format.getCoordinateTypeIdx(i) == Int32)
+          << "Packed modes only support Int32 index arrays";
+    }
+    if (format.getModeFormats()[i].getName() == Sliced.getName()) {
+      taco_uassert(format.getCoordinateTypePos(i) == Int32 &&
+                   format.getCoordinateTypeIdx(i) == Int32)
+          << "Sliced modes only support Int32 index arrays";
+      taco_uassert(i == format.getOrder() - 1)
+          << "Sliced modes must be the last level of a format";
+    }
+    if (format.getModeFormats()[i].getName() == Hashed.getName()) {
+      taco_uassert(format.getCoordinateTypePos(i) == Int32 &&
+                   format.getCoordinateTypeIdx(i) == Int32)
+          << "Hashed modes only support Int32 index arrays";
+      taco_uassert(i == format.getOrder() - 1)
+          << "Hashed modes must be the last level of a format";
+    }
+    if (format.getModeFormats()[i].getName() == Bitmap.getName()) {
+      taco_uassert(format.getCoordinateTypePos(i) == Int32 &&
+                   format.getCoordinateTypeIdx(i) == UInt64)
+          << "Bitmap modes only support an Int32 width and UInt64 bits";
+      taco_uassert(i == format.getOrder() - 1)
+          << "Bitmap modes must be the last level of a format";
+    }
+  }
   return format;
 }
 
@@ -133,6 +190,13 @@ TensorBase::TensorBase(string name, Datatype ctype, vector<int> dimensions,
       const size_t idx = format.getModeOrdering()[i];
       modeIndices[i] = ModeIndex({makeArray({content->dimensions[idx]})});
     }
+    // Kernels read the number of slots of hashed levels from the storage
+    else if (format.getModeFormats()[i].getName() == Hashed.getName()) {
+      auto hashed = std::static_pointer_cast<const HashedModeFormat>(
+          format.getModeFormats()[i].getImpl());
+      modeIndices[i] = ModeIndex({makeArray({hashed->getCapacity(), 0}),
+                                  makeArray(type<int>(), 0)});
+    }
   }
   content->storage.setIndex(Index(format, modeIndices));
 
@@ -197,6 +261,22 @@ TensorStorage& TensorBase::getStorage() {
   return content->storage;
 }
 
+void TensorBase::setAllocator(std::shared_ptr<Allocator> allocator) {
+  content->storage.setAllocator(allocator);
+}
+
+std::shared_ptr<Allocator> TensorBase::getAllocator() const {
+  return content->storage.getAllocator();
+}
+
+void TensorBase::setAutoscheduler(std::shared_ptr<Autoscheduler> autoscheduler) {
+  content->autoscheduler = autoscheduler;
+}
+
+std::shared_ptr<Autoscheduler> TensorBase::getAutoscheduler() const {
+  return content->autoscheduler;
+}
+
 void TensorBase::setAllocSize(size_t allocSize) {
   content->allocSize = allocSize;
 }
@@ -249,7 +329,7 @@ void TensorBase::setAssembleWhileCompute(bool assembleWhileCompute) {
   content->assembleWhileCompute = assembleWhileCompute;
 }
 
-static size_t numIntegersToCompare = 0;
+static thread_local size_t numIntegersToCompare = 0;
 static int lexicographicalCmp(const void* a, const void* b) {
   for (size_t i = 0; i < numIntegersToCompare; i++) {
     int diff = ((int*)a)[i] - ((int*)b)[i];
@@ -260,13 +340,23 @@ static int lexicographicalCmp(const void* a, const void* b) {
   return 0;
 }
 
+/// Unpacks the tensor data that a kernel emitted into the storage of the
+/// tensor.  If the kernel is a pack kernel (`fromPack`), then levels that are
+/// packed as compressed levels are in the compressed layout.  If the kernel
+/// ran out of slots in the tables of a hashed level, then `overflowed` is set
+/// and the kernel must be run again with the tables that the level now sizes.
 static size_t unpackTensorData(const taco_tensor_t& tensorData,
-                               const TensorBase& tensor) {
+                               const TensorBase& tensor,
+                               bool fromPack = false,
+                               bool* overflowed = nullptr) {
   auto storage = tensor.getStorage();
   auto format = storage.getFormat();
 
   vector<ModeIndex> modeIndices;
   size_t numVals = 1;
+  // Sliced, hashed and bitmap levels lay out the values too
+  Array slicedVals;
+  bool hasSlicedVals = false;
   for (int i = 0; i < tensor.getOrder(); i++) {
     ModeFormat modeType = format.getModeFormats()[i];
     if (modeType.getName() == Dense.getName()) {
@@ -274,29 +364,156 @@ static size_t unpackTensorData(const taco_tensor_t& tensorData,
       modeIndices.push_back(ModeIndex({size}));
       numVals *= ((int*)tensorData.indices[i][0])[0];
     } else if (modeType.getName() == Sparse.getName()) {
-      auto size = ((int*)tensorData.indices[i][0])[numVals];
-      Array pos = Array(type<int>(), tensorData.indices[i][0], numVals+1, Array::UserOwns);
-      Array idx = Array(type<int>(), tensorData.indices[i][1], size, Array::UserOwns);
+      Array pos = storage.adoptArray(format.getCoordinateTypePos(i),
+                                     tensorData.indices[i][0], numVals+1,
+                                     Array::UserOwns);
+      auto size = pos.get(numVals).getAsIndex();
+      Array idx = storage.adoptArray(format.getCoordinateTypeIdx(i),
+                                     tensorData.indices[i][1], size,
+                                     Array::UserOwns);
       modeIndices.push_back(ModeIndex({pos, idx}));
       numVals = size;
     } else if (modeType.getName() == Singleton.getName()) {
-      Array idx = Array(type<int>(), tensorData.indices[i][1], numVals, Array::UserOwns);
-      modeIndices.push_back(ModeIndex({makeArray(type<int>(), 0), idx}));
+      Array idx = storage.adoptArray(format.getCoordinateTypeIdx(i),
+                                     tensorData.indices[i][1], numVals,
+                                     Array::UserOwns);
+      modeIndices.push_back(ModeIndex({makeArray(format.getCoordinateTypePos(i), 0),
+                                       idx}));
+    } else if (modeType.getName() == Packed.getName()) {
+      // The pack kernel emits a plain coordinate array, which is bit-packed
+      // here and then released
+      auto size = ((int*)tensorData.indices[i][0])[numVals];
+      Array pos = storage.adoptArray(type<int>(), tensorData.indices[i][0],
+                                     numVals+1, Array::UserOwns);
+      Array idx = storage.adoptArray(type<int>(), tensorData.indices[i][1],
+                                     size, Array::Free);
+      Array packedIdx = PackedModeFormat::packCoordinates((int*)idx.getData(), size);
+      modeIndices.push_back(ModeIndex({pos, packedIdx}));
+      numVals = size;
+    } else if (modeType.getName() == Sliced.getName()) {
+      // The pack kernel emits a compressed level, which is sliced together
+      // with the values here and then released
+      auto size = ((int*)tensorData.indices[i][0])[numVals];
+      Array pos = storage.adoptArray(type<int>(), tensorData.indices[i][0],
+                                     numVals+1, Array::Free);
+      Array idx = storage.adoptArray(type<int>(), tensorData.indices[i][1],
+                                     size, Array::Free);
+      Array vals = storage.adoptArray(tensor.getComponentType(),
+                                      tensorData.vals, size, Array::Free);
+      auto sliced = std::static_pointer_cast<const SlicedModeFormat>(
+          modeType.getImpl());
+      Array slicedPos, slicedIdx;
+      sliced->slice((int*)pos.getData(), (int*)idx.getData(), vals, numVals,
+                    &slicedPos, &slicedIdx, &slicedVals);
+      hasSlicedVals = true;
+      modeIndices.push_back(ModeIndex({slicedPos, slicedIdx}));
+      numVals = slicedIdx.getSize();
+    } else if (modeType.getName() == Hashed.getName()) {
+      auto hashed = std::static_pointer_cast<const HashedModeFormat>(
+          modeType.getImpl());
+      int capacity;
+      if (fromPack) {
+        // The pack kernel emits a compressed level, which is hashed together
+        // with the values here and then released
+        auto size = ((int*)tensorData.indices[i][0])[numVals];
+        Array pos = storage.adoptArray(type<int>(), tensorData.indices[i][0],
+                                       numVals+1, Array::Free);
+        Array idx = storage.adoptArray(type<int>(), tensorData.indices[i][1],
+                                       size, Array::Free);
+        Array vals = storage.adoptArray(tensor.getComponentType(),
+                                        tensorData.vals, size, Array::Free);
+        Array table;
+        capacity = hashed->hash((int*)pos.getData(), (int*)idx.getData(), vals,
+                                numVals, &table, &slicedVals);
+        hasSlicedVals = true;
+        modeIndices.push_back(ModeIndex({makeArray({capacity, 0}), table}));
+      } else {
+        const int* capacityData = (const int*)tensorData.indices[i][0];
+        capacity = capacityData[0];
+        Array table = storage.adoptArray(type<int>(), tensorData.indices[i][1],
+                                         numVals * capacity, Array::UserOwns);
+        // A table without an empty slot cannot be probed for coordinates that
+        // it does not hold, so full tables are grown like overflowed ones
+        int nextCapacity = capacity;
+        if (capacityData[1] != 0 ||
+            HashedModeFormat::hasFullFiber((const int*)table.getData(),
+                                           numVals, capacity)) {
+          taco_iassert(overflowed != nullptr);
+          taco_uassert(numVals * capacity <= (size_t)INT_MAX / 2)
+              << "Too many slots to grow the hashed level of "
+              << tensor.getName();
+          nextCapacity = 2 * capacity;
+          *overflowed = true;
+        }
+        modeIndices.push_back(ModeIndex({makeArray({nextCapacity, 0}),
+                                         table}));
+      }
+      numVals *= capacity;
+    } else if (modeType.getName() == Bitmap.getName()) {
+      const int bitmapWidth = BitmapModeFormat::getWidth(
+          tensor.getDimension(format.getModeOrdering()[i]));
+      Array width = makeArray({bitmapWidth});
+      if (fromPack) {
+        // The pack kernel emits a compressed level, which is converted to
+        // bits together with the values here and then released
+        auto size = ((int*)tensorData.indices[i][0])[numVals];
+        Array pos = storage.adoptArray(type<int>(), tensorData.indices[i][0],
+                                       numVals+1, Array::Free);
+        Array idx = storage.adoptArray(type<int>(), tensorData.indices[i][1],
+                                       size, Array::Free);
+        Array vals = storage.adoptArray(tensor.getComponentType(),
+                                        tensorData.vals, size, Array::Free);
+        Array bits;
+        BitmapModeFormat::mark((int*)pos.getData(), (int*)idx.getData(), vals,
+                               numVals, bitmapWidth, &bits, &slicedVals);
+        hasSlicedVals = true;
+        modeIndices.push_back(ModeIndex({width, bits}));
+      } else {
+        Array bits = storage.adoptArray(UInt64, tensorData.indices[i][1],
+                                        numVals * bitmapWidth / 64,
+                                        Array::UserOwns);
+        modeIndices.push_back(ModeIndex({width, bits}));
+      }
+      numVals *= bitmapWidth;
     } else {
       taco_not_supported_yet;
     }
   }
   storage.setIndex(Index(format, modeIndices));
-  storage.setValues(Array(tensor.getComponentType(), tensorData.vals, numVals));
+  if (hasSlicedVals) {
+    storage.setValues(slicedVals);
+  } else {
+    storage.setValues(storage.adoptArray(tensor.getComponentType(),
+                                         tensorData.vals, numVals, Array::Free));
+  }
   return numVals;
 }
 
+/// Returns the type of the position array of the coordinate buffers that are
+/// packed into tensors of the given format. Formats with 64-bit index arrays
+/// use 64-bit buffer positions, so that more than INT_MAX components can be
+/// packed into them.
+static Datatype getBufferPosType(const Format& format) {
+  return (format.getIndexType().getNumBits() == 64) ? Int64 : Int32;
+}
+
+static Array makeBufferPos(const Format& format, size_t numCoordinates) {
+  if (getBufferPosType(format) == Int64) {
+    return makeArray(std::vector<int64_t>({0, (int64_t)numCoordinates}));
+  }
+  taco_uassert(numCoordinates <= (size_t)INT_MAX)
+      << "Tensors with more than INT_MAX components need Int64 index arrays";
+  return makeArray(std::vector<int>({0, (int)numCoordinates}));
+}
+
 /// Pack coordinates into a data structure given by the tensor format.
 void TensorBase::pack() {
   if (!needsPack()) {
     return;
   }
   setNeedsPack(false);
+  content->assembledModule = nullptr;
+  content->assembledIndices.clear();
 
   if (neverPacked()) {
     unsetNeverPacked();
@@ -377,15 +594,16 @@ void TensorBase::pack() {
     taco_tensor_t* bufferStorage = init_taco_tensor_t(1, csize,
         (int32_t*)bufferDim.data(), (int32_t*)bufferModeOrdering.data(),
         (taco_mode_t*)bufferModeType.data(), fillPtr);
-    std::vector<int> pos = {0, (int)numCoordinates};
-    bufferStorage->indices[0][0] = (uint8_t*)pos.data();
+    Array pos = makeBufferPos(getFormat(), numCoordinates);
+    bufferStorage->indices[0][0] = (uint8_t*)pos.getData();
     bufferStorage->indices[0][1] = (uint8_t*)bufferCoords.data();
 
     bufferStorage->vals = (uint8_t*)content->coordinateBuffer->data();
 
     std::vector<void*> arguments = {content->storage, bufferStorage};
     helperFuncs->callFuncPacked("pack", arguments.data());
-    content->valuesSize = unpackTensorData(*((taco_tensor_t*)arguments[0]), *this);
+    content->valuesSize =
+        unpackTensorData(*((taco_tensor_t*)arguments[0]), *this, true);
 
     deinit_taco_tensor_t(bufferStorage);
     content->coordinateBuffer->clear();
@@ -446,8 +664,8 @@ void TensorBase::pack() {
   taco_tensor_t* bufferStorage = init_taco_tensor_t(order, csize,
       (int32_t*)dimensions.data(), (int32_t*)permutation.data(),
       (taco_mode_t*)bufferModeTypes.data(), fillPtr);
-  std::vector<int> pos = {0, (int)numCoordinates};
-  bufferStorage->indices[0][0] = (uint8_t*)pos.data();
+  Array pos = makeBufferPos(getFormat(), numCoordinates);
+  bufferStorage->indices[0][0] = (uint8_t*)pos.getData();
   for (int i = 0; i < order; ++i) {
     bufferStorage->indices[i][1] = (uint8_t*)coordinates[i].data();
   }
@@ -456,7 +674,8 @@ void TensorBase::pack() {
   // Pack nonzero components into required format
   std::vector<void*> arguments = {content->storage, bufferStorage};
   helperFuncs->callFuncPacked("pack", arguments.data());
-  content->valuesSize = unpackTensorData(*((taco_tensor_t*)arguments[0]), *this);
+  content->valuesSize =
+      unpackTensorData(*((taco_tensor_t*)arguments[0]), *this, true);
 
   free(values);
   deinit_taco_tensor_t(bufferStorage);
@@ -466,13 +685,19 @@ void TensorBase::setStorage(TensorStorage storage) {
   // TODO(pnoyola): figure out all possible interactions between
   // setStorage and automatic compilation machinery.
   content->needsPack = false;
+  content->neverPacked = false;
   content->storage = storage;
+  content->assembledModule = nullptr;
+  content->assembledIndices.clear();
 }
 
 static inline map<TensorVar, TensorBase> getTensors(const IndexExpr& expr);
 
 /// Inherits Access and adds a TensorBase object, so that we can retrieve the
 /// tensors that was used in an expression when we later want to pack arguments.
+static bool isCompiledFor(const TensorBase& tensor,
+                          const Assignment& assignment);
+
 struct AccessTensorNode : public AccessNode {
   AccessTensorNode(TensorBase tensor, const std::vector<IndexVar>& indices)
       :  AccessNode(tensor.getTensorVar(), indices, {}, false), 
@@ -524,9 +749,9 @@ struct AccessTensorNode : public AccessNode {
     Assignment assign = makeReductionNotation(assignment);
 
     tensor.setNeedsPack(false);
-    if (!equals(tensor.getAssignment(), assign)) {
+    if (!isCompiledFor(tensor, assign)) {
       if (tensor.needsCompute()) {
-        auto oldOperands = getTensors(tensor.getAssignment().getRhs());
+        auto oldOperands = getTensors(tensor.getKernelAssignment().getRhs());
         for (auto& operand : oldOperands) {
           operand.second.removeDependentTensor(tensor);
         }
@@ -542,6 +767,7 @@ struct AccessTensorNode : public AccessNode {
     }
 
     tensor.setAssignment(assign);
+    tensor.addKernelDependencies();
   }
 };
 
@@ -602,11 +828,171 @@ void TensorBase::cacheComputeKernel(const IndexStmt stmt,
   computeKernelsMutex.unlock();
 }
 
+static inline map<TensorVar, TensorBase> getTensors(const IndexExpr& expr);
+
+/// Returns true if the access reads every mode of its tensor in full, with a
+/// distinct index variable per mode.
+static bool isPlainAccess(const AccessNode* access) {
+  return access->windowedModes.empty() && access->indexSetModes.empty() &&
+         util::toSet(access->indexVars).size() == access->indexVars.size();
+}
+
+/// Inline the assignments of operands that have not been computed yet into the
+/// expression that reads them, so that their values never have to be stored.
+/// An operand is inlined if its assignment is elementwise (it has no
+/// reductions, so inlining does not repeat any work), it is read once, and its
+/// values equal those of its expression (a zero fill value and no conversion).
+/// The inlined operands are computed later only if they are read themselves.
+static Assignment fuseProducers(const TensorBase& tensor,
+                                Assignment assignment,
+                                vector<TensorBase>* fused) {
+  struct FindProducers : public IndexNotationVisitor {
+    using IndexNotationVisitor::visit;
+    map<TensorBase, vector<const AccessTensorNode*>> accesses;
+    void visit(const AccessNode* node) {
+      if (isa<AccessTensorNode>(node)) {
+        auto access = to<AccessTensorNode>(node);
+        accesses[access->tensor].push_back(access);
+      }
+    }
+  };
+
+  // Renames the index variables of the tensor accesses in a producer's
+  // expression, keeping the tensors that back them
+  struct RenameAccesses : public IndexNotationRewriter {
+    using IndexNotationRewriter::visit;
+    const map<IndexVar,IndexVar>& renaming;
+    bool fusible = true;
+    RenameAccesses(const map<IndexVar,IndexVar>& renaming)
+        : renaming(renaming) {}
+    void visit(const AccessNode* node) {
+      if (!isa<AccessTensorNode>(node) || !node->windowedModes.empty() ||
+          !node->indexSetModes.empty()) {
+        fusible = false;
+        expr = node;
+        return;
+      }
+      vector<IndexVar> indexVars;
+      for (auto& var : node->indexVars) {
+        indexVars.push_back(util::contains(renaming, var) ? renaming.at(var)
+                                                          : var);
+      }
+      expr = new AccessTensorNode(to<AccessTensorNode>(node)->tensor,
+                                  indexVars);
+    }
+    void visit(const IndexVarNode* node) {
+      fusible = false;
+      expr = node;
+    }
+  };
+
+  // Producers may read other producers, so inline until none are left
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    FindProducers findProducers;
+    assignment.getRhs().accept(&findProducers);
+
+    map<IndexExpr,IndexExpr> substitutions;
+    for (auto& producerAccesses : findProducers.accesses) {
+      TensorBase producer = producerAccesses.first;
+      if (producerAccesses.second.size() != 1 || producer == tensor ||
+          producer.needsPack() || !producer.needsCompute()) {
+        continue;
+      }
+      const AccessTensorNode* access = producerAccesses.second[0];
+      Assignment producerAssignment = producer.getAssignment();
+      if (!producerAssignment.defined() ||
+          producerAssignment.getOperator().defined() ||
+          !isPlainAccess(access) ||
+          !isPlainAccess(getNode(producerAssignment.getLhs())) ||
+          util::contains(getTensors(producerAssignment.getRhs()),
+                         tensor.getTensorVar())) {
+        continue;
+      }
+
+      IndexExpr producerExpr = producerAssignment.getRhs();
+      const vector<IndexVar>& producerVars = producerAssignment.getFreeVars();
+      if (util::toSet(getIndexVars(producerExpr)) != util::toSet(producerVars) ||
+          producerExpr.getDataType() != producer.getComponentType() ||
+          !equals(producer.getFillValue(),
+                  Literal::zero(producer.getComponentType()))) {
+        continue;
+      }
+
+      map<IndexVar,IndexVar> renaming;
+      for (size_t i = 0; i < producerVars.size(); i++) {
+        renaming.insert({producerVars[i], access->indexVars[i]});
+      }
+      RenameAccesses renameAccesses(renaming);
+      IndexExpr renamedExpr = renameAccesses.rewrite(producerExpr);
+      if (!renameAccesses.fusible) {
+        continue;
+      }
+      substitutions.insert({IndexExpr(access), renamedExpr});
+      fused->push_back(producer);
+    }
+
+    if (!substitutions.empty()) {
+      assignment = Assignment(assignment.getLhs(),
+                              replace(assignment.getRhs(), substitutions),
+                              assignment.getOperator());
+      changed = true;
+    }
+  }
+  return assignment;
+}
+
+/// Returns true if the kernel compiled for the tensor computes `assignment`.
+/// Kernels into which pending operands were fused only do so if fusing the
+/// assignment again gives the same statement.
+static bool isCompiledFor(const TensorBase& tensor,
+                          const Assignment& assignment) {
+  if (!equals(tensor.getAssignment(), assignment)) {
+    return false;
+  }
+  if (tensor.getKernelAssignment() == tensor.getAssignment()) {
+    return true;
+  }
+  vector<TensorBase> fused;
+  return equals(fuseProducers(tensor, assignment, &fused),
+                tensor.getKernelAssignment());
+}
+
+/// The kernel of a tensor into which operands were fused reads the operands of
+/// the fused assignments, so the tensor must be computed before they change.
+void TensorBase::addKernelDependencies() {
+  if (getKernelAssignment() == getAssignment()) {
+    return;
+  }
+  for (auto& operand : getTensors(getKernelAssignment().getRhs())) {
+    operand.second.addDependentTensor(*this);
+  }
+}
+
 void TensorBase::compile(bool emitHydride) {
   Assignment assignment = getAssignment();
   taco_uassert(assignment.defined())
       << error::compile_without_expr;
 
+  // Fuse the assignments of operands that are still pending into this one,
+  // unless the fused statement cannot be lowered
+  vector<TensorBase> fused;
+  Assignment fusedAssignment = (content->autoscheduler == nullptr)
+                               ? fuseProducers(*this, assignment, &fused)
+                               : assignment;
+  if (!fused.empty()) {
+    IndexStmt fusedStmt =
+        makeConcreteNotation(makeReductionNotation(fusedAssignment));
+    fusedStmt = insertTemporaries(reorderLoopsTopologically(fusedStmt));
+    if (isLowerable(fusedStmt)) {
+      assignment = fusedAssignment;
+    }
+  }
+  content->kernelAssignment =
+      (assignment == getAssignment()) ? Assignment() : assignment;
+  addKernelDependencies();
+
   struct CollisionFinder : public IndexNotationVisitor {
     using IndexNotationVisitor::visit;
 
@@ -637,7 +1023,19 @@ void TensorBase::compile(bool emitHydride) {
   IndexStmt stmt = makeConcreteNotation(makeReductionNotation(assignment));
   stmt = reorderLoopsTopologically(stmt);
   stmt = insertTemporaries(stmt);
-  stmt = parallelizeOuterLoop(stmt);
+  if (content->autoscheduler != nullptr) {
+    // The autoscheduler times the candidates on the computed operands
+    auto operands = getTensors(assignment.getRhs());
+    vector<TensorStorage> arguments;
+    for (auto& argument : getArguments(stmt)) {
+      taco_iassert(util::contains(operands, argument));
+      operands.at(argument).syncValues();
+      arguments.push_back(operands.at(argument).getStorage());
+    }
+    stmt = content->autoscheduler->schedule(*this, stmt, arguments);
+  } else {
+    stmt = parallelizeOuterLoop(stmt);
+  }
   compile(stmt, content->assembleWhileCompute, emitHydride);
 }
 
@@ -647,7 +1045,16 @@ void TensorBase::compile(taco::IndexStmt stmt, bool assembleWhileCompute, bool e
   }
   setNeedsCompile(false);
 
+  for (const auto& modeFormat : getFormat().getModeFormats()) {
+    taco_uassert(canBeAssembled(modeFormat))
+        << modeFormat.getName() << " modes support neither insertion nor "
+        << "appending, so " << getName() << " cannot be the result of a "
+        << "computation";
+  }
+
   IndexStmt concretizedAssign = stmt;
+  // The statement computes a single result, so its reductions can be scalar
+  // promoted (the merged statements of evaluate(vector) cannot be).
   IndexStmt stmtToCompile = stmt.concretize();
   stmtToCompile = scalarPromote(stmtToCompile);
 
@@ -693,10 +1100,12 @@ void TensorBase::syncValues() {
 }
 
 void TensorBase::addDependentTensor(TensorBase& tensor) {
+  lock_guard<std::mutex> lock(content->dependentTensorsMutex);
   content->dependentTensors.push_back(tensor.content);
 }
 
 void TensorBase::removeDependentTensor(TensorBase& tensor) {
+  lock_guard<std::mutex> lock(content->dependentTensorsMutex);
   int size = content->dependentTensors.size();
   if (size == 0) {
     return;
@@ -720,6 +1129,7 @@ void TensorBase::removeDependentTensor(TensorBase& tensor) {
 }
 
 vector<TensorBase> TensorBase::getDependentTensors() {
+  lock_guard<std::mutex> lock(content->dependentTensorsMutex);
   vector<TensorBase> dependents;
   for(std::weak_ptr<Content> dependentContent : content->dependentTensors) {
     TensorBase current;
@@ -776,14 +1186,14 @@ static inline map<TensorVar, TensorBase> getTensors(const IndexExpr& expr) {
 }
 
 static inline
-vector<void*> packArguments(const TensorBase& tensor) {
-  vector<void*> arguments;
+vector<TensorStorage> getArgumentStorages(const TensorBase& tensor) {
+  vector<TensorStorage> arguments;
 
   // Pack the result tensor
   arguments.push_back(tensor.getStorage());
 
   // Pack any index sets on the result tensor at the front of the arguments list.
-  auto lhs = getNode(tensor.getAssignment().getLhs());
+  auto lhs = getNode(tensor.getKernelAssignment().getLhs());
   // We check isa<AccessNode> rather than isa<AccessTensorNode> to catch cases
   // where the underlying access is represented with the base AccessNode class.
   if (isa<AccessNode>(lhs)) {
@@ -794,9 +1204,10 @@ vector<void*> packArguments(const TensorBase& tensor) {
   }
 
   // Pack operand tensors
-  auto operands = getArguments(makeConcreteNotation(tensor.getAssignment()));
+  auto operands =
+      getArguments(makeConcreteNotation(tensor.getKernelAssignment()));
 
-  auto tensors = getTensors(tensor.getAssignment().getRhs());
+  auto tensors = getTensors(tensor.getKernelAssignment().getRhs());
   for (auto& operand : operands) {
     taco_iassert(util::contains(tensors, operand));
     arguments.push_back(tensors.at(operand).getStorage());
@@ -805,24 +1216,94 @@ vector<void*> packArguments(const TensorBase& tensor) {
   return arguments;
 }
 
+static inline
+vector<void*> packArguments(const TensorBase& tensor) {
+  vector<void*> arguments;
+  for (auto& storage : getArgumentStorages(tensor)) {
+    arguments.push_back(static_cast<taco_tensor_t*>(storage));
+  }
+  return arguments;
+}
+
+/// Returns the indices of the operands of the tensor's kernel, which determine
+/// the sparsity pattern of the tensor.
+static vector<Index> getOperandIndices(const TensorBase& tensor) {
+  vector<Index> indices;
+  vector<TensorStorage> arguments = getArgumentStorages(tensor);
+  for (size_t i = 1; i < arguments.size(); i++) {
+    indices.push_back(arguments[i].getIndex());
+  }
+  return indices;
+}
+
+/// Returns true if the indices consist of the same index arrays.  The arrays
+/// are compared by address, which identifies them as long as the indices are
+/// kept alive.
+static bool sameIndexArrays(const vector<Index>& a, const vector<Index>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].numModeIndices() != b[i].numModeIndices()) {
+      return false;
+    }
+    for (int mode = 0; mode < a[i].numModeIndices(); mode++) {
+      const ModeIndex& modeIndexA = a[i].getModeIndex(mode);
+      const ModeIndex& modeIndexB = b[i].getModeIndex(mode);
+      if (modeIndexA.numIndexArrays() != modeIndexB.numIndexArrays()) {
+        return false;
+      }
+      for (int j = 0; j < modeIndexA.numIndexArrays(); j++) {
+        const Array& arrayA = modeIndexA.getIndexArray(j);
+        const Array& arrayB = modeIndexB.getIndexArray(j);
+        if (arrayA.getData() != arrayB.getData() ||
+            arrayA.getSize() != arrayB.getSize()) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
 void TensorBase::assemble() {
   taco_uassert(!needsCompile()) << error::assemble_without_compile;
   if (!needsAssemble()) {
     return;
   }
   // Sync operand tensors if needed.
-  auto operands = getTensors(getAssignment().getRhs());
+  auto operands = getTensors(getKernelAssignment().getRhs());
   for (auto& operand : operands) {
     operand.second.syncValues();
   }
 
+  // Reuse the sparsity pattern of the previous assembly if it was computed by
+  // the same kernel from the same operand index arrays.
+  vector<Index> operandIndices;
+  if (!content->assembleWhileCompute) {
+    operandIndices = getOperandIndices(*this);
+    if (content->assembledModule == content->module &&
+        sameIndexArrays(operandIndices, content->assembledIndices)) {
+      setNeedsAssemble(false);
+      return;
+    }
+  }
+
   auto arguments = packArguments(*this);
   content->module->callFuncPacked("assemble", arguments.data());
 
   if (!content->assembleWhileCompute) {
-    setNeedsAssemble(false);
     taco_tensor_t* tensorData = ((taco_tensor_t*)arguments[0]);
-    content->valuesSize = unpackTensorData(*tensorData, *this);
+    bool overflowed = false;
+    content->valuesSize = unpackTensorData(*tensorData, *this, false,
+                                           &overflowed);
+    if (overflowed) {
+      assemble();
+      return;
+    }
+    setNeedsAssemble(false);
+    content->assembledModule = content->module;
+    content->assembledIndices = operandIndices;
   }
 }
 
@@ -833,20 +1314,40 @@ void TensorBase::compute() {
   }
   setNeedsCompute(false);
   // Sync operand tensors if needed.
-  auto operands = getTensors(getAssignment().getRhs());
+  auto operands = getTensors(getKernelAssignment().getRhs());
   for (auto& operand : operands) {
     operand.second.syncValues();
     operand.second.removeDependentTensor(*this);
   }
 
-  auto arguments = packArguments(*this);
-  this->content->module->callFuncPacked("compute", arguments.data());
+  bool overflowed;
+  do {
+    auto arguments = packArguments(*this);
+    this->content->module->callFuncPacked("compute", arguments.data());
 
-  if (content->assembleWhileCompute) {
-    setNeedsAssemble(false);
-    taco_tensor_t* tensorData = ((taco_tensor_t*)arguments[0]);
-    content->valuesSize = unpackTensorData(*tensorData, *this);
+    overflowed = false;
+    if (content->assembleWhileCompute) {
+      setNeedsAssemble(false);
+      taco_tensor_t* tensorData = ((taco_tensor_t*)arguments[0]);
+      content->valuesSize = unpackTensorData(*tensorData, *this, false,
+                                             &overflowed);
+    }
+  } while (overflowed);
+}
+
+PreparedKernel TensorBase::prepare() {
+  taco_uassert(!needsCompile()) << error::compute_without_compile;
+  // Sync operand tensors if needed.
+  auto operands = getTensors(getKernelAssignment().getRhs());
+  for (auto& operand : operands) {
+    operand.second.syncValues();
+    operand.second.removeDependentTensor(*this);
   }
+  setNeedsAssemble(false);
+  setNeedsCompute(false);
+
+  return PreparedKernel(content->module, 1, getArgumentStorages(*this),
+                        content->assembleWhileCompute);
 }
 
 void TensorBase::evaluate() {
@@ -857,6 +1358,207 @@ void TensorBase::evaluate() {
   this->compute();
 }
 
+void TensorBase::recompute() {
+  taco_uassert(!needsCompile()) << error::compute_without_compile;
+  taco_uassert(!content->assembleWhileCompute &&
+               content->assembledModule != nullptr &&
+               content->assembledModule == content->module)
+      << error::recompute_without_assemble;
+  // Sync operand tensors if needed.
+  auto operands = getTensors(getKernelAssignment().getRhs());
+  for (auto& operand : operands) {
+    operand.second.syncValues();
+    operand.second.removeDependentTensor(*this);
+  }
+  setNeedsAssemble(false);
+  setNeedsCompute(false);
+
+  // The compute function writes into the arrays of the previous assembly, so
+  // the storage is not unpacked again.
+  auto arguments = packArguments(*this);
+  content->module->callFuncPacked("compute", arguments.data());
+}
+
+/// Merges two concrete statements into one that computes both, sharing the
+/// outer loops the statements have in common.
+static IndexStmt mergeStatements(IndexStmt a, IndexStmt b) {
+  if (isa<Forall>(a) && isa<Forall>(b)) {
+    Forall foralla = to<Forall>(a);
+    Forall forallb = to<Forall>(b);
+    if (foralla.getIndexVar() == forallb.getIndexVar() &&
+        foralla.getMergeStrategy() == forallb.getMergeStrategy() &&
+        foralla.getParallelUnit() == forallb.getParallelUnit() &&
+        foralla.getOutputRaceStrategy() == forallb.getOutputRaceStrategy() &&
+        foralla.getUnrollFactor() == forallb.getUnrollFactor()) {
+      return forall(foralla.getIndexVar(),
+                    mergeStatements(foralla.getStmt(), forallb.getStmt()),
+                    foralla.getMergeStrategy(), foralla.getParallelUnit(),
+                    foralla.getOutputRaceStrategy(),
+                    foralla.getUnrollFactor());
+    }
+  }
+  return multi(a, b);
+}
+
+void evaluate(const std::vector<TensorBase>& tensors) {
+  taco_uassert(!tensors.empty()) << "No tensors to evaluate";
+  if (tensors.size() == 1) {
+    TensorBase tensor = tensors[0];
+    tensor.evaluate();
+    return;
+  }
+
+  map<TensorVar, TensorBase> results;
+  map<TensorVar, TensorBase> operands;
+  IndexStmt stmt;
+  for (const TensorBase& tensor : tensors) {
+    Assignment assignment = tensor.getAssignment();
+    taco_uassert(assignment.defined()) << error::compile_without_expr;
+    taco_uassert(!assignment.getOperator().defined())
+        << tensor.getName() << " accumulates into its values, so it must be "
+        << "evaluated on its own";
+    taco_uassert(!util::contains(results, tensor.getTensorVar()))
+        << tensor.getName() << " is evaluated more than once";
+    auto lhs = getNode(assignment.getLhs());
+    taco_uassert(!isa<AccessNode>(lhs) ||
+                 to<AccessNode>(lhs)->indexSetModes.empty())
+        << "Results with index sets must be evaluated on their own";
+    for (const auto& modeFormat : tensor.getFormat().getModeFormats()) {
+      taco_uassert(canBeAssembled(modeFormat))
+          << modeFormat.getName() << " modes support neither insertion nor "
+          << "appending, so " << tensor.getName() << " cannot be the result "
+          << "of a computation";
+    }
+
+    results.insert({tensor.getTensorVar(), tensor});
+    for (auto& operand : getTensors(assignment.getRhs())) {
+      operands.insert(operand);
+    }
+
+    IndexStmt tensorStmt =
+        makeConcreteNotation(makeReductionNotation(assignment));
+    tensorStmt = reorderLoopsTopologically(tensorStmt);
+    tensorStmt = insertTemporaries(tensorStmt);
+    stmt = stmt.defined() ? mergeStatements(stmt, tensorStmt) : tensorStmt;
+  }
+  for (auto& result : results) {
+    taco_uassert(!util::contains(operands, result.first))
+        << result.second.getName() << " is an operand of a tensor it is "
+        << "evaluated with";
+  }
+
+  // Sync operand tensors if needed.
+  for (auto& result : results) {
+    for (auto& operand : getTensors(result.second.getAssignment().getRhs())) {
+      operand.second.syncValues();
+      operand.second.removeDependentTensor(result.second);
+    }
+  }
+
+  // Unlike compile(), the merged statement is not scalar promoted, since
+  // scalarPromote names and hoists temporaries assuming a single result.
+  IndexStmt stmtToCompile = stmt.concretize();
+  shared_ptr<Module> module;
+  const bool cacheKernels = !std::getenv("CACHE_KERNELS") ||
+                            std::string(std::getenv("CACHE_KERNELS")) != "0";
+  if (cacheKernels) {
+    module = TensorBase::getComputeKernel(stmtToCompile);
+  }
+  if (!module) {
+    module = make_shared<Module>();
+    module->addFunction(lower(stmtToCompile, "assemble", true, false));
+    module->addFunction(lower(stmtToCompile, "compute", false, true));
+    module->compile();
+    if (cacheKernels) {
+      TensorBase::cacheComputeKernel(stmtToCompile, module);
+    }
+  }
+
+  vector<TensorVar> resultVars = getResults(stmtToCompile);
+  vector<void*> arguments;
+  for (auto& result : resultVars) {
+    taco_iassert(util::contains(results, result));
+    arguments.push_back(static_cast<taco_tensor_t*>(
+        results.at(result).getStorage()));
+  }
+  for (auto& operand : getArguments(stmtToCompile)) {
+    taco_iassert(util::contains(operands, operand));
+    arguments.push_back(static_cast<taco_tensor_t*>(
+        operands.at(operand).getStorage()));
+  }
+
+  bool overflowed;
+  do {
+    module->callFuncPacked("assemble", arguments.data());
+    overflowed = false;
+    for (size_t i = 0; i < resultVars.size(); i++) {
+      TensorBase result = results.at(resultVars[i]);
+      result.content->valuesSize =
+          unpackTensorData(*((taco_tensor_t*)arguments[i]), result, false,
+                           &overflowed);
+      result.setNeedsAssemble(false);
+      arguments[i] = static_cast<taco_tensor_t*>(result.getStorage());
+    }
+  } while (overflowed);
+  module->callFuncPacked("compute", arguments.data());
+  for (auto& result : results) {
+    result.second.setNeedsCompute(false);
+  }
+}
+
+TensorBase makeCompressed(const std::string& name, const TensorBase& tensor) {
+  TensorBase source = tensor;
+  source.syncValues();
+  const Format& format = source.getFormat();
+  const int last = format.getOrder() - 1;
+  taco_uassert(last >= 0 &&
+               (format.getModeFormats()[last].getName() == Hashed.getName() ||
+                format.getModeFormats()[last].getName() == Bitmap.getName()))
+      << "The last level of " << tensor.getName() << " is not hashed or a "
+      << "bitmap";
+
+  vector<ModeFormatPack> modeFormatPacks;
+  for (int i = 0; i < last; i++) {
+    modeFormatPacks.push_back(format.getModeFormats()[i]);
+  }
+  modeFormatPacks.push_back(Compressed);
+  TensorBase compressed(name, source.getComponentType(),
+                        source.getDimensions(),
+                        Format(modeFormatPacks, format.getModeOrdering()),
+                        source.getFillValue());
+
+  const TensorStorage& sourceStorage = source.getStorage();
+  const Index& sourceIndex = sourceStorage.getIndex();
+  vector<ModeIndex> modeIndices;
+  for (int i = 0; i < last; i++) {
+    modeIndices.push_back(sourceIndex.getModeIndex(i));
+  }
+  const ModeIndex& lastIndex = sourceIndex.getModeIndex(last);
+  Array pos, crd, vals;
+  if (format.getModeFormats()[last].getName() == Bitmap.getName()) {
+    const int width = lastIndex.getIndexArray(0).get(0).getAsIndex();
+    const Array& bits = lastIndex.getIndexArray(1);
+    const size_t numFibers = (width > 0) ? bits.getSize() * 64 / width : 0;
+    BitmapModeFormat::compress((const uint64_t*)bits.getData(),
+                               sourceStorage.getValues(), numFibers, width,
+                               &pos, &crd, &vals);
+  } else {
+    const int capacity = lastIndex.getIndexArray(0).get(0).getAsIndex();
+    const Array& table = lastIndex.getIndexArray(1);
+    const size_t numFibers = table.getSize() / capacity;
+    HashedModeFormat::compress((const int*)table.getData(),
+                               sourceStorage.getValues(), numFibers, capacity,
+                               &pos, &crd, &vals);
+  }
+  modeIndices.push_back(ModeIndex({pos, crd}));
+
+  TensorStorage storage = compressed.getStorage();
+  storage.setIndex(Index(compressed.getFormat(), modeIndices));
+  storage.setValues(vals);
+  compressed.setStorage(storage);
+  return compressed;
+}
+
 void TensorBase::operator=(const IndexExpr& expr) {
   taco_uassert(getOrder() == 0)
       << "Must use index variable on the left-hand-side when assigning an "
@@ -871,23 +1573,33 @@ void TensorBase::operator=(const IndexExpr& expr) {
   Assignment assign = makeReductionNotation(Assignment(getTensorVar(), {}, expr));
 
   setNeedsPack(false);
-  if (!equals(getAssignment(), assign)) {
+  if (!isCompiledFor(*this, assign)) {
     setNeedsCompile(true);
   }
   setNeedsAssemble(true);
   setNeedsCompute(true);
 
   setAssignment(assign);
+  addKernelDependencies();
 }
 
 void TensorBase::setAssignment(Assignment assignment) {
-  content->assignment = makeReductionNotation(assignment);
+  assignment = makeReductionNotation(assignment);
+  if (!equals(content->assignment, assignment)) {
+    content->kernelAssignment = Assignment();
+  }
+  content->assignment = assignment;
 }
 
 Assignment TensorBase::getAssignment() const {
   return content->assignment;
 }
 
+Assignment TensorBase::getKernelAssignment() const {
+  return content->kernelAssignment.defined() ? content->kernelAssignment
+                                             : content->assignment;
+}
+
 void TensorBase::printComputeIR(ostream& os, bool color, bool simplify) const {
   std::shared_ptr<ir::CodeGen> codegen = ir::CodeGen::init_default(os, ir::CodeGen::ImplementationGen);
   codegen->compile(content->computeFunc.as<Function>(), false);
@@ -940,6 +1652,8 @@ TensorBase::getHelperFunctions(const Format& format, Datatype ctype,
       util::ReverseConstIterable<TensorBase::HelperFuncsCache>(helperFunctions);
   for (const auto& helperFuncs : helperFunctionsReverse) {
     if (std::get<0>(helperFuncs) == format &&
+        std::get<0>(helperFuncs).getLevelArrayTypes() ==
+            format.getLevelArrayTypes() &&
         std::get<1>(helperFuncs) == ctype &&
         std::get<2>(helperFuncs) == dimensions) {
       // If helper functions had already been generated for specified tensor
@@ -959,15 +1673,43 @@ TensorBase::getHelperFunctions(const Format& format, Datatype ctype,
   const auto dims = util::map(dimensions, getDim);
 
   if (format.getOrder() > 0) {
-    const Format bufferFormat = COO(format.getOrder(), false, true, false,
-                                    format.getModeOrdering());
+    Format bufferFormat = COO(format.getOrder(), false, true, false,
+                              format.getModeOrdering());
+    std::vector<std::vector<Datatype>> bufferArrayTypes(format.getOrder(),
+                                                        {Int32, Int32});
+    bufferArrayTypes[0][0] = getBufferPosType(format);
+    bufferFormat.setLevelArrayTypes(bufferArrayTypes);
     TensorVar bufferTensor(Type(ctype, Shape(dims)), bufferFormat);
     TensorVar packedTensor(Type(ctype, Shape(dims)), format);
 
+    // Packed and sliced modes cannot be assembled, and hashed and bitmap
+    // modes cannot be appended to, so they are packed as compressed modes and
+    // converted when the tensor data is unpacked.
+    std::vector<ModeFormatPack> packModeFormats;
+    for (const auto& modeFormat : format.getModeFormats()) {
+      if (isPackedAsCompressed(modeFormat)) {
+        packModeFormats.push_back(Compressed({
+            modeFormat.isOrdered() ? ModeFormat::ORDERED : ModeFormat::NOT_ORDERED,
+            modeFormat.isUnique() ? ModeFormat::UNIQUE : ModeFormat::NOT_UNIQUE}));
+      } else {
+        packModeFormats.push_back(modeFormat);
+      }
+    }
+    Format packFormat(packModeFormats, format.getModeOrdering());
+    std::vector<std::vector<Datatype>> packArrayTypes =
+        format.getLevelArrayTypes();
+    for (int i = 0; i < format.getOrder(); i++) {
+      if (format.getModeFormats()[i].getName() == Bitmap.getName()) {
+        packArrayTypes[i] = {Int32, Int32};
+      }
+    }
+    packFormat.setLevelArrayTypes(packArrayTypes);
+    TensorVar packTarget(Type(ctype, Shape(dims)), packFormat);
+
     // Define packing and iterator routines in index notation.
     // TODO: Use `generatePackCOOStmt` function to generate pack routine.
     std::vector<IndexVar> indexVars(format.getOrder());
-    IndexStmt packStmt = (packedTensor(indexVars) = bufferTensor(indexVars));
+    IndexStmt packStmt = (packTarget(indexVars) = bufferTensor(indexVars));
     IndexStmt iterateStmt = Yield(indexVars, packedTensor(indexVars));
     for (int i = format.getOrder() - 1; i >= 0; --i) {
       int mode = format.getModeOrdering()[i];
@@ -977,9 +1719,9 @@ TensorBase::getHelperFunctions(const Format& format, Datatype ctype,
 
     bool doAppend = true;
     for (int i = format.getOrder() - 1; i >= 0; --i) {
-      const auto modeFormat = format.getModeFormats()[i];
+      const auto modeFormat = packFormat.getModeFormats()[i];
       if (modeFormat.isBranchless() && i != 0) {
-        const auto parentModeFormat = format.getModeFormats()[i - 1];
+        const auto parentModeFormat = packFormat.getModeFormats()[i - 1];
         if (parentModeFormat.isUnique() || !parentModeFormat.hasAppend()) {
           doAppend = false;
           break;
@@ -987,7 +1729,7 @@ TensorBase::getHelperFunctions(const Format& format, Datatype ctype,
       }
     }
     if (!doAppend) {
-      packStmt = packStmt.assemble(packedTensor, AssembleStrategy::Insert);
+      packStmt = packStmt.assemble(packTarget, AssembleStrategy::Insert);
     }
 
     // Lower packing and iterator code.
@@ -1387,25 +2129,58 @@ void packOperands(const TensorBase& tensor) {
 static ParallelSchedule taco_parallel_sched = ParallelSchedule::Static;
 static int taco_chunk_size = 0;
 static int taco_num_threads = 1;
+static std::mutex taco_parallel_settings_mutex;
+
+// The innermost settings of the calling thread, which take precedence over the
+// process-wide settings above.
+static thread_local const ScopedParallelSettings* taco_thread_settings =
+    nullptr;
 
 void taco_set_parallel_schedule(ParallelSchedule sched, int chunk_size) {
+  lock_guard<std::mutex> lock(taco_parallel_settings_mutex);
   taco_parallel_sched = sched;
   taco_chunk_size = chunk_size;
 }
 
 void taco_get_parallel_schedule(ParallelSchedule *sched, int *chunk_size) {
+  if (taco_thread_settings != nullptr) {
+    *sched = taco_thread_settings->sched;
+    *chunk_size = taco_thread_settings->chunkSize;
+    return;
+  }
+  lock_guard<std::mutex> lock(taco_parallel_settings_mutex);
   *sched = taco_parallel_sched;
   *chunk_size = taco_chunk_size;
 }
 
 void taco_set_num_threads(int num_threads) {
   if (num_threads > 0) {
+    lock_guard<std::mutex> lock(taco_parallel_settings_mutex);
     taco_num_threads = num_threads;
   }
 }
 
 int taco_get_num_threads() {
+  if (taco_thread_settings != nullptr) {
+    return taco_thread_settings->numThreads;
+  }
+  lock_guard<std::mutex> lock(taco_parallel_settings_mutex);
   return taco_num_threads;
 }
 
+ScopedParallelSettings::ScopedParallelSettings(int numThreads,
+                                               ParallelSchedule sched,
+                                               int chunkSize)
+    : numThreads(numThreads), sched(sched), chunkSize(chunkSize),
+      previous(taco_thread_settings) {
+  taco_uassert(numThreads > 0) << "The number of threads must be positive";
+  taco_thread_settings = this;
+}
+
+ScopedParallelSettings::~ScopedParallelSettings() {
+  taco_iassert(taco_thread_settings == this)
+      << "Parallel settings must be destroyed in reverse order of creation";
+  taco_thread_settings = previous;
+}
+
 }
@@ -16,6 +16,23 @@ static int unlink_cb(const char *fpath, const struct stat *sb, int typeflag, str
     return rv;
 }
 
+/// Returns the sizes of the data caches in bytes, from the first level
+/// outward.  Levels that the platform does not report get common sizes.
+std::vector<size_t> getCacheSizes() {
+  std::vector<size_t> sizes = {32 * 1024, 1024 * 1024, 8 * 1024 * 1024};
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL3_CACHE_SIZE)
+  const int names[] = {_SC_LEVEL1_DCACHE_SIZE, _SC_LEVEL2_CACHE_SIZE,
+                       _SC_LEVEL3_CACHE_SIZE};
+  for (size_t level = 0; level < sizes.size(); level++) {
+    const long size = sysconf(names[level]);
+    if (size > 0) {
+      sizes[level] = (size_t)size;
+    }
+  }
+#endif
+  return sizes;
+}
+
 void cachedtmpdirCleanup(void) {
   if (cachedtmpdir != ""){
     int rv = nftw(cachedtmpdir.c_str(), unlink_cb, 64, FTW_DEPTH | FTW_PHYS);
@@ -0,0 +1,100 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include <algorithm>
+
+#include "taco/tensor.h"
+#include "taco/index_notation/index_notation.h"
+#include "taco/index_notation/cost_model.h"
+#include "taco/index_notation/transformations.h"
+
+using namespace taco;
+
+namespace cost_model_tests {
+
+const IndexVar i("i"), j("j");
+
+TEST(cost_model, statistics) {
+  Tensor<double> A("A", {4, 6}, CSR);
+  A.insert({1, 0}, 1.0);
+  A.insert({2, 1}, 2.0);
+  A.insert({2, 3}, 3.0);
+  A.insert({2, 5}, 4.0);
+  A.insert({3, 2}, 5.0);
+  A.insert({3, 4}, 6.0);
+  A.pack();
+
+  TensorStatistics statistics(A.getStorage());
+  ASSERT_TRUE(statistics.defined());
+  ASSERT_EQ(4.0, statistics.getNumPositions(0));
+  ASSERT_EQ(6.0, statistics.getNumPositions(1));
+  ASSERT_EQ(1.5, statistics.getAverageFiberLength(1));
+  ASSERT_EQ(3.0, statistics.getMaxFiberLength(1));
+  ASSERT_EQ(0.25, statistics.getDensity(1));
+
+  TensorStatistics uniform({4, 6}, CSR, 6);
+  ASSERT_EQ(6.0, uniform.getNumPositions(1));
+  ASSERT_EQ(1.5, uniform.getAverageFiberLength(1));
+  ASSERT_FALSE(TensorStatistics().defined());
+}
+
+TEST(cost_model, loop_order) {
+  Tensor<double> B("B", {1024, 1024}, Format({Dense, Dense}));
+  Tensor<double> x("x", {1024}, Format({Dense}));
+  Tensor<double> y("y", {1024}, Format({Dense}));
+  y(i) = B(i, j) * x(j);
+
+  IndexStmt rowMajor = makeConcreteNotation(y.getAssignment());
+  IndexStmt columnMajor = rowMajor.reorder({j, i});
+  map<TensorVar,TensorStatistics> statistics;
+  Cost rowMajorCost = estimateCost(rowMajor, statistics);
+  Cost columnMajorCost = estimateCost(columnMajor, statistics);
+  ASSERT_EQ(rowMajorCost.operations, columnMajorCost.operations);
+  ASSERT_LT(rowMajorCost.memoryTraffic, columnMajorCost.memoryTraffic);
+  ASSERT_LT(rowMajorCost.time, columnMajorCost.time);
+  ASSERT_EQ(vector<size_t>({0, 1}),
+            rankSchedules({rowMajor, columnMajor}, statistics));
+}
+
+TEST(cost_model, load_imbalance) {
+  // The first rows hold most of the nonzeros
+  Tensor<double> A("A", {1024, 1024}, CSR);
+  for (int row = 0; row < 1024; row++) {
+    const int rowLength = (row < 4) ? 1024 : 1;
+    for (int col = 0; col < rowLength; col++) {
+      A.insert({row, col}, 1.0);
+    }
+  }
+  A.pack();
+  Tensor<double> x("x", {1024}, Format({Dense}));
+  Tensor<double> y("y", {1024}, Format({Dense}));
+  y(i) = A(i, j) * x(j);
+
+  IndexStmt stmt = makeConcreteNotation(y.getAssignment());
+  IndexStmt even = stmt.parallelize(i, ParallelUnit::CPUThread,
+                                    OutputRaceStrategy::NoRaces);
+  IndexStmt balanced = stmt.parallelize(i, ParallelUnit::CPUThreadBalanced,
+                                        OutputRaceStrategy::NoRaces);
+  map<TensorVar,TensorStatistics> statistics;
+  statistics.insert({A.getTensorVar(), TensorStatistics(A.getStorage())});
+  CostModelParameters parameters;
+  parameters.numThreads = 4;
+
+  Cost serialCost = estimateCost(stmt, statistics, parameters);
+  Cost evenCost = estimateCost(even, statistics, parameters);
+  Cost balancedCost = estimateCost(balanced, statistics, parameters);
+  ASSERT_EQ(0.0, serialCost.parallelOperations);
+  ASSERT_LT(0.0, evenCost.parallelOperations);
+  ASSERT_LT(1.0, evenCost.loadImbalance);
+  ASSERT_EQ(1.0, balancedCost.loadImbalance);
+  ASSERT_LT(balancedCost.time, evenCost.time);
+  ASSERT_LT(evenCost.time, serialCost.time);
+
+  vector<size_t> ranking = rankSchedules({stmt, even, balanced}, statistics,
+                                         parameters);
+  ASSERT_EQ(2u, ranking[0]);
+  std::sort(ranking.begin(), ranking.end());
+  ASSERT_EQ(vector<size_t>({0, 1, 2}), ranking);
+}
+
+}
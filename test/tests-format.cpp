@@ -2,11 +2,17 @@
 #include "test_tensors.h"
 
 #include <tuple>
+#include <climits>
+#include <algorithm>
 
 #include "taco/tensor.h"
 #include "taco/format.h"
 #include "taco/index_notation/index_notation.h"
 #include "taco/storage/storage.h"
+#include "taco/lower/mode_format_packed.h"
+#include "taco/lower/mode_format_sliced.h"
+#include "taco/lower/mode_format_hashed.h"
+#include "taco/lower/mode_format_bitmap.h"
 #include "taco/util/strings.h"
 
 using namespace taco;
@@ -72,3 +78,485 @@ TEST(format, dense) {
   A.pack();
   ASSERT_COMPONENTS_EQUALS({{{3}}, {{3}}}, {0,2,0, 0,0,0, 3,0,4}, A);
 }
+
+TEST(format, packed_coordinates) {
+  for (size_t size : {0, 1, 127, 128, 129, 300}) {
+    std::vector<int> crd(size);
+    for (size_t p = 0; p < size; p++) {
+      // Mix of narrow and wide blocks, including the full coordinate range
+      crd[p] = (p < 128) ? (int)(p * 3) : (int)((p * 2654435761u) % INT_MAX);
+    }
+    Array packed = PackedModeFormat::packCoordinates(crd.data(), size);
+    for (size_t p = 0; p < size; p++) {
+      ASSERT_EQ(crd[p], PackedModeFormat::unpackCoordinate(
+                            (const int*)packed.getData(), p));
+    }
+  }
+}
+
+TEST(format, packed_coordinates_padding) {
+  // The last block has width zero, so its coordinates are read from the
+  // padding, and the words of the block before it end at the padding
+  std::vector<int> crd(2 * PACKED_BLOCK_SIZE + 5, 7);
+  const size_t blockSize = PACKED_BLOCK_SIZE;
+  for (size_t p = 0; p < blockSize; p++) {
+    crd[p] = (int)(p * 1000003 % 65536);
+  }
+  for (size_t p = blockSize; p < 2 * blockSize; p++) {
+    crd[p] = (p % 2 == 0) ? INT_MAX : 0;
+  }
+  Array packed = PackedModeFormat::packCoordinates(crd.data(), crd.size());
+  const int* data = (const int*)packed.getData();
+  const size_t numBlocks = 3;
+  ASSERT_EQ(data[0] + data[2 + 2 * numBlocks] + 2, (int)packed.getSize());
+  for (size_t p = 0; p < crd.size(); p++) {
+    ASSERT_EQ(crd[p], PackedModeFormat::unpackCoordinate(data, p));
+  }
+}
+
+TEST(format, packed) {
+  for (Format format : {Format({Dense, Packed}), Format({Packed, Packed}),
+                        Format({Dense, Packed}, {1,0})}) {
+    SCOPED_TRACE(util::toString(format));
+    Tensor<double> A = d33a_data().makeTensor("A", format);
+    A.pack();
+    EXPECT_TRUE(d33a_data().compare(A));
+
+    Tensor<double> x("x", {3}, Dense);
+    x.insert({0}, 1.0);
+    x.insert({1}, 2.0);
+    x.insert({2}, 3.0);
+    x.pack();
+
+    IndexVar i, j;
+    Tensor<double> y("y", {3}, Dense);
+    y(i) = A(i,j) * x(j);
+    y.evaluate();
+
+    Tensor<double> expected("expected", {3}, Dense);
+    expected.insert({0}, 4.0);
+    expected.insert({2}, 15.0);
+    expected.pack();
+    ASSERT_TRUE(equals(expected, y));
+  }
+}
+
+TEST(format, packed_search) {
+  // Rows span several blocks of packed coordinates
+  const int size = 400;
+  Tensor<double> csr("csr", {size, size}, CSR);
+  Tensor<double> packed("packed", {size, size}, Format({Dense, Packed}));
+  for (int i = 0; i < size; i++) {
+    for (int j = i % 3; j < size; j += 1 + i % 4) {
+      csr.insert({i, j}, (double) (i + j));
+      packed.insert({i, j}, (double) (i + j));
+    }
+  }
+  csr.pack();
+  packed.pack();
+
+  // Windows search for the positions of their bounds
+  IndexVar i("i"), j("j"), j0("j0"), j1("j1");
+  Tensor<double> expected("expected", {size}, Format({Dense}));
+  expected(i) = csr(i, j(50, 350));
+  Tensor<double> windowed("windowed", {size}, Format({Dense}));
+  windowed(i) = packed(i, j(50, 350));
+  windowed.evaluate();
+  ASSERT_NE(std::string::npos,
+            windowed.getSource().find("taco_packed_binarySearchAfter(packed2_crd"));
+  ASSERT_TRUE(equals(expected, windowed));
+
+  // Split loops search for the first position of every chunk
+  Tensor<double> expectedSums("expectedSums", {size}, Format({Dense}));
+  expectedSums(i) = csr(i, j);
+  Tensor<double> split("split", {size}, Format({Dense}));
+  split(i) = packed(i, j);
+  split.compile(split.getAssignment().concretize().split(j, j0, j1, 16));
+  split.assemble();
+  split.compute();
+  ASSERT_NE(std::string::npos,
+            split.getSource().find("taco_packed_binarySearchAfter(packed2_crd"));
+  ASSERT_TRUE(equals(expectedSums, split));
+
+  // Sliced coordinates cannot be searched
+  Tensor<double> sliced("sliced", {size, size}, Format({Dense, Sliced}));
+  Tensor<double> slicedWindowed("slicedWindowed", {size}, Format({Dense}));
+  slicedWindowed(i) = sliced(i, j(50, 350));
+  ASSERT_THROW(slicedWindowed.compile(), TacoException);
+}
+
+TEST(format, packed_size) {
+  // Coordinates of a banded matrix need few bits per coordinate
+  const int size = 1000;
+  Tensor<double> csr("csr", {size, size}, CSR);
+  Tensor<double> packed("packed", {size, size}, Format({Dense, Packed}));
+  for (int i = 0; i < size; i++) {
+    for (int j = std::max(0, i - 2); j < std::min(size, i + 3); j++) {
+      csr.insert({i, j}, 1.0);
+      packed.insert({i, j}, 1.0);
+    }
+  }
+  csr.pack();
+  packed.pack();
+  ASSERT_TRUE(equals(csr, packed));
+
+  const Array& csrCrd = csr.getStorage().getIndex().getModeIndex(1)
+                           .getIndexArray(1);
+  const Array& packedCrd = packed.getStorage().getIndex().getModeIndex(1)
+                                 .getIndexArray(1);
+  ASSERT_LT(packedCrd.getSize() * 2, csrCrd.getSize());
+}
+
+TEST(format, blocked) {
+  ASSERT_EQ(Format({Dense, Sparse, Dense, Dense}, {0, 1, 2, 3}), BCSR);
+  ASSERT_EQ(Format({Dense, Sparse, Dense, Dense}, {1, 0, 3, 2}), Blocked(CSC));
+  ASSERT_TRUE(isBlocked(BCSR));
+  ASSERT_TRUE(isBlocked(Blocked(CSC)));
+  ASSERT_FALSE(isBlocked(CSR));
+  ASSERT_FALSE(isBlocked(Format({Dense, Dense, Dense, Dense})));
+  ASSERT_FALSE(isBlocked(Format({Dense, Sparse, Dense, Dense}, {0, 1, 3, 2})));
+
+  // A matrix of 3x3 blocks whose dimensions are not multiples of the blocks
+  const int rows = 10, cols = 8;
+  Tensor<double> A("A", {rows, cols}, CSR);
+  Tensor<double> x("x", {cols}, Format({Dense}));
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < cols; j++) {
+      if ((i / 3 + j / 3) % 2 == 0 && (i + j) % 4 != 1) {
+        A.insert({i, j}, (double) (i * cols + j));
+      }
+    }
+  }
+  for (int j = 0; j < cols; j++) {
+    x.insert({j}, (double) j);
+  }
+  A.pack();
+  x.pack();
+
+  TensorBase Ab = makeBlocked<double>("Ab", A, {3, 3}, CSR);
+  ASSERT_EQ(BCSR, Ab.getFormat());
+  ASSERT_EQ(vector<int>({4, 3, 3, 3}), Ab.getDimensions());
+  // Every stored block holds all of its nine components
+  const Index& index = Ab.getStorage().getIndex();
+  ASSERT_EQ(9 * index.getModeIndex(1).getIndexArray(1).getSize(),
+            index.getSize());
+  TensorBase xb = makeBlocked<double>("xb", x, {3}, Format({Dense}));
+
+  IndexVar i, j, bi, bj, ei, ej;
+  Tensor<double> yb("yb", {4, 3}, Format({Dense, Dense}));
+  yb(bi, ei) = Ab(bi, bj, ei, ej) * xb(bj, ej);
+  yb.evaluate();
+
+  Tensor<double> expected("expected", {rows}, Format({Dense}));
+  expected(i) = A(i, j) * x(j);
+  expected.evaluate();
+  TensorBase y = makeUnblocked<double>("y", yb, {rows}, Format({Dense}));
+  ASSERT_TRUE(equals(expected, y));
+  ASSERT_TRUE(equals(A, makeUnblocked<double>("A2", Ab, {rows, cols}, CSR)));
+
+  // Only the sizes of blocks are constant loop bounds
+  ASSERT_NE(string::npos, yb.getSource().find(" < 3; "));
+  Tensor<double> z("z", {cols}, Format({Dense}));
+  z(j) = x(j) * x(j);
+  z.compile();
+  ASSERT_EQ(string::npos, z.getSource().find(" < 8; "));
+}
+
+TEST(format, sliced) {
+  // Rows of varying lengths, including empty rows and a partial last slice
+  const int rows = 37, cols = 50;
+  Tensor<double> A("A", {rows, cols}, CSR);
+  Tensor<double> x("x", {cols}, Format({Dense}));
+  for (int i = 0; i < rows; i++) {
+    for (int k = 0; k < (i * 7) % 13; k++) {
+      A.insert({i, (i + k * 3) % cols}, (double) (i * cols + k + 1));
+    }
+  }
+  for (int j = 0; j < cols; j++) {
+    x.insert({j}, (double) j);
+  }
+  A.pack();
+  x.pack();
+
+  IndexVar i, j;
+  Tensor<double> expected("expected", {rows}, Format({Dense}));
+  expected(i) = A(i, j) * x(j);
+  expected.evaluate();
+
+  const ModeFormat unsorted(std::make_shared<SlicedModeFormat>(4, 1));
+  const ModeFormat sorted(std::make_shared<SlicedModeFormat>(4, 16));
+  ASSERT_NE(unsorted, sorted);
+  vector<size_t> sizes;
+  for (ModeFormat sliced : {Sliced, unsorted, sorted}) {
+    SCOPED_TRACE(util::toString(sliced));
+    Tensor<double> As("As", {rows, cols}, Format({Dense, sliced}));
+    for (auto& component : iterate<double>(A)) {
+      As.insert(component.first.toVector(), component.second);
+    }
+    As.pack();
+    ASSERT_TRUE(equals(A, As));
+
+    // Every row is padded to the longest row of its slice
+    const Index& index = As.getStorage().getIndex();
+    const int sliceHeight = std::static_pointer_cast<const SlicedModeFormat>(
+        sliced.getImpl())->getSliceHeight();
+    const int* ranges = (const int*)index.getModeIndex(1).getIndexArray(0)
+                                        .getData();
+    for (int row = 0; row < rows; row++) {
+      ASSERT_EQ(0, (ranges[2*row + 1] - ranges[2*row]) % sliceHeight);
+    }
+    ASSERT_EQ(0u, index.getSize() % sliceHeight);
+    ASSERT_EQ(index.getSize(), As.getStorage().getValues().getSize());
+    sizes.push_back(index.getSize());
+
+    // The rows of every column of a slice are visited by a vectorized loop
+    Tensor<double> y("y", {rows}, Format({Dense}));
+    y(i) = As(i, j) * x(j);
+    y.evaluate();
+    ASSERT_TRUE(equals(expected, y));
+    ASSERT_NE(std::string::npos, y.getSource().find("vectorize(enable)"));
+    ASSERT_EQ(std::string::npos,
+              y.getSource().find("+= " + std::to_string(sliceHeight)));
+
+    // Slices hold distinct rows, so they can be visited in parallel
+    Tensor<double> yp("yp", {rows}, Format({Dense}));
+    yp(i) = As(i, j) * x(j);
+    IndexStmt stmt = yp.getAssignment().concretize();
+    yp.compile(stmt.parallelize(i, ParallelUnit::CPUThread,
+                                OutputRaceStrategy::NoRaces));
+    yp.assemble();
+    yp.compute();
+    ASSERT_TRUE(equals(expected, yp));
+    ASSERT_NE(std::string::npos, yp.getSource().find("#pragma omp parallel"));
+    ASSERT_NE(std::string::npos, yp.getSource().find("vectorize(enable)"));
+
+    // Other loops visit every row with stride C
+    Tensor<double> D("D", {rows, cols}, Format({Dense, Dense}));
+    D(i, j) = As(i, j);
+    D.evaluate();
+    ASSERT_TRUE(equals(A, D));
+    ASSERT_NE(std::string::npos,
+              D.getSource().find("+= " + std::to_string(sliceHeight)));
+  }
+  // Sorting rows by length reduces the padding
+  ASSERT_LT(sizes[2], sizes[1]);
+
+  ASSERT_THROW(Tensor<double>("B", {rows, cols}, Format({Sliced, Dense})),
+               TacoException);
+  Tensor<double> B("B", {rows, cols}, Format({Dense, Sliced}));
+  B(i, j) = A(i, j);
+  ASSERT_THROW(B.compile(), TacoException);
+}
+
+TEST(format, hashed) {
+  const int rows = 37, cols = 50, width = 20;
+  const ModeFormat hashed16(std::make_shared<HashedModeFormat>(16));
+  const ModeFormat hashed32(std::make_shared<HashedModeFormat>(32));
+  Tensor<double> A("A", {rows, cols}, CSR);
+  Tensor<double> B("B", {cols, width}, CSR);
+  Tensor<double> x("x", {cols}, Format({Dense}));
+  for (int i = 0; i < rows; i++) {
+    for (int k = 0; k < (i * 7) % 13; k++) {
+      A.insert({i, (i + k * 3) % cols}, (double) (i * cols + k + 1));
+    }
+  }
+  for (int k = 0; k < cols; k++) {
+    B.insert({k, (k * 5) % width}, (double) (k + 1));
+    B.insert({k, (k * 3 + 1) % width}, (double) (2 * k + 1));
+    x.insert({k}, (double) k);
+  }
+  A.pack();
+  B.pack();
+  x.pack();
+
+  Tensor<double> Ah("Ah", {rows, cols}, Format({Dense, hashed16}));
+  for (auto& component : iterate<double>(A)) {
+    Ah.insert(component.first.toVector(), component.second);
+  }
+  Ah.pack();
+  ASSERT_EQ((size_t)rows * 16, Ah.getStorage().getValues().getSize());
+  ASSERT_TRUE(equals(A, makeCompressed("Ac", Ah)));
+
+  // Iterate the hashed operand, skipping empty slots
+  IndexVar i, j, k;
+  Tensor<double> expected("expected", {rows}, Format({Dense}));
+  expected(i) = A(i, j) * x(j);
+  Tensor<double> y("y", {rows}, Format({Dense}));
+  y(i) = Ah(i, j) * x(j);
+  ASSERT_TRUE(equals(expected, y));
+
+  // Locate into the hashed operand
+  Tensor<double> expectedSquares("expectedSquares", {rows, cols},
+                                 Format({Dense, Dense}));
+  expectedSquares(i, j) = A(i, j) * A(i, j);
+  Tensor<double> squares("squares", {rows, cols}, Format({Dense, Dense}));
+  squares(i, j) = A(i, j) * Ah(i, j);
+  ASSERT_TRUE(equals(expectedSquares, squares));
+
+  // Scatter the rows of a sparse matrix product into hashed rows
+  Tensor<double> expectedProduct("expectedProduct", {rows, width}, CSR);
+  expectedProduct(i, j) = A(i, k) * B(k, j);
+  Tensor<double> C("C", {rows, width}, Format({Dense, hashed32}));
+  C(i, j) = A(i, k) * B(k, j);
+  C.evaluate();
+  ASSERT_NE(std::string::npos, C.getSource().find("taco_hash_locate"));
+  Tensor<double> Cc = makeCompressed("Cc", C);
+  ASSERT_EQ(CSR, Cc.getFormat());
+  ASSERT_TRUE(equals(expectedProduct, Cc));
+
+  // Insert coordinates one at a time
+  Tensor<double> Au("Au", {rows, cols}, Format({Dense, hashed32}));
+  Au(i, j) = A(i, j);
+  Au.compile(makeConcreteNotation(Au.getAssignment())
+                 .assemble(Au.getTensorVar(), AssembleStrategy::Insert));
+  Au.assemble();
+  Au.compute();
+  ASSERT_TRUE(equals(A, makeCompressed("Auc", Au)));
+
+  ASSERT_THROW(ModeFormat(std::make_shared<HashedModeFormat>(24)),
+               TacoException);
+  ASSERT_THROW(Tensor<double>("D", {rows, cols}, Format({Hashed, Dense})),
+               TacoException);
+
+  // Grow tables that the fibers do not fit in
+  const ModeFormat hashed4(std::make_shared<HashedModeFormat>(4));
+  Tensor<double> D("D", {rows, cols}, Format({Dense, hashed4}));
+  for (auto& component : iterate<double>(A)) {
+    D.insert(component.first.toVector(), component.second);
+  }
+  D.pack();
+  ASSERT_EQ((size_t)rows * 16, D.getStorage().getValues().getSize());
+  ASSERT_TRUE(equals(A, makeCompressed("Dc", D)));
+  Tensor<double> E("E", {rows, width}, Format({Dense, hashed4}));
+  E(i, j) = A(i, k) * B(k, j);
+  E.evaluate();
+  ASSERT_EQ((size_t)rows * 16, E.getStorage().getValues().getSize());
+  ASSERT_TRUE(equals(expectedProduct, makeCompressed("Ec", E)));
+  Tensor<double> F("F", {rows, cols}, Format({Dense, hashed4}));
+  F(i, j) = A(i, j);
+  F.compile(makeConcreteNotation(F.getAssignment())
+                .assemble(F.getTensorVar(), AssembleStrategy::Insert));
+  F.assemble();
+  F.compute();
+  ASSERT_EQ((size_t)rows * 16, F.getStorage().getValues().getSize());
+  ASSERT_TRUE(equals(A, makeCompressed("Fc", F)));
+}
+
+TEST(format, bitmap) {
+  const int rows = 9, cols = 150;
+  Tensor<double> A("A", {rows, cols}, CSR);
+  Tensor<double> a("a", {cols}, Format({Sparse}));
+  Tensor<double> b("b", {cols}, Format({Sparse}));
+  Tensor<double> x("x", {cols}, Format({Dense}));
+  for (int i = 0; i < rows; i++) {
+    for (int j = i; j < cols; j += 4 + i) {
+      A.insert({i, j}, (double) (i * cols + j + 1));
+    }
+  }
+  for (int k = 0; k < cols; k++) {
+    if (k % 5 == 0) {
+      a.insert({k}, (double) (k + 1));
+    }
+    if (k % 3 == 0) {
+      b.insert({k}, (double) (2 * k + 1));
+    }
+    x.insert({k}, (double) k);
+  }
+  A.pack();
+  a.pack();
+  b.pack();
+  x.pack();
+
+  // Fibers are padded to a multiple of 64 positions
+  Tensor<double> Ab("Ab", {rows, cols}, Format({Dense, Bitmap}));
+  Tensor<double> ab("ab", {cols}, Format({Bitmap}));
+  Tensor<double> bb("bb", {cols}, Format({Bitmap}));
+  for (auto& component : iterate<double>(A)) {
+    Ab.insert(component.first.toVector(), component.second);
+  }
+  for (auto& component : iterate<double>(a)) {
+    ab.insert(component.first.toVector(), component.second);
+  }
+  for (auto& component : iterate<double>(b)) {
+    bb.insert(component.first.toVector(), component.second);
+  }
+  Ab.pack();
+  ab.pack();
+  bb.pack();
+  ASSERT_EQ((size_t)rows * 192, Ab.getStorage().getValues().getSize());
+  ASSERT_TRUE(equals(A, makeCompressed("Ac", Ab)));
+
+  // Iterate the marked positions of a bitmap operand
+  IndexVar i, j;
+  Tensor<double> expected("expected", {rows}, Format({Dense}));
+  expected(i) = A(i, j) * x(j);
+  Tensor<double> y("y", {rows}, Format({Dense}));
+  y(i) = Ab(i, j) * x(j);
+  y.evaluate();
+  ASSERT_NE(std::string::npos, y.getSource().find(" + taco_bitmap_ctz("));
+  ASSERT_TRUE(equals(expected, y));
+
+  // Intersect and merge the words of bitmap operands
+  Tensor<double> expectedProduct("expectedProduct", {cols}, Format({Dense}));
+  expectedProduct(i) = a(i) * b(i);
+  Tensor<double> product("product", {cols}, Format({Dense}));
+  product(i) = ab(i) * bb(i);
+  product.evaluate();
+  ASSERT_NE(std::string::npos, product.getSource().find(" & bb1_bits["));
+  ASSERT_TRUE(equals(expectedProduct, product));
+  Tensor<double> expectedSum("expectedSum", {cols}, Format({Dense}));
+  expectedSum(i) = a(i) + b(i);
+  Tensor<double> sum("sum", {cols}, Format({Dense}));
+  sum(i) = ab(i) + bb(i);
+  sum.evaluate();
+  ASSERT_NE(std::string::npos, sum.getSource().find(" | bb1_bits["));
+  ASSERT_TRUE(equals(expectedSum, sum));
+
+  // Locate into and merge with bitmap operands from compressed loops
+  Tensor<double> located("located", {cols}, Format({Dense}));
+  located(i) = a(i) * bb(i);
+  ASSERT_TRUE(equals(expectedProduct, located));
+  Tensor<double> merged("merged", {cols}, Format({Dense}));
+  merged(i) = a(i) + bb(i);
+  ASSERT_TRUE(equals(expectedSum, merged));
+
+  // Insert into bitmap results and append to compressed results
+  Tensor<double> expectedSparse("expectedSparse", {cols}, Format({Sparse}));
+  expectedSparse(i) = a(i) * b(i);
+  Tensor<double> inserted("inserted", {cols}, Format({Bitmap}));
+  inserted(i) = ab(i) * bb(i);
+  ASSERT_TRUE(equals(expectedSparse, makeCompressed("insertedc", inserted)));
+  Tensor<double> appended("appended", {cols}, Format({Sparse}));
+  appended(i) = ab(i) * bb(i);
+  ASSERT_TRUE(equals(expectedSparse, appended));
+
+  // Parallel loops mark positions in the same word atomically
+  Tensor<double> expectedScaled("expectedScaled", {cols}, Format({Sparse}));
+  expectedScaled(i) = a(i) * 2.0;
+  Tensor<double> scaled("scaled", {cols}, Format({Bitmap}));
+  scaled(i) = a(i) * 2.0;
+  scaled.compile(scaled.getAssignment().concretize()
+                       .parallelize(i, ParallelUnit::CPUThread,
+                                    OutputRaceStrategy::NoRaces));
+  scaled.assemble();
+  scaled.compute();
+  ASSERT_NE(std::string::npos, scaled.getSource().find(
+      "#pragma omp atomic\n    scaled1_bits["));
+  ASSERT_TRUE(equals(expectedScaled, makeCompressed("scaledc", scaled)));
+
+  // The fibers of permuted formats are as wide as the dimension of their mode
+  Tensor<double> expectedColSums("expectedColSums", {rows}, Format({Dense}));
+  expectedColSums(i) = A(i, j);
+  Tensor<double> At("At", {rows, cols}, Format({Dense, Bitmap}, {1, 0}));
+  for (auto& component : iterate<double>(A)) {
+    At.insert(component.first.toVector(), component.second);
+  }
+  At.pack();
+  ASSERT_EQ((size_t)cols * 64, At.getStorage().getValues().getSize());
+  Tensor<double> colSums("colSums", {rows}, Format({Dense}));
+  colSums(i) = At(i, j);
+  ASSERT_TRUE(equals(expectedColSums, colSums));
+
+  ASSERT_THROW(Tensor<double>("D", {rows, cols}, Format({Bitmap, Dense})),
+               TacoException);
+}
@@ -1,6 +1,10 @@
 #include "test.h"
 
 #include "taco/tensor.h"
+#include "taco/storage/file_io_tns.h"
+#include "taco/storage/file_io_mtx.h"
+
+#include <sstream>
 
 using namespace taco;
 
@@ -127,3 +131,149 @@ TEST(io, mtxsymmetric) {
 
   ASSERT_TRUE(equals(expected, tensor));
 }
+
+TEST(io, tnsstreaming) {
+  Tensor<double> expected = read(testDataDirectory()+"3tensor.tns", Sparse);
+  for (size_t chunkSize : {1, 2, 1024}) {
+    Tensor<double> tensor = readTNSStreaming(testDataDirectory()+"3tensor.tns",
+                                             Format({Sparse,Sparse,Sparse}),
+                                             chunkSize);
+    ASSERT_EQ(3, tensor.getOrder());
+    ASSERT_EQ(expected.getDimensions(), tensor.getDimensions());
+    ASSERT_TRUE(equals(expected, tensor));
+  }
+}
+
+TEST(io, tnsstreamingunsorted) {
+  std::string tns = "3 2 1.0\n1 1 2.0\n2 4 3.0\n1 3 4.0\n3 2 5.0\n2 1 6.0\n";
+  for (Format format : {CSR, CSC, Format({Dense,Dense}), DCSR}) {
+    std::stringstream expectedStream(tns);
+    TensorBase expected = readTNS(expectedStream, format);
+    for (size_t chunkSize : {1, 2, 4, 1024}) {
+      SCOPED_TRACE(util::toString(format) + " " + util::toString(chunkSize));
+      std::stringstream stream(tns);
+      Tensor<double> tensor = readTNSStreaming(stream, format, chunkSize);
+      ASSERT_EQ(format, tensor.getFormat());
+      ASSERT_TRUE(equals(expected, tensor));
+      ASSERT_EQ(6.0, tensor.at({2, 1}));
+    }
+  }
+}
+
+TEST(io, mtxstreaming) {
+  for (std::string file : {"2tensor.mtx", "ds33.mtx", "rua_32.mtx", "d33.mtx"}) {
+    for (Format format : {CSR, CSC, Format({Dense,Dense}), DCSR}) {
+      TensorBase expected = read(testDataDirectory()+file, format);
+      for (size_t chunkSize : {1, 3, 1024}) {
+        SCOPED_TRACE(file + " " + util::toString(format) + " " +
+                     util::toString(chunkSize));
+        TensorBase tensor = readMTXStreaming(testDataDirectory()+file,
+                                             format, chunkSize);
+        ASSERT_EQ(expected.getDimensions(), tensor.getDimensions());
+        ASSERT_TRUE(equals(expected, tensor));
+      }
+    }
+  }
+}
+
+TEST(io, streampacker) {
+  // Sorted input is packed without spilling to disk, even in small chunks
+  StreamPacker sorted({4, 5}, CSR, 2);
+  for (int i = 0; i < 4; i++) {
+    for (int j = i; j < 5; j += 2) {
+      int coord[] = {i, j};
+      sorted.insert(coord, i + j);
+    }
+  }
+  TensorBase tensor = sorted.finalize();
+  ASSERT_EQ(0u, sorted.getNumSpilledRuns());
+
+  TensorBase expected(Float64, {4, 5}, CSR);
+  for (int i = 0; i < 4; i++) {
+    for (int j = i; j < 5; j += 2) {
+      expected.insert({i, j}, (double)(i + j));
+    }
+  }
+  expected.pack();
+  ASSERT_TRUE(equals(expected, tensor));
+
+  // Unsorted input is sorted externally
+  StreamPacker unsorted({4, 5}, CSR, 2);
+  for (int i = 3; i >= 0; i--) {
+    for (int j = i; j < 5; j += 2) {
+      int coord[] = {i, j};
+      unsorted.insert(coord, i + j);
+    }
+  }
+  tensor = unsorted.finalize();
+  ASSERT_LT(0u, unsorted.getNumSpilledRuns());
+  ASSERT_TRUE(equals(expected, tensor));
+
+  // Many runs are merged in several passes
+  StreamPacker many({40, 50}, CSR, 1);
+  TensorBase manyExpected(Float64, {40, 50}, CSR);
+  for (int i = 39; i >= 0; i--) {
+    for (int j = i % 3; j < 50; j += 3) {
+      int coord[] = {i, j};
+      many.insert(coord, i - j);
+      manyExpected.insert({i, j}, (double)(i - j));
+    }
+  }
+  manyExpected.pack();
+  tensor = many.finalize();
+  ASSERT_LT(64u, many.getNumSpilledRuns());
+  ASSERT_TRUE(equals(manyExpected, tensor));
+}
+
+TEST(io, tnswrite) {
+  Tensor<double> tensor({3, 4}, CSC);
+  tensor.insert({0, 1}, 0.1);
+  tensor.insert({2, 1}, 1.0/3.0);
+  tensor.insert({1, 3}, -2.5);
+  tensor.insert({2, 3}, 1e-300);
+  tensor.insert({0, 0}, 7.0);
+  tensor.pack();
+
+  // Components are written in storage order with the shortest values that
+  // read back exactly
+  std::stringstream stream;
+  writeTNS(stream, tensor);
+  ASSERT_EQ("1 1 7\n"
+            "1 2 0.1\n"
+            "3 2 0.3333333333333333\n"
+            "2 4 -2.5\n"
+            "3 4 1e-300\n", stream.str());
+
+  Tensor<double> result = readTNS(stream, CSC);
+  ASSERT_TRUE(equals(tensor, result));
+  ASSERT_EQ(1.0/3.0, result.at({2, 1}));
+}
+
+TEST(io, tnswritelarge) {
+  // Large enough to be formatted in several blocks
+  const int size = 200000;
+  Tensor<double> tensor({size}, Sparse);
+  for (int i = 0; i < size; i++) {
+    tensor.insert({i}, i / 7.0);
+  }
+  tensor.pack();
+
+  std::stringstream stream;
+  writeTNS(stream, tensor);
+  TensorBase result = readTNS(stream, Sparse);
+  ASSERT_TRUE(equals(tensor, result));
+}
+
+TEST(io, mtxwrite) {
+  Tensor<int> tensor({2, 3}, Format({Dense, Dense}));
+  tensor.insert({0, 2}, -4);
+  tensor.insert({1, 0}, 12);
+  tensor.pack();
+
+  std::stringstream stream;
+  writeMTX(stream, tensor);
+  ASSERT_EQ("%%MatrixMarket matrix array real general\n"
+            "%\n"
+            "2 3 \n"
+            "0\n0\n-4\n12\n0\n0\n", stream.str());
+}
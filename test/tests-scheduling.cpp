@@ -7,6 +7,7 @@
 #include "taco/index_notation/index_notation.h"
 #include "codegen/codegen.h"
 #include "taco/lower/lower.h"
+#include "taco/util/env.h"
 
 #include <functional>
 
@@ -441,6 +442,170 @@ TEST(scheduling, lowerSparseMatrixMul) {
 //  codegen->compile(compute, true);
 }
 
+TEST(scheduling, parallelizeTasks) {
+  if (should_use_CUDA_codegen()) {
+    return;
+  }
+
+  Tensor<double> A("A", {8, 8}, Format({Dense, Sparse}));
+  Tensor<double> x("x", {8}, Format({Dense}));
+  Tensor<double> y("y", {8}, Format({Dense}));
+
+  for (int i = 0; i < 8; i++) {
+    for (int j = 0; j <= i; j++) {
+      A.insert({i, j}, (double) (i+j));
+    }
+    x.insert({i}, (double) i);
+  }
+  A.pack();
+  x.pack();
+
+  y(i) = A(i, j) * x(j);
+  IndexStmt stmt = y.getAssignment().concretize();
+  stmt = stmt.parallelize(i, ParallelUnit::CPUTask, OutputRaceStrategy::NoRaces);
+
+  y.compile(stmt);
+  y.assemble();
+  y.compute();
+
+  Tensor<double> expected("expected", {8}, Format({Dense}));
+  expected(i) = A(i, j) * x(j);
+  expected.compile();
+  expected.assemble();
+  expected.compute();
+  ASSERT_TENSOR_EQ(expected, y);
+
+  // The loop is split into tasks instead of being a parallel loop
+  stringstream source;
+  std::shared_ptr<ir::CodeGen> codegen =
+      ir::CodeGen::init_default(source, ir::CodeGen::ImplementationGen);
+  codegen->compile(lower(stmt, "compute", false, true), true);
+  ASSERT_NE(string::npos, source.str().find("#pragma omp taskloop"));
+  ASSERT_EQ(string::npos, source.str().find("#pragma omp parallel for"));
+}
+
+TEST(scheduling, parallelizeBalanced) {
+  if (should_use_CUDA_codegen()) {
+    return;
+  }
+
+  Tensor<double> A("A", {8, 8}, Format({Dense, Sparse}));
+  Tensor<double> x("x", {8}, Format({Dense}));
+  Tensor<double> y("y", {8}, Format({Dense}));
+
+  // The first and last rows are empty and the nonzeros are skewed
+  for (int i = 1; i < 7; i++) {
+    for (int j = 0; j < ((i == 2) ? 8 : 1); j++) {
+      A.insert({i, j}, (double) (i+j));
+    }
+  }
+  for (int i = 0; i < 8; i++) {
+    x.insert({i}, (double) i);
+  }
+  A.pack();
+  x.pack();
+
+  y(i) = A(i, j) * x(j);
+  IndexStmt stmt = y.getAssignment().concretize();
+  stmt = stmt.parallelize(i, ParallelUnit::CPUThreadBalanced,
+                          OutputRaceStrategy::NoRaces);
+
+  y.compile(stmt);
+  y.assemble();
+  y.compute();
+
+  Tensor<double> expected("expected", {8}, Format({Dense}));
+  expected(i) = A(i, j) * x(j);
+  expected.compile();
+  expected.assemble();
+  expected.compute();
+  ASSERT_TENSOR_EQ(expected, y);
+
+  // The rows of each thread are found by searching the positions of A
+  stringstream source;
+  std::shared_ptr<ir::CodeGen> codegen =
+      ir::CodeGen::init_default(source, ir::CodeGen::ImplementationGen);
+  codegen->compile(lower(stmt, "compute", false, true), true);
+  ASSERT_NE(string::npos, source.str().find("taco_binarySearchAfter(A2_pos"));
+}
+
+TEST(scheduling, autoschedule) {
+  if (should_use_CUDA_codegen()) {
+    return;
+  }
+
+  Tensor<double> A("A", {64, 64}, CSR);
+  Tensor<double> x("x", {64}, Format({Dense}));
+  for (int i = 0; i < 64; i++) {
+    for (int j = 0; j < 64; j += (i % 7) + 1) {
+      A.insert({i, j}, (double) (i+j));
+    }
+    x.insert({i}, (double) i);
+  }
+  A.pack();
+  x.pack();
+
+  Tensor<double> expected("expected", {64}, Format({Dense}));
+  expected(i) = A(i, j) * x(j);
+  expected.evaluate();
+
+  // Only the row-major loop order iterates A in storage order
+  Tensor<double> y("y", {64}, Format({Dense}));
+  y(i) = A(i, j) * x(j);
+  IndexStmt stmt = makeConcreteNotation(y.getAssignment());
+  auto autoscheduler = std::make_shared<Autoscheduler>();
+  vector<IndexStmt> candidates = autoscheduler->getCandidates(stmt);
+  ASSERT_LT(2u, candidates.size());
+  ASSERT_TRUE(equals(stmt, candidates[0]));
+  for (IndexStmt candidate : candidates) {
+    if (isa<SuchThat>(candidate)) {
+      candidate = to<SuchThat>(candidate).getStmt();
+    }
+    ASSERT_NE(j, to<Forall>(candidate).getIndexVar());
+  }
+
+  const string cacheFile = util::getTmpdir() + "autoschedule_cache";
+  std::remove(cacheFile.c_str());
+  autoscheduler = std::make_shared<Autoscheduler>(cacheFile, 1);
+  y.setAutoscheduler(autoscheduler);
+  ASSERT_EQ(autoscheduler, y.getAutoscheduler());
+  y.evaluate();
+  ASSERT_TENSOR_EQ(expected, y);
+  ASSERT_LT(1, autoscheduler->getNumTimedCandidates());
+
+  // A new autoscheduler finds the winner of the same kernel in the cache, even
+  // if its tensors and index variables have different names
+  Tensor<double> B("B", {64, 64}, CSR);
+  Tensor<double> v("v", {64}, Format({Dense}));
+  for (auto& component : A) {
+    B.insert(component.first.toVector(), component.second);
+  }
+  for (auto& component : x) {
+    v.insert(component.first.toVector(), component.second);
+  }
+  B.pack();
+  v.pack();
+  IndexVar k, l;
+  Tensor<double> z("z", {64}, Format({Dense}));
+  z(k) = B(k, l) * v(l);
+  autoscheduler = std::make_shared<Autoscheduler>(cacheFile, 1);
+  z.setAutoscheduler(autoscheduler);
+  z.evaluate();
+  ASSERT_TENSOR_EQ(expected, z);
+  ASSERT_EQ(0, autoscheduler->getNumTimedCandidates());
+  std::remove(cacheFile.c_str());
+
+  // The cost model prunes the candidates that are timed
+  Tensor<double> w("w", {64}, Format({Dense}));
+  w(i) = A(i, j) * x(j);
+  autoscheduler = std::make_shared<Autoscheduler>("", 1);
+  autoscheduler->setMaxTimedCandidates(2);
+  w.setAutoscheduler(autoscheduler);
+  w.evaluate();
+  ASSERT_TENSOR_EQ(expected, w);
+  ASSERT_GE(2, autoscheduler->getNumTimedCandidates());
+}
+
 TEST(scheduling, parallelizeAtomicReduction) {
   Tensor<double> A("A", {8}, Format({Sparse}));
   Tensor<double> B("B", {8}, Format({Dense}));
@@ -1054,6 +1219,66 @@ TEST(scheduling, divide) {
   });
 }
 
+TEST(scheduling, tile) {
+  const int m = 70, n = 50, o = 60;
+  Tensor<double> A("A", {m, o}, Format({Dense, Dense}));
+  Tensor<double> B("B", {o, n}, Format({Dense, Dense}));
+  for (int i = 0; i < m; i++) {
+    for (int k = 0; k < o; k++) {
+      A.insert({i, k}, (double) (i + k));
+    }
+  }
+  for (int k = 0; k < o; k++) {
+    for (int j = 0; j < n; j++) {
+      B.insert({k, j}, (double) (k - j));
+    }
+  }
+  A.pack();
+  B.pack();
+
+  Tensor<double> expected("expected", {m, n}, Format({Dense, Dense}));
+  expected(i, j) = A(i, k) * B(k, j);
+  expected.evaluate();
+
+  auto test = [&](std::function<IndexStmt(IndexStmt)> schedule) {
+    Tensor<double> C("C", {m, n}, Format({Dense, Dense}));
+    C(i, j) = A(i, k) * B(k, j);
+    IndexStmt stmt = schedule(C.getAssignment().concretize());
+    C.compile(stmt);
+    C.assemble();
+    C.compute();
+    ASSERT_TENSOR_EQ(expected, C);
+    return stmt;
+  };
+
+  // The tile sizes do not divide the dimensions, so every level has tails
+  IndexStmt stmt = test([&](IndexStmt stmt) {
+    return stmt.tile({i, j, k}, {{32, 32, 16}, {8, 8, 4}});
+  });
+  vector<string> loops;
+  stmt = to<SuchThat>(stmt).getStmt();
+  while (isa<Forall>(stmt)) {
+    loops.push_back(to<Forall>(stmt).getIndexVar().getName());
+    stmt = to<Forall>(stmt).getStmt();
+  }
+  ASSERT_EQ(vector<string>({"i0", "j0", "k0", "i1", "j1", "k1", "i2", "j2", "k2"}),
+            loops);
+
+  test([&](IndexStmt stmt) {
+    return stmt.tile({i, j}, {{16, 16}});
+  });
+  test([&](IndexStmt stmt) {
+    return stmt.tile({i, j, k});
+  });
+
+  // Three tiles of doubles fit in half the cache at both levels
+  IndexStmt concrete = makeConcreteNotation(expected.getAssignment());
+  ASSERT_EQ(vector<vector<size_t>>({{128, 128, 128}, {16, 16, 16}}),
+            getTileSizes(concrete, {i, j, k}, {32 * 1024, 1024 * 1024}));
+  ASSERT_THROW(concrete.tile({i, j}, {{16, 16}, {5, 8}}), taco::TacoException);
+  ASSERT_THROW(concrete.tile({i, j}, {{16}}), taco::TacoException);
+}
+
 TEST(scheduling, mergeby) {
   auto dim = 256;
   float sparsity = 0.1;
@@ -1102,6 +1327,16 @@ TEST(scheduling, mergeby) {
     return stmt.mergeby(j, MergeStrategy::TwoFinger);
   });
 
+  // Merging three iterators with Vectorized falls back to Two Finger.
+  test([&](IndexStmt stmt) {
+    return stmt.mergeby(j, MergeStrategy::Vectorized);
+  });
+
+  // Merging three iterators with Adaptive falls back to Two Finger.
+  test([&](IndexStmt stmt) {
+    return stmt.mergeby(j, MergeStrategy::Adaptive);
+  });
+
   // Merging a dimension with a dense iterator with Gallop should be no-op.
   test([&](IndexStmt stmt) {
     return stmt.mergeby(i, MergeStrategy::Gallop);
@@ -1125,6 +1360,204 @@ TEST(scheduling, mergeby) {
   });
 }
 
+TEST(scheduling, mergeby_vectorized) {
+  const int dim = 2000;
+  Tensor<double> a("a", {dim}, Format({Sparse}));
+  Tensor<double> b("b", {dim}, Format({Sparse}));
+  IndexVar i("i");
+
+  srand(4357);
+  for (int k = 0; k < dim; k++) {
+    float rand_float = (float)rand()/(float)(RAND_MAX);
+    if (rand_float < 0.3) {
+      a.insert({k}, (double) k);
+    }
+    if (rand_float > 0.2 && rand_float < 0.25) {
+      b.insert({k}, (double) (k + 1));
+    }
+    if (k % 97 == 0) {
+      b.insert({k}, 1.0);
+    }
+  }
+  a.pack(); b.pack();
+
+  Tensor<double> expectedDot("expectedDot");
+  expectedDot = a(i) * b(i);
+  Tensor<double> dot("dot");
+  dot = a(i) * b(i);
+  dot.compile(dot.getAssignment().concretize()
+                  .mergeby(i, MergeStrategy::Vectorized));
+  dot.assemble();
+  dot.compute();
+  ASSERT_NE(std::string::npos, dot.getSource().find(" = taco_intersect_next("));
+  ASSERT_TRUE(equals(expectedDot, dot));
+
+  Tensor<double> expected("expected", {dim}, Format({Sparse}));
+  expected(i) = a(i) * b(i);
+  Tensor<double> y("y", {dim}, Format({Sparse}));
+  y(i) = a(i) * b(i);
+  y.compile(y.getAssignment().concretize()
+                .mergeby(i, MergeStrategy::Vectorized));
+  y.assemble();
+  y.compute();
+  ASSERT_TRUE(equals(expected, y));
+
+  Tensor<double> sum("sum", {dim}, Format({Sparse}));
+  sum(i) = a(i) + b(i);
+  ASSERT_THROW(sum.getAssignment().concretize()
+                   .mergeby(i, MergeStrategy::Vectorized), taco::TacoException);
+}
+
+TEST(scheduling, mergeby_adaptive) {
+  const int dim = 512;
+  Tensor<double> A("A", {dim, dim}, CSR);
+  Tensor<double> B("B", {dim, dim}, CSR);
+  IndexVar i("i"), j("j");
+
+  // Rows alternate between segments of similar lengths and segments whose
+  // lengths differ by much more than the gallop ratio
+  srand(7717);
+  for (int i = 0; i < dim; i++) {
+    for (int j = 0; j < dim; j++) {
+      float rand_float = (float)rand()/(float)(RAND_MAX);
+      if (i % 2 == 0) {
+        if (rand_float < 0.2) {
+          A.insert({i, j}, (double) (i + j));
+        }
+        if (rand_float > 0.1 && rand_float < 0.3) {
+          B.insert({i, j}, (double) (i - j));
+        }
+      } else {
+        A.insert({i, j}, (double) j);
+        if (j % 61 == i % 61) {
+          B.insert({i, j}, 2.0);
+        }
+      }
+    }
+  }
+  A.pack(); B.pack();
+
+  Tensor<double> expected("expected", {dim}, Format({Dense}));
+  expected(i) = A(i, j) * B(i, j);
+  Tensor<double> y("y", {dim}, Format({Dense}));
+  y(i) = A(i, j) * B(i, j);
+  y.compile(y.getAssignment().concretize()
+                .mergeby(j, MergeStrategy::Adaptive));
+  y.assemble();
+  y.compute();
+  ASSERT_NE(std::string::npos, y.getSource().find("if (taco_prefer_gallop("));
+  ASSERT_TRUE(equals(expected, y));
+
+  Tensor<double> expectedC("expectedC", {dim, dim}, CSR);
+  expectedC(i, j) = A(i, j) * B(i, j);
+  Tensor<double> C("C", {dim, dim}, CSR);
+  C(i, j) = A(i, j) * B(i, j);
+  C.compile(C.getAssignment().concretize()
+                .mergeby(j, MergeStrategy::Adaptive));
+  C.assemble();
+  C.compute();
+  ASSERT_TRUE(equals(expectedC, C));
+
+  // Packed coordinates cannot be galloped through, so their merges fall back
+  // to two fingers
+  Tensor<double> Ap("Ap", {dim, dim}, Format({Dense, Packed}));
+  for (auto& component : iterate<double>(A)) {
+    Ap.insert(component.first.toVector(), component.second);
+  }
+  Ap.pack();
+  Tensor<double> yp("yp", {dim}, Format({Dense}));
+  yp(i) = Ap(i, j) * B(i, j);
+  yp.compile(yp.getAssignment().concretize()
+                 .mergeby(j, MergeStrategy::Adaptive));
+  yp.assemble();
+  yp.compute();
+  ASSERT_EQ(std::string::npos, yp.getSource().find("if (taco_prefer_gallop("));
+  ASSERT_TRUE(equals(expected, yp));
+
+  Tensor<double> sum("sum", {dim, dim}, CSR);
+  sum(i, j) = A(i, j) + B(i, j);
+  ASSERT_THROW(sum.getAssignment().concretize()
+                   .mergeby(j, MergeStrategy::Adaptive), taco::TacoException);
+}
+
+TEST(scheduling, parallelize_sparse_result) {
+  const int dim = 200;
+  Tensor<double> A("A", {dim, dim}, CSR);
+  Tensor<double> B("B", {dim, dim}, CSR);
+  IndexVar i("i"), j("j"), k("k");
+
+  srand(5011);
+  for (int i = 0; i < dim; i++) {
+    for (int j = 0; j < dim; j++) {
+      float rand_float = (float)rand()/(float)(RAND_MAX);
+      if (rand_float < 0.05) {
+        A.insert({i, j}, (double) (i + j));
+      }
+      if (rand_float > 0.02 && rand_float < 0.08) {
+        B.insert({i, j}, (double) (j - i));
+      }
+    }
+  }
+  A.pack(); B.pack();
+
+  // Parallelizing the rows of a CSR result assembles it in two passes
+  Tensor<double> expectedMul("expectedMul", {dim, dim}, CSR);
+  expectedMul(i, j) = A(i, j) * B(i, j);
+  Tensor<double> mul("mul", {dim, dim}, CSR);
+  mul(i, j) = A(i, j) * B(i, j);
+  IndexStmt stmt = mul.getAssignment().concretize()
+                      .parallelize(i, ParallelUnit::CPUThread,
+                                   OutputRaceStrategy::NoRaces);
+  ASSERT_TRUE(isa<Assemble>(stmt));
+  mul.compile(stmt);
+  mul.assemble();
+  mul.compute();
+  ASSERT_TRUE(equals(expectedMul, mul));
+
+  // The row sizes are counted and the rows are filled in parallel loops, with
+  // a sequential scan of the sizes in between
+  std::string source = mul.getSource();
+  size_t assemble = source.find("int assemble(");
+  ASSERT_NE(std::string::npos, assemble);
+  size_t count = source.find("#pragma omp parallel for", assemble);
+  size_t scan = source.find("mul2_pos[imul + 1] = mul2_pos[imul] + mul2_nnz[i];",
+                            assemble);
+  ASSERT_NE(std::string::npos, count);
+  ASSERT_NE(std::string::npos, scan);
+  ASSERT_LT(count, scan);
+  size_t fill = source.find("#pragma omp parallel for", count + 1);
+  ASSERT_NE(std::string::npos, fill);
+  ASSERT_LT(scan, fill);
+  size_t end = source.find("\n}\n", assemble);
+  ASSERT_LT(fill, end);
+
+  // Rows of sparse matrix products are assembled in dense workspaces that
+  // every thread has a slice of
+  Tensor<double> expectedProd("expectedProd", {dim, dim}, CSR);
+  expectedProd(i, k) = A(i, j) * B(j, k);
+  Tensor<double> prod("prod", {dim, dim}, CSR);
+  prod(i, k) = A(i, j) * B(j, k);
+  stmt = reorderLoopsTopologically(prod.getAssignment().concretize());
+  Assignment assignment = stmt.as<Forall>().getStmt().as<Forall>().getStmt()
+                              .as<Forall>().getStmt().as<Assignment>();
+  TensorVar w("w", Type(Float64, {(size_t)dim}), taco::dense);
+  stmt = stmt.precompute(assignment.getRhs(), k, k, w)
+             .parallelize(i, ParallelUnit::CPUThread,
+                          OutputRaceStrategy::NoRaces);
+  prod.compile(stmt);
+  prod.assemble();
+  prod.compute();
+  ASSERT_TRUE(equals(expectedProd, prod));
+
+  // Iterations over the coordinates of a row cannot insert in parallel
+  Tensor<double> C("C", {dim, dim}, CSR);
+  C(i, j) = A(i, j) * B(i, j);
+  ASSERT_THROW(C.getAssignment().concretize()
+                   .parallelize(j, ParallelUnit::CPUThread,
+                                OutputRaceStrategy::NoRaces),
+               taco::TacoException);
+}
+
 TEST(scheduling, mergeby_gallop_error) {
   Tensor<double> x("x", {8}, Format({Sparse}));
   Tensor<double> y("y", {8}, Format({Dense}));
@@ -1134,4 +1567,21 @@ TEST(scheduling, mergeby_gallop_error) {
 
   IndexStmt stmt = y.getAssignment().concretize();
   ASSERT_THROW(stmt.mergeby(i, MergeStrategy::Gallop), taco::TacoException);
+}
+
+TEST(scheduling, mergeby_gallop_packed_error) {
+  Tensor<double> x("x", {8}, Format({Packed}));
+  Tensor<double> z("z", {8}, Format({Sparse}));
+  x.insert({1}, 1.0);
+  x.insert({5}, 2.0);
+  z.insert({5}, 2.0);
+  x.pack(); z.pack();
+  IndexVar i("i");
+  Tensor<double> y("y");
+  y = x(i) * z(i);
+
+  // Packed coordinates are bit-packed words that cannot be galloped through
+  IndexStmt stmt = y.getAssignment().concretize()
+                    .mergeby(i, MergeStrategy::Gallop);
+  ASSERT_THROW(y.compile(stmt), taco::TacoException);
 }
\ No newline at end of file
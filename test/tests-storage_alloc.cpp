@@ -5,6 +5,7 @@
 #include "taco/index_notation/index_notation.h"
 #include "taco/index_notation/index_notation_nodes.h"
 #include "taco/storage/storage.h"
+#include "taco/storage/allocator.h"
 #include "taco/lower/mode_format_dense.h"
 #include "taco/lower/mode_format_compressed.h"
 
@@ -80,6 +81,69 @@ std::vector<double> dlab_values() {
   return values;
 }
 
+TEST(storage_alloc, arena) {
+  auto arena = std::make_shared<ArenaAllocator>();
+  Tensor<double> a("a", {10000}, Format({SparseSmall}));
+  a.setAllocator(arena);
+  ASSERT_EQ(arena, a.getAllocator());
+
+  Tensor<double> b = dla("b", Format({SparseSmall}));
+  Tensor<double> c = dlb("c", Format({SparseSmall}));
+  a(i) = b(i) + c(i);
+  packOperands(a);
+  a.setAssembleWhileCompute(true);
+  a.compile();
+
+  // Once the arrays of the previous result are returned to the arena, new
+  // results reuse them without allocating more memory
+  size_t numAllocations = 0;
+  for (int run = 0; run < 5; run++) {
+    a.assemble();
+    a.compute();
+    ASSERT_COMPONENTS_EQUALS({{{0,6667}, dlab_indices()}}, dlab_values(), a);
+    if (run == 2) {
+      numAllocations = arena->getNumBackingAllocations();
+    }
+  }
+  ASSERT_LT(0u, numAllocations);
+  ASSERT_EQ(numAllocations, arena->getNumBackingAllocations());
+}
+
+TEST(storage_alloc, numa) {
+  ASSERT_LE(1, NumaAllocator::getNumNodes());
+  for (auto policy : {NumaAllocator::Interleave, NumaAllocator::FirstTouch}) {
+    auto numa = std::make_shared<NumaAllocator>(policy);
+
+    // Large arrays are mapped, small ones come from the C allocator
+    for (size_t size : {(size_t)100, (size_t)1 << 16}) {
+      int* data = (int*)numa->allocate(size * sizeof(int), true);
+      for (size_t i = 0; i < size; i++) {
+        ASSERT_EQ(0, data[i]);
+        data[i] = (int)i;
+      }
+      data = (int*)numa->reallocate(data, 0, 2 * size * sizeof(int));
+      for (size_t i = 0; i < size; i++) {
+        ASSERT_EQ((int)i, data[i]);
+      }
+      numa->deallocate(data);
+    }
+
+    Tensor<double> expected("expected", {100000}, Format({Dense}));
+    Tensor<double> a("a", {100000}, Format({Dense}));
+    a.setAllocator(numa);
+    Tensor<double> b("b", {100000}, Format({Sparse}));
+    for (int k = 0; k < 100000; k += 3) {
+      b.insert({k}, (double)k);
+    }
+    b.pack();
+    expected(i) = b(i) * 2;
+    a(i) = b(i) * 2;
+    expected.evaluate();
+    a.evaluate();
+    ASSERT_TRUE(equals(expected, a));
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(vector_add, alloc,
     Values(
            TestData(Tensor<double>("a",{10000},Format({Sparse})),
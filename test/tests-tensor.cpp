@@ -5,6 +5,7 @@
 
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 #include "taco/util/collections.h"
 
@@ -336,6 +337,289 @@ TEST(tensor, explicit_compiler_methods) {
   }
 }
 
+TEST(tensor, prepared_kernel) {
+  Tensor<double> a({2},   Format({Dense}));
+  Tensor<double> B({2,3}, Format({Dense,Sparse}));
+  Tensor<double> c({3},   Format({Dense}));
+  Tensor<double> d({3},   Format({Dense}));
+
+  B(0,0) = 1.0;
+  B(1,2) = 2.0;
+  c(0) = 3.0;
+  c(2) = 4.0;
+  d(0) = 5.0;
+  d(2) = 6.0;
+  d.pack();
+
+  IndexVar i, j;
+  a(i) = B(i,j) * c(j);
+  a.compile();
+  PreparedKernel kernel = a.prepare();
+  ASSERT_TRUE(kernel.defined());
+  ASSERT_FALSE(a.needsCompute());
+
+  ASSERT_TRUE(kernel.assemble());
+  ASSERT_TRUE(kernel.compute());
+  ASSERT_EQ(3.0, a.at({0}));
+  ASSERT_EQ(8.0, a.at({1}));
+
+  // Components changed in place are seen by the next call
+  double* vals = (double*)B.getStorage().getValues().getData();
+  vals[0] = 10.0;
+  ASSERT_TRUE(kernel.compute());
+  ASSERT_EQ(30.0, a.at({0}));
+  ASSERT_EQ(8.0, a.at({1}));
+
+  // Swap in the storage of another vector of the same shape
+  size_t cArgument = 1;
+  while (kernel.getArgument(cArgument).getOrder() != 1) {
+    cArgument++;
+  }
+  kernel.bind(cArgument, d.getStorage());
+  ASSERT_TRUE(kernel.compute());
+  ASSERT_EQ(50.0, a.at({0}));
+  ASSERT_EQ(12.0, a.at({1}));
+
+  Tensor<double> e({4}, Format({Dense}));
+  e.pack();
+  ASSERT_THROW(kernel.bind(cArgument, e.getStorage()), taco::TacoException);
+}
+
+TEST(tensor, fuse_pending_operands) {
+  Format dm({Dense,Dense});
+  Tensor<double> B({2,3}, dm);
+  Tensor<double> C({3,2}, dm);
+  Tensor<double> P({2,2,3}, Format({Dense,Dense,Dense}));
+  Tensor<double> A({2,2}, dm);
+
+  for (int i = 0; i < 2; i++) {
+    for (int k = 0; k < 3; k++) {
+      B.insert({i,k}, (double)(i + k));
+      C.insert({k,i}, (double)(k - i));
+    }
+  }
+  B.pack();
+  C.pack();
+
+  IndexVar i, j, k;
+  P(i,j,k) = B(i,k) * C(k,j);
+  A(i,j) = sum(k, P(i,j,k));
+  A.evaluate();
+
+  // The products are summed as they are computed instead of being stored in P
+  vector<TensorVar> arguments = getArguments(
+      makeConcreteNotation(A.getKernelAssignment()));
+  ASSERT_FALSE(util::contains(arguments, P.getTensorVar()));
+  ASSERT_TRUE(P.needsCompute());
+
+  ASSERT_EQ(5.0,  A.at({0,0}));
+  ASSERT_EQ(2.0,  A.at({0,1}));
+  ASSERT_EQ(8.0,  A.at({1,0}));
+  ASSERT_EQ(2.0,  A.at({1,1}));
+
+  // P is still computed if it is read
+  ASSERT_EQ(3.0, P.at({1,1,2}));
+
+  // Redefining P recompiles the kernel that P was fused into
+  P(i,j,k) = 2.0 * B(i,k) * C(k,j);
+  A(i,j) = sum(k, P(i,j,k));
+  ASSERT_TRUE(A.needsCompile());
+  ASSERT_EQ(10.0, A.at({0,0}));
+}
+
+TEST(tensor, evaluate_together) {
+  Format csr({Dense,Sparse});
+  Tensor<double> B({3,4}, csr);
+  B.insert({0,0}, 1.0);
+  B.insert({0,3}, 2.0);
+  B.insert({2,1}, 3.0);
+  B.insert({2,2}, 4.0);
+  B.pack();
+
+  Tensor<double> sums({3}, Format({Dense}));
+  Tensor<double> squares({3}, Format({Dense}));
+  Tensor<double> scaled({3,4}, csr);
+
+  IndexVar i, j;
+  sums(i) = sum(j, B(i,j));
+  squares(i) = sum(j, B(i,j) * B(i,j));
+  scaled(i,j) = 2.0 * B(i,j);
+  evaluate({sums, squares, scaled});
+
+  ASSERT_FALSE(sums.needsCompute());
+  ASSERT_FALSE(squares.needsCompute());
+  ASSERT_FALSE(scaled.needsCompute());
+
+  Tensor<double> expectedSums({3}, Format({Dense}));
+  expectedSums.insert({0}, 3.0);
+  expectedSums.insert({2}, 7.0);
+  expectedSums.pack();
+  ASSERT_TENSOR_EQ(expectedSums, sums);
+
+  Tensor<double> expectedSquares({3}, Format({Dense}));
+  expectedSquares.insert({0}, 5.0);
+  expectedSquares.insert({2}, 25.0);
+  expectedSquares.pack();
+  ASSERT_TENSOR_EQ(expectedSquares, squares);
+
+  Tensor<double> expectedScaled({3,4}, csr);
+  expectedScaled.insert({0,0}, 2.0);
+  expectedScaled.insert({0,3}, 4.0);
+  expectedScaled.insert({2,1}, 6.0);
+  expectedScaled.insert({2,2}, 8.0);
+  expectedScaled.pack();
+  ASSERT_TENSOR_EQ(expectedScaled, scaled);
+
+  // A tensor cannot be evaluated together with a tensor that reads it
+  Tensor<double> total("total");
+  total = sum(i, sums(i));
+  ASSERT_THROW(evaluate({sums, total}), taco::TacoException);
+}
+
+TEST(tensor, recompute) {
+  Format csr({Dense,Sparse});
+  Tensor<double> B({3,3}, csr);
+  B.insert({0,0}, 1.0);
+  B.insert({0,2}, 2.0);
+  B.insert({2,1}, 3.0);
+  B.pack();
+  Tensor<double> c({3}, Format({Dense}));
+  c.insert({0}, 1.0);
+  c.insert({1}, 2.0);
+  c.insert({2}, 3.0);
+  c.pack();
+
+  Tensor<double> a({3}, Format({Dense}));
+  Tensor<double> A({3,3}, csr);
+  IndexVar i, j;
+  a(i) = sum(j, B(i,j) * c(j));
+  A(i,j) = B(i,j) * c(j);
+
+  // A tensor that has not been assembled cannot be recomputed
+  a.compile();
+  ASSERT_THROW(a.recompute(), taco::TacoException);
+  a.evaluate();
+  A.evaluate();
+  ASSERT_EQ(7.0, a.at({0}));
+  ASSERT_EQ(6.0, a.at({2}));
+
+  // Change the operand values without changing their sparsity patterns
+  double* cvals = (double*)c.getStorage().getValues().getData();
+  cvals[2] = 10.0;
+  double* Bvals = (double*)B.getStorage().getValues().getData();
+  Bvals[2] = 1.0;
+
+  void* avals = a.getStorage().getValues().getData();
+  void* Avals = A.getStorage().getValues().getData();
+  void* Apos = A.getStorage().getIndex().getModeIndex(1).getIndexArray(0)
+                .getData();
+  a.recompute();
+  A.recompute();
+  ASSERT_EQ(avals, a.getStorage().getValues().getData());
+  ASSERT_EQ(Avals, A.getStorage().getValues().getData());
+  ASSERT_EQ(Apos, A.getStorage().getIndex().getModeIndex(1).getIndexArray(0)
+                   .getData());
+
+  ASSERT_EQ(21.0, a.at({0}));
+  ASSERT_EQ(0.0,  a.at({1}));
+  ASSERT_EQ(2.0,  a.at({2}));
+  ASSERT_EQ(20.0, A.at({0,2}));
+  ASSERT_EQ(2.0,  A.at({2,1}));
+}
+
+TEST(tensor, reuse_assembled_pattern) {
+  Format csr({Dense,Sparse});
+  Tensor<double> B({3,3}, csr);
+  Tensor<double> C({3,3}, csr);
+  B.insert({0,0}, 1.0);
+  B.insert({2,1}, 2.0);
+  C.insert({0,2}, 3.0);
+  C.insert({2,1}, 4.0);
+  B.pack();
+  C.pack();
+
+  Tensor<double> A({3,3}, csr);
+  IndexVar i, j;
+  A(i,j) = B(i,j) + C(i,j);
+  A.evaluate();
+  ASSERT_EQ(6.0, A.at({2,1}));
+  void* pos = A.getStorage().getIndex().getModeIndex(1).getIndexArray(0)
+               .getData();
+
+  // Only the values of B change, so A keeps its index
+  double* Bvals = (double*)B.getStorage().getValues().getData();
+  Bvals[1] = 5.0;
+  A(i,j) = B(i,j) + C(i,j);
+  ASSERT_TRUE(A.needsAssemble());
+  A.evaluate();
+  ASSERT_EQ(pos, A.getStorage().getIndex().getModeIndex(1).getIndexArray(0)
+                  .getData());
+  ASSERT_EQ(9.0, A.at({2,1}));
+  ASSERT_EQ(3.0, A.at({0,2}));
+
+  // Repacking B gives it new index arrays, so A is assembled again
+  B.insert({1,1}, 7.0);
+  B.pack();
+  A(i,j) = B(i,j) + C(i,j);
+  A.evaluate();
+
+  Tensor<double> expected({3,3}, csr);
+  expected.insert({0,0}, 1.0);
+  expected.insert({0,2}, 3.0);
+  expected.insert({1,1}, 7.0);
+  expected.insert({2,1}, 9.0);
+  expected.pack();
+  ASSERT_TENSOR_EQ(expected, A);
+}
+
+TEST(tensor, concurrent_evaluation) {
+  const int numTensors = 4;
+  Format csr({Dense,Sparse});
+  Tensor<double> B({4,4}, csr);
+  for (int i = 0; i < 4; i++) {
+    B.insert({i,i}, 1.0);
+    B.insert({i,(i+1)%4}, 2.0);
+  }
+  B.pack();
+
+  vector<Tensor<double>> xs;
+  vector<Tensor<double>> ys;
+  for (int t = 0; t < numTensors; t++) {
+    Tensor<double> x({4}, Format({Dense}));
+    for (int i = 0; i < 4; i++) {
+      x.insert({i}, (double)(t + 1));
+    }
+    x.pack();
+    xs.push_back(x);
+    ys.push_back(Tensor<double>({4}, Format({Dense})));
+  }
+
+  taco_set_num_threads(1);
+  vector<int> numThreads(numTensors);
+  vector<std::thread> threads;
+  for (int t = 0; t < numTensors; t++) {
+    threads.emplace_back([&, t]() {
+      ScopedParallelSettings settings(t + 1, ParallelSchedule::Dynamic, 2);
+      numThreads[t] = taco_get_num_threads();
+      IndexVar i, j;
+      ys[t](i) = sum(j, B(i,j) * xs[t](j));
+      ys[t].evaluate();
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Each thread sees its own settings, and the process settings are kept
+  ASSERT_EQ(1, taco_get_num_threads());
+  for (int t = 0; t < numTensors; t++) {
+    ASSERT_EQ(t + 1, numThreads[t]);
+    for (int i = 0; i < 4; i++) {
+      ASSERT_EQ(3.0 * (t + 1), ys[t].at({i}));
+    }
+  }
+}
+
 TEST(tensor, computation_dependency_modification) {
   Format csr({Dense,Sparse});
   Format csf({Sparse,Sparse,Sparse});
@@ -421,3 +421,98 @@ TEST(DISABLED_tensor_types, coordinate_types) {
   }
 
 }
+
+TEST(tensor_types, index_types_64) {
+  Format csr({Dense, Sparse});
+  Format csr64({Dense, Sparse});
+  csr64.setLevelArrayTypes({{Int32}, {Int64, Int64}});
+  Format dcsr64({Sparse, Sparse});
+  dcsr64.setLevelArrayTypes({{Int64, Int32}, {Int64, Int32}});
+
+  Tensor<double> expected("expected", {3, 4}, csr);
+  Tensor<double> A("A", {3, 4}, csr64);
+  Tensor<double> B("B", {3, 4}, dcsr64);
+  for (auto& component : std::vector<std::pair<std::vector<int>, double>>{
+           {{0, 1}, 1.0}, {{0, 3}, 2.0}, {{2, 0}, 3.0}, {{2, 2}, 4.0}}) {
+    expected.insert(component.first, component.second);
+    A.insert(component.first, component.second);
+    B.insert(component.first, component.second);
+  }
+  expected.pack();
+  A.pack();
+  B.pack();
+  ASSERT_EQ(Int64, A.getStorage().getIndex().getModeIndex(1)
+                    .getIndexArray(0).getType());
+  ASSERT_EQ(Int64, B.getStorage().getIndex().getModeIndex(0)
+                    .getIndexArray(0).getType());
+  ASSERT_EQ(Int32, B.getStorage().getIndex().getModeIndex(0)
+                    .getIndexArray(1).getType());
+  ASSERT_TENSOR_EQ(expected, A);
+  ASSERT_TENSOR_EQ(expected, B);
+
+  Tensor<double> x("x", {4}, Format({Dense}));
+  for (int n = 0; n < 4; n++) {
+    x.insert({n}, (double)(n + 1));
+  }
+  x.pack();
+
+  Tensor<double> y("y", {3}, Format({Dense}));
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  ASSERT_NE(std::string::npos, y.getSource().find("int64_t* restrict A2_pos"));
+
+  Tensor<double> yExpected("yExpected", {3}, Format({Dense}));
+  yExpected.insert({0}, 10.0);
+  yExpected.insert({2}, 15.0);
+  yExpected.pack();
+  ASSERT_TENSOR_EQ(yExpected, y);
+
+  // Assemble results with 64-bit positions
+  Tensor<double> C("C", {3, 4}, dcsr64);
+  C(i,j) = A(i,j) + B(i,j);
+  C.evaluate();
+  ASSERT_EQ(Int64, C.getStorage().getIndex().getModeIndex(1)
+                    .getIndexArray(0).getType());
+
+  Tensor<double> CExpected("CExpected", {3, 4}, csr);
+  CExpected(i,j) = expected(i,j) + expected(i,j);
+  CExpected.evaluate();
+  ASSERT_TENSOR_EQ(CExpected, C);
+}
+
+TEST(tensor_types, index_types_kernel_reuse) {
+  Format csr({Dense, Sparse});
+  Format csr64({Dense, Sparse});
+  csr64.setLevelArrayTypes({{Int32}, {Int64, Int32}});
+
+  const int n = 100;
+  Tensor<double> x("x", {n}, Format({Dense}));
+  for (int k = 0; k < n; k++) {
+    x.insert({k}, (double)k);
+  }
+  x.pack();
+
+  // Compute the same expression on 32-bit and then 64-bit positions, so that
+  // the second computation must not reuse the kernel compiled for the first.
+  std::vector<double> sums;
+  for (const Format& format : {csr, csr64}) {
+    Tensor<double> A("A", {n, n}, format);
+    for (int k = 0; k < n; k++) {
+      A.insert({k, k}, 1.0);
+      A.insert({k, (k + 1) % n}, 1.0);
+    }
+    A.pack();
+
+    Tensor<double> y("y", {n}, Format({Dense}));
+    y(i) = A(i,j) * x(j);
+    y.evaluate();
+
+    double sum = 0.0;
+    for (auto& value : y) {
+      sum += value.second;
+    }
+    sums.push_back(sum);
+  }
+  ASSERT_DOUBLE_EQ(9900.0, sums[0]);
+  ASSERT_DOUBLE_EQ(9900.0, sums[1]);
+}
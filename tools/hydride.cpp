@@ -261,6 +261,10 @@ static bool setSchedulingCommands(vector<vector<string>> scheduleCommands, parse
         strategy = MergeStrategy::TwoFinger;
       } else if (strat == "Gallop") {
         strategy = MergeStrategy::Gallop;
+      } else if (strat == "Vectorized") {
+        strategy = MergeStrategy::Vectorized;
+      } else if (strat == "Adaptive") {
+        strategy = MergeStrategy::Adaptive;
       } else {
         taco_uerror << "Merge strategy not defined.";
         goto end;
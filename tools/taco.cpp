@@ -32,6 +32,7 @@
 #include "taco/index_notation/transformations.h"
 #include "taco/index_notation/index_notation_visitor.h"
 #include "taco/index_notation/index_notation_nodes.h"
+#include "taco/index_notation/cost_model.h"
 #include "taco/version.h"
 
 using namespace std;
@@ -183,6 +184,11 @@ static void printUsageInfo() {
   printFlag("print-concrete",
             "Print the concrete index notation of this expression.");
   cout << endl;
+  printFlag("print-cost",
+            "Print the estimated cost of the concrete index notation. Loaded "
+            "tensors are measured and other sparse tensors are assumed to "
+            "have 1% nonzeros.");
+  cout << endl;
   printFlag("print-iteration-graph",
             "Print the iteration graph of this expression in the dot format.");
   cout << endl;
@@ -246,6 +252,15 @@ static void printSchedulingHelp() {
               "in the iteration order.  The indexes are ordered from outermost "
               "to innermost.");
     cout << endl;
+    printFlag("s=tile({i, j, ...}, {ti, tj, ...}, ...)", "Tiles the directly "
+              "nested index variables in the first list for a hierarchy of "
+              "caches.  Every further list gives the tile size of each "
+              "variable at one level of tiling, from the outermost level to "
+              "the innermost, and the variables derived from `i` are named "
+              "`i0` (the outermost tile loop) through `iL` (the loop within the "
+              "innermost tile).  Without tile sizes, one level is made for "
+              "each data cache of this machine.");
+    cout << endl;
     printFlag("s=bound(i, ib, b, type)", "Replaces an index variable `i` "
               "with an index variable `ib` that obeys a compile-time constraint "
               "on its iteration space, incorporating knowledge about the size or "
@@ -262,7 +277,8 @@ static void printSchedulingHelp() {
               "an output race strategy `strat`. Since the other transformations "
               "expect serial code, parallelize must come last in a series of "
               "transformations.  Possible parallel hardware units are: "
-              "NotParallel, GPUBlock, GPUWarp, GPUThread, CPUThread, CPUVector. "
+              "NotParallel, GPUBlock, GPUWarp, GPUThread, CPUThread, CPUTask, "
+              "CPUThreadBalanced, CPUVector. "
               "Possible output race strategies are: "
               "IgnoreRaces, NoRaces, Atomics, Temporary, ParallelReduction.");
 }
@@ -495,6 +511,28 @@ static bool setSchedulingCommands(vector<vector<string>> scheduleCommands, parse
 
       stmt = stmt.reorder(reorderedVars);
 
+    } else if (command == "tile") {
+      taco_uassert(scheduleCommand.size() > 0) << "'tile' scheduling directive takes a list of index variables and optionally a list of tile sizes per level: tile({i, j}[, {64, 64}, {8, 8}, ...])";
+
+      vector<IndexVar> tiledVars;
+      for (string var : parser::varListParser(scheduleCommand[0])) {
+        tiledVars.push_back(findVar(var));
+      }
+
+      vector<vector<size_t>> tileSizes;
+      for (size_t level = 1; level < scheduleCommand.size(); level++) {
+        vector<size_t> levelSizes;
+        for (string size : parser::varListParser(scheduleCommand[level])) {
+          size_t tileSize;
+          taco_uassert(sscanf(size.c_str(), "%zu", &tileSize) == 1)
+              << "failed to parse tile size '" << size << "' as a size_t";
+          levelSizes.push_back(tileSize);
+        }
+        tileSizes.push_back(levelSizes);
+      }
+      stmt = tileSizes.empty() ? stmt.tile(tiledVars)
+                               : stmt.tile(tiledVars, tileSizes);
+
     } else if (command == "mergeby") {
       taco_uassert(scheduleCommand.size() == 2) << "'mergeby' scheduling directive takes 2 parameters: mergeby(i, strategy)";
       string i, strat;
@@ -506,6 +544,10 @@ static bool setSchedulingCommands(vector<vector<string>> scheduleCommands, parse
         strategy = MergeStrategy::TwoFinger;
       } else if (strat == "Gallop") {
         strategy = MergeStrategy::Gallop;
+      } else if (strat == "Vectorized") {
+        strategy = MergeStrategy::Vectorized;
+      } else if (strat == "Adaptive") {
+        strategy = MergeStrategy::Adaptive;
       } else {
         taco_uerror << "Merge strategy not defined.";
         goto end;
@@ -569,6 +611,10 @@ static bool setSchedulingCommands(vector<vector<string>> scheduleCommands, parse
         isGPU = true;
       } else if (unit == "CPUThread") {
         parallel_unit = ParallelUnit::CPUThread;
+      } else if (unit == "CPUTask") {
+        parallel_unit = ParallelUnit::CPUTask;
+      } else if (unit == "CPUThreadBalanced") {
+        parallel_unit = ParallelUnit::CPUThreadBalanced;
       } else if (unit == "CPUVector") {
         parallel_unit = ParallelUnit::CPUVector;
       } else {
@@ -663,6 +709,7 @@ int main(int argc, char* argv[]) {
   bool printEvaluate       = false;
   bool printKernels        = false;
   bool printConcrete       = false;
+  bool printCost           = false;
   bool printIterationGraph = false;
 
   bool writeCompute        = false;
@@ -944,6 +991,9 @@ int main(int argc, char* argv[]) {
     else if ("-print-concrete" == argName) {
       printConcrete = true;
     }
+    else if ("-print-cost" == argName) {
+      printCost = true;
+    }
     else if ("-print-iteration-graph" == argName) {
       printIterationGraph = true;
     }
@@ -1177,6 +1227,32 @@ int main(int argc, char* argv[]) {
     cout << stmt << endl;
   }
 
+  if (printCost) {
+    map<TensorVar,TensorStatistics> statistics;
+    for (auto& tensor : parser.getTensors()) {
+      const TensorBase& tensorBase = tensor.second;
+      if (util::contains(loadedTensors, tensorBase.getName())) {
+        statistics.insert({tensorBase.getTensorVar(),
+                           TensorStatistics(tensorBase.getStorage())});
+        continue;
+      }
+      size_t size = 1;
+      for (int dimension : tensorBase.getDimensions()) {
+        size *= dimension;
+      }
+      const size_t nnz = isDense(tensorBase.getFormat()) ? size
+                                                         : (size + 99) / 100;
+      statistics.insert({tensorBase.getTensorVar(),
+                         TensorStatistics(tensorBase.getDimensions(),
+                                          tensorBase.getFormat(), nnz)});
+    }
+    CostModelParameters parameters;
+    if (nthreads > 0) {
+      parameters.numThreads = nthreads;
+    }
+    cout << estimateCost(stmt, statistics, parameters) << endl;
+  }
+
   Kernel kernel;
   if (benchmark) {
     if (time) cout << endl;